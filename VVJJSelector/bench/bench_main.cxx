@@ -0,0 +1,352 @@
+// Micro-benchmarks of the VVJJFlavorSelector hot paths, on synthetic
+// in-memory events (no ntuples needed).
+//
+// Every benchmark is run for a few warm-up repetitions, then timed over
+// NUM_REPETITIONS repetitions; the median and minimum time per operation are
+// reported. The event generator is seeded with a fixed value, so every run
+// sees exactly the same inputs.
+//
+// usage: run-vvjj-benchmarks [filter]
+//     only run the benchmarks whose name contains filter
+
+#include <TFile.h>
+#include <TH1.h>
+#include <TMemFile.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BaselineSelection.h"
+#include "CutFlow.h"
+#include "EventBlock.h"
+#include "SelectionConfig.h"
+#include "TH1Topo.h"
+#include "TH1TopoStore.h"
+#include "THnTopo.h"
+#include "THnTopoStore.h"
+#include "TagRegistry.h"
+#include "VVJJFlavorSelector.h"
+
+static const int NUM_WARMUP_REPETITIONS = 3;
+static const int NUM_REPETITIONS = 15;
+static const size_t NUM_EVENTS = 1 << 16;
+
+// keep the compiler from optimizing away a result
+template <typename T>
+static inline void
+do_not_optimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Fill a buffer with events roughly distributed like the Nominal ntuples,
+// with roughly one in eight of them passing the baseline selection.
+static void
+generate_events(EventBlockBuffer& buffer)
+{
+    std::mt19937_64 rng(12345);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+    std::exponential_distribution<double> falling(1.);
+
+    auto flag = [&] (double p) { return uniform(rng) < p ? 1. : 0.; };
+    auto pdgid = [&] () {
+        const double r = uniform(rng);
+        return r < 0.45 ? 21. : r < 0.95 ? std::floor(1 + 5 * uniform(rng)) : 0.;
+    };
+
+    for (size_t i = 0; i < buffer.capacity; i++) {
+        buffer.column(COL_weight)[i] = 0.5 + uniform(rng);
+        buffer.column(COL_pileup_weight)[i] = 0.8 + 0.4 * uniform(rng);
+        buffer.column(COL_dijet_mass_massordered)[i] = 1e3 * (700. + 800. * falling(rng));
+
+        buffer.column(COL_first_jet_pt)[i] = 1e3 * (350. + 300. * falling(rng));
+        buffer.column(COL_second_jet_pt)[i] = 1e3 * (300. + 250. * falling(rng));
+        buffer.column(COL_first_jet_m)[i] = 1e3 * (20. + 150. * uniform(rng));
+        buffer.column(COL_second_jet_m)[i] = 1e3 * (20. + 150. * uniform(rng));
+        buffer.column(COL_first_jet_eta)[i] = -2.5 + 5. * uniform(rng);
+        buffer.column(COL_second_jet_eta)[i] = -2.5 + 5. * uniform(rng);
+        buffer.column(COL_first_jet_phi)[i] = -3.14 + 6.28 * uniform(rng);
+        buffer.column(COL_second_jet_phi)[i] = -3.14 + 6.28 * uniform(rng);
+        buffer.column(COL_first_jet_D2)[i] = 4. * uniform(rng);
+        buffer.column(COL_second_jet_D2)[i] = 4. * uniform(rng);
+        buffer.column(COL_first_jet_pdgid)[i] = pdgid();
+        buffer.column(COL_second_jet_pdgid)[i] = pdgid();
+
+        buffer.column(COL_first_jet_passedWMassCut)[i] = flag(0.3);
+        buffer.column(COL_first_jet_passedZMassCut)[i] = flag(0.3);
+        buffer.column(COL_first_jet_passedWSubstructure)[i] = flag(0.4);
+        buffer.column(COL_first_jet_passedZSubstructure)[i] = flag(0.4);
+        buffer.column(COL_second_jet_passedWMassCut)[i] = flag(0.3);
+        buffer.column(COL_second_jet_passedZMassCut)[i] = flag(0.3);
+        buffer.column(COL_second_jet_passedWSubstructure)[i] = flag(0.4);
+        buffer.column(COL_second_jet_passedZSubstructure)[i] = flag(0.4);
+
+        buffer.column(COL_dyjj)[i] = -1.6 + 3.2 * uniform(rng);
+        buffer.column(COL_ptasym)[i] = 0.2 * uniform(rng);
+        buffer.column(COL_n_muons)[i] = flag(0.02);
+        buffer.column(COL_n_elecs)[i] = flag(0.02);
+
+        buffer.column(COL_jet1_m)[i] = buffer.column(COL_first_jet_m)[i];
+        buffer.column(COL_jet2_m)[i] = buffer.column(COL_second_jet_m)[i];
+        buffer.column(COL_jet1_ungrtrk500)[i] = std::floor(5. + 50. * uniform(rng));
+        buffer.column(COL_jet2_ungrtrk500)[i] = std::floor(5. + 50. * uniform(rng));
+    }
+
+    buffer.size = buffer.capacity;
+}
+
+// Time num_ops operations performed by each call of run, print the median and
+// minimum time per operation.
+static void
+benchmark(const std::string& filter, const std::string& name, size_t num_ops,
+        const std::function<void(void)>& run)
+{
+    if (name.find(filter) == std::string::npos)
+        return;
+
+    for (int i = 0; i < NUM_WARMUP_REPETITIONS; i++) {
+        run();
+    }
+
+    std::vector<double> ns_per_op;
+
+    for (int i = 0; i < NUM_REPETITIONS; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        const auto stop = std::chrono::steady_clock::now();
+
+        ns_per_op.push_back(std::chrono::duration<double, std::nano>(stop - start).count() / num_ops);
+    }
+
+    std::sort(ns_per_op.begin(), ns_per_op.end());
+
+    std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(2)
+        << std::setw(12) << ns_per_op[NUM_REPETITIONS / 2] << " ns/op (median)"
+        << std::setw(12) << ns_per_op.front() << " ns/op (min)" << std::endl;
+}
+
+int
+main(int argc, char** argv)
+{
+    const std::string filter = argc > 1 ? argv[1] : "";
+
+    TH1::AddDirectory(kFALSE);
+
+    EventBlockBuffer buffer(NUM_EVENTS);
+    generate_events(buffer);
+    const EventBlock events = buffer.view();
+
+    const SelectionConfig& config = SelectionConfig::defaults();
+    const TagRegistry& tags = config.get_tags();
+    const CutProgram& program = config.get_program();
+    const Double_t ntrk_max = config.get_ntrk_max();
+
+    // per-event tag masks, as computed in process_baseline_event()
+    std::vector<UInt_t> first_components(NUM_EVENTS), second_components(NUM_EVENTS);
+    std::vector<TagMask> first_jet_tags(NUM_EVENTS), second_jet_tags(NUM_EVENTS), event_tags(NUM_EVENTS);
+    std::vector<float> values(NUM_EVENTS), weights(NUM_EVENTS);
+
+    size_t num_event_tags_set = 0;
+    for (size_t i = 0; i < NUM_EVENTS; i++) {
+        first_components[i] = jet_tag_components(events.jet1_ungrtrk500[i] < ntrk_max,
+                events.first_jet_passedWMassCut[i], events.first_jet_passedWSubstructure[i],
+                events.first_jet_passedZMassCut[i], events.first_jet_passedZSubstructure[i]);
+        second_components[i] = jet_tag_components(events.jet2_ungrtrk500[i] < ntrk_max,
+                events.second_jet_passedWMassCut[i], events.second_jet_passedWSubstructure[i],
+                events.second_jet_passedZMassCut[i], events.second_jet_passedZSubstructure[i]);
+
+        first_jet_tags[i] = tags.compute_jet_tags(first_components[i]);
+        second_jet_tags[i] = tags.compute_jet_tags(second_components[i]);
+        event_tags[i] = tags.compute_event_tags(first_components[i], second_components[i]);
+        num_event_tags_set += __builtin_popcount(event_tags[i]);
+
+        values[i] = events.first_jet_m[i] / 1000.;
+        weights[i] = events.weight[i] * events.pileup_weight[i];
+    }
+
+    std::cout << "synthetic events: " << NUM_EVENTS << ", average event tags per event: "
+        << std::setprecision(2) << std::fixed << (double) num_event_tags_set / NUM_EVENTS << std::endl;
+    std::cout << "baseline selection implementation: " << simd_level_name(detect_simd_level()) << std::endl;
+    std::cout << std::endl;
+
+    /***********/
+    /* TH1Topo */
+    /***********/
+
+    TH1TopoStore store;
+    TH1Topo hist(&store, &tags, "first_jet_m", 0., 400., 10.);
+
+    benchmark(filter, "TH1Topo::fill_inclusive", NUM_EVENTS, [&] () {
+        for (size_t i = 0; i < NUM_EVENTS; i++)
+            hist.fill_inclusive(values[i], weights[i]);
+    });
+
+    benchmark(filter, "TH1Topo::fill_event_topo_tagged", NUM_EVENTS, [&] () {
+        for (size_t i = 0; i < NUM_EVENTS; i++)
+            hist.fill_event_topo_tagged(EventFlavorTopo::QuarkGluon, event_tags[i], values[i], weights[i]);
+    });
+
+    benchmark(filter, "TH1Topo::fill_jet_topo_tagged", NUM_EVENTS, [&] () {
+        for (size_t i = 0; i < NUM_EVENTS; i++)
+            hist.fill_jet_topo_tagged(JetTopo::Gluon, first_jet_tags[i], values[i], weights[i]);
+    });
+
+    /***********/
+    /* THnTopo */
+    /***********/
+
+    // the second axis is a function of the first, so the filled bins stay sparse
+    THnTopoStore sparse_store;
+    THnTopo sparse_hist(&sparse_store, &tags, "first_jet_D2_vs_m",
+            { { "first_jet_m", 0., 400., 10. }, { "first_jet_D2", 0., 5., 0.2 } });
+
+    std::vector<Double_t> sparse_values(2 * NUM_EVENTS);
+    for (size_t i = 0; i < NUM_EVENTS; i++) {
+        sparse_values[2 * i] = values[i];
+        sparse_values[2 * i + 1] = values[i] / 80.;
+    }
+
+    benchmark(filter, "THnTopo::fill_inclusive", NUM_EVENTS, [&] () {
+        for (size_t i = 0; i < NUM_EVENTS; i++)
+            sparse_hist.fill_inclusive(&sparse_values[2 * i], weights[i]);
+    });
+
+    benchmark(filter, "THnTopo::fill_jet_topo_tagged", NUM_EVENTS, [&] () {
+        for (size_t i = 0; i < NUM_EVENTS; i++)
+            sparse_hist.fill_jet_topo_tagged(JetTopo::Gluon, first_jet_tags[i], &sparse_values[2 * i], weights[i]);
+    });
+
+    /********/
+    /* TAGS */
+    /********/
+
+    benchmark(filter, "tags (components + jet + event masks)", NUM_EVENTS, [&] () {
+        for (size_t i = 0; i < NUM_EVENTS; i++) {
+            const UInt_t c1 = jet_tag_components(events.jet1_ungrtrk500[i] < ntrk_max,
+                    events.first_jet_passedWMassCut[i], events.first_jet_passedWSubstructure[i],
+                    events.first_jet_passedZMassCut[i], events.first_jet_passedZSubstructure[i]);
+            const UInt_t c2 = jet_tag_components(events.jet2_ungrtrk500[i] < ntrk_max,
+                    events.second_jet_passedWMassCut[i], events.second_jet_passedWSubstructure[i],
+                    events.second_jet_passedZMassCut[i], events.second_jet_passedZSubstructure[i]);
+
+            do_not_optimize(tags.compute_jet_tags(c1));
+            do_not_optimize(tags.compute_jet_tags(c2));
+            do_not_optimize(tags.compute_event_tags(c1, c2));
+        }
+    });
+
+    /**********************/
+    /* BASELINE SELECTION */
+    /**********************/
+
+    benchmark(filter, "CutProgram::passes", NUM_EVENTS, [&] () {
+        const Double_t* column_values[NUM_EVENT_COLUMNS];
+
+        for (size_t i = 0; i < NUM_EVENTS; i++) {
+#define VVJJ_COLUMN_VALUE(name) column_values[COL_##name] = events.name + i;
+            VVJJ_EVENT_COLUMNS(VVJJ_COLUMN_VALUE)
+#undef VVJJ_COLUMN_VALUE
+
+            do_not_optimize(program.passes(column_values));
+        }
+    });
+
+    benchmark(filter, "CutProgram::failed_cuts", NUM_EVENTS, [&] () {
+        const Double_t* column_values[NUM_EVENT_COLUMNS];
+
+        for (size_t i = 0; i < NUM_EVENTS; i++) {
+#define VVJJ_COLUMN_VALUE(name) column_values[COL_##name] = events.name + i;
+            VVJJ_EVENT_COLUMNS(VVJJ_COLUMN_VALUE)
+#undef VVJJ_COLUMN_VALUE
+
+            do_not_optimize(program.failed_cuts(column_values));
+        }
+    });
+
+    std::vector<UInt_t> survivors(DEFAULT_EVENT_BLOCK_SIZE);
+    std::vector<JetFlavor> first_flavors(DEFAULT_EVENT_BLOCK_SIZE), second_flavors(DEFAULT_EVENT_BLOCK_SIZE);
+    std::vector<CutMask> failed_cuts(DEFAULT_EVENT_BLOCK_SIZE);
+
+    const SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::SSE42, SimdLevel::AVX2, SimdLevel::AVX512};
+    for (SimdLevel level : levels) {
+        if (level > detect_simd_level()) continue;
+
+        benchmark(filter, std::string("select_baseline (") + simd_level_name(level) + ")", NUM_EVENTS, [&] () {
+            for (size_t first = 0; first < NUM_EVENTS; first += DEFAULT_EVENT_BLOCK_SIZE) {
+                EventBlock block = events;
+                block.size = DEFAULT_EVENT_BLOCK_SIZE;
+#define VVJJ_OFFSET_COLUMN(name) block.name += first;
+                VVJJ_EVENT_COLUMNS(VVJJ_OFFSET_COLUMN)
+#undef VVJJ_OFFSET_COLUMN
+
+                do_not_optimize(select_baseline(level, program, block, survivors.data(),
+                            first_flavors.data(), second_flavors.data(), failed_cuts.data()));
+            }
+        });
+    }
+
+    // as filled for every event of every block by ProcessBatch()
+    {
+        TH1TopoStore store;
+        CutFlow cut_flow(config.get_cuts(), &store, &tags);
+
+        std::vector<CutMask> event_failed_cuts(NUM_EVENTS);
+        const Double_t* columns[NUM_EVENT_COLUMNS];
+        for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+            columns[col] = events.column(static_cast<EventColumn>(col));
+        }
+
+        for (size_t i = 0; i < NUM_EVENTS; i++) {
+            const Double_t* column_values[NUM_EVENT_COLUMNS];
+            for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+                column_values[col] = columns[col] + i;
+            }
+            event_failed_cuts[i] = program.failed_cuts(column_values);
+        }
+
+        benchmark(filter, "CutFlow::fill", NUM_EVENTS, [&] () {
+            for (size_t i = 0; i < NUM_EVENTS; i++)
+                cut_flow.fill(event_failed_cuts[i], weights[i], columns, i);
+        });
+    }
+
+    /************/
+    /* SELECTOR */
+    /************/
+
+    VVJJFlavorSelector selector("bench.root", &config);
+    selector.print_progress = kFALSE;
+    selector.Begin(nullptr);
+
+    benchmark(filter, "VVJJFlavorSelector::ProcessBatch", NUM_EVENTS, [&] () {
+        for (size_t first = 0; first < NUM_EVENTS; first += DEFAULT_EVENT_BLOCK_SIZE) {
+            EventBlock block = events;
+            block.size = DEFAULT_EVENT_BLOCK_SIZE;
+#define VVJJ_OFFSET_COLUMN(name) block.name += first;
+            VVJJ_EVENT_COLUMNS(VVJJ_OFFSET_COLUMN)
+#undef VVJJ_OFFSET_COLUMN
+
+            selector.ProcessBatch(block);
+        }
+    });
+
+    /***********/
+    /* WRITING */
+    /***********/
+
+    // the filled TH1Topo of the selector, written to an in-memory file
+    benchmark(filter, "TH1Topo::write_all_histograms (all)", 1, [&] () {
+        TMemFile output_file("bench.root", "RECREATE");
+        selector.hist_sets[0]->write_all_histograms();
+        output_file.Close();
+    });
+
+    return 0;
+}
@@ -0,0 +1,348 @@
+#define BaselineSelection_cxx
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "BaselineSelection.h"
+
+static CutProgram::RejectOp
+reject_op(CutOp op)
+{
+    switch (op) {
+        case CutOp::Greater:      return CutProgram::RejectLessEqual;
+        case CutOp::GreaterEqual: return CutProgram::RejectLess;
+        case CutOp::Less:         return CutProgram::RejectGreaterEqual;
+        default:                  return CutProgram::RejectGreater;
+    }
+}
+
+// NOTE: the comparisons are ordered, so a NaN value never rejects an event.
+static inline bool
+rejects(CutProgram::RejectOp op, Double_t value, Double_t threshold)
+{
+    switch (op) {
+        case CutProgram::RejectLessEqual:    return value <= threshold;
+        case CutProgram::RejectLess:         return value < threshold;
+        case CutProgram::RejectGreaterEqual: return value >= threshold;
+        default:                             return value > threshold;
+    }
+}
+
+// Rewrite a cut on value / divisor as an equivalent cut on value alone.
+//
+// For a positive divisor the correctly rounded quotient is monotonic in
+// value, so the values rejected by e.g. value / divisor <= threshold are
+// exactly those below some boundary, which is found by stepping one ulp at
+// a time from threshold * divisor. This gives the same decision as the
+// division, bit for bit, at the cost of a single comparison. Returns false
+// (leaving inst untouched) if no such boundary is found.
+static bool
+fold_divisor(CutProgram::Instruction& inst)
+{
+    const Double_t x0 = inst.threshold * inst.divisor;
+    if (!(inst.divisor > 0) || !std::isfinite(x0) || !std::isfinite(inst.divisor))
+        return false;
+
+    auto rejected = [&inst] (Double_t x) {
+        return rejects(inst.reject_op, x / inst.divisor, inst.threshold);
+    };
+
+    // rejections below the boundary (<=, <) or above it (>=, >)
+    const bool reject_below = inst.reject_op == CutProgram::RejectLessEqual
+        || inst.reject_op == CutProgram::RejectLess;
+    const Double_t outwards = reject_below ? -INFINITY : INFINITY;
+    const Double_t inwards = -outwards;
+
+    // move to the first rejected value, then to the last one before the
+    // quotient crosses the threshold
+    Double_t x = x0;
+    for (int step = 0; !rejected(x); step++) {
+        if (step == 64) return false;
+        x = std::nextafter(x, outwards);
+    }
+    for (int step = 0; rejected(std::nextafter(x, inwards)); step++) {
+        if (step == 64) return false;
+        x = std::nextafter(x, inwards);
+    }
+
+    if (!std::isfinite(x)) return false;
+
+    inst.reject_op = reject_below ? CutProgram::RejectLessEqual : CutProgram::RejectGreaterEqual;
+    inst.divide = false;
+    inst.divisor = 1.;
+    inst.threshold = x;
+    return true;
+}
+
+CutProgram::CutProgram(const std::vector<Cut>& cuts)
+{
+    for (auto const& cut : cuts) {
+        Instruction inst;
+        inst.column = cut.column;
+        inst.reject_op = reject_op(cut.op);
+        inst.absolute = cut.absolute;
+        inst.divide = cut.divisor != 1.;
+        inst.divisor = cut.divisor;
+        inst.threshold = cut.threshold;
+
+        if (inst.divide)
+            fold_divisor(inst);
+
+        instructions.push_back(inst);
+    }
+}
+
+bool
+CutProgram::passes(const Double_t* const column_values[NUM_EVENT_COLUMNS]) const
+{
+    for (auto const& inst : instructions) {
+        Double_t value = *column_values[inst.column];
+        if (inst.absolute) value = std::abs(value);
+        if (inst.divide) value = value / inst.divisor;
+
+        if (rejects(inst.reject_op, value, inst.threshold))
+            return false;
+    }
+
+    return true;
+}
+
+CutMask
+CutProgram::failed_cuts(const Double_t* const column_values[NUM_EVENT_COLUMNS]) const
+{
+    CutMask failed = 0;
+
+    for (size_t k = 0; k < instructions.size(); k++) {
+        const Instruction& inst = instructions[k];
+
+        Double_t value = *column_values[inst.column];
+        if (inst.absolute) value = std::abs(value);
+        if (inst.divide) value = value / inst.divisor;
+
+        if (rejects(inst.reject_op, value, inst.threshold))
+            failed |= CutMask(1) << k;
+    }
+
+    return failed;
+}
+
+bool
+CutProgram::fails(size_t k, const Double_t* const column_values[NUM_EVENT_COLUMNS]) const
+{
+    const Instruction& inst = instructions[k];
+
+    Double_t value = *column_values[inst.column];
+    if (inst.absolute) value = std::abs(value);
+    if (inst.divide) value = value / inst.divisor;
+
+    return rejects(inst.reject_op, value, inst.threshold);
+}
+
+// Events are selected in chunks small enough for their rejection flags to
+// stay in L1 cache. Each instruction of the program is one tight loop over
+// the chunk, which the compiler vectorises for the instruction set of the
+// function it is inlined into (see the target attributes below).
+static const size_t SELECTION_CHUNK_SIZE = 128;
+
+template <CutProgram::RejectOp OP, bool ABSOLUTE, bool DIVIDE>
+__attribute__((always_inline)) static inline void
+reject_chunk(const Double_t* __restrict__ values, size_t count, Double_t divisor, Double_t threshold,
+        uint64_t cut_bit, uint64_t* __restrict__ reject)
+{
+    for (size_t i = 0; i < count; i++) {
+        Double_t value = values[i];
+        if (ABSOLUTE) value = std::abs(value);
+        if (DIVIDE) value = value / divisor;
+
+        bool r;
+        switch (OP) {
+            case CutProgram::RejectLessEqual:    r = value <= threshold; break;
+            case CutProgram::RejectLess:         r = value < threshold;  break;
+            case CutProgram::RejectGreaterEqual: r = value >= threshold; break;
+            default:                             r = value > threshold;  break;
+        }
+
+        reject[i] |= r ? cut_bit : uint64_t(0);
+    }
+}
+
+template <CutProgram::RejectOp OP>
+__attribute__((always_inline)) static inline void
+reject_chunk(const CutProgram::Instruction& inst, const Double_t* values, size_t count, uint64_t cut_bit,
+        uint64_t* reject)
+{
+    if (inst.absolute && inst.divide) {
+        reject_chunk<OP, true, true>(values, count, inst.divisor, inst.threshold, cut_bit, reject);
+    } else if (inst.absolute) {
+        reject_chunk<OP, true, false>(values, count, inst.divisor, inst.threshold, cut_bit, reject);
+    } else if (inst.divide) {
+        reject_chunk<OP, false, true>(values, count, inst.divisor, inst.threshold, cut_bit, reject);
+    } else {
+        reject_chunk<OP, false, false>(values, count, inst.divisor, inst.threshold, cut_bit, reject);
+    }
+}
+
+__attribute__((always_inline)) static inline size_t
+select_baseline_generic(const CutProgram& program, const EventBlock& b, UInt_t* survivors,
+        JetFlavor* first_jet_flavors, JetFlavor* second_jet_flavors, CutMask* failed_cuts)
+{
+    const Double_t* columns[NUM_EVENT_COLUMNS];
+
+#define VVJJ_COLUMN_POINTER(name) columns[COL_##name] = b.name;
+    VVJJ_EVENT_COLUMNS(VVJJ_COLUMN_POINTER)
+#undef VVJJ_COLUMN_POINTER
+
+    uint64_t reject[SELECTION_CHUNK_SIZE];
+    size_t num_survivors = 0;
+
+    for (size_t first = 0; first < b.size; first += SELECTION_CHUNK_SIZE) {
+        const size_t count = std::min(SELECTION_CHUNK_SIZE, b.size - first);
+
+        for (size_t i = 0; i < count; i++)
+            reject[i] = 0;
+
+        // The columns are walked one at a time rather than side by side, so
+        // help the hardware prefetcher when they are streamed from memory
+        // (e.g. from a mapped ColumnarDataset).
+        if (first + 2 * SELECTION_CHUNK_SIZE <= b.size) {
+            for (auto const& inst : program.get_instructions()) {
+                const Double_t* next = columns[inst.column] + first + SELECTION_CHUNK_SIZE;
+                for (size_t i = 0; i < SELECTION_CHUNK_SIZE; i += 64 / sizeof(Double_t))
+                    __builtin_prefetch(next + i);
+            }
+        }
+
+        const std::vector<CutProgram::Instruction>& instructions = program.get_instructions();
+
+        // each cut sets its own bit of the rejection flags
+        for (size_t k = 0; k < instructions.size(); k++) {
+            const CutProgram::Instruction& inst = instructions[k];
+            const Double_t* values = columns[inst.column] + first;
+            const uint64_t cut_bit = uint64_t(1) << k;
+
+            switch (inst.reject_op) {
+                case CutProgram::RejectLessEqual:
+                    reject_chunk<CutProgram::RejectLessEqual>(inst, values, count, cut_bit, reject);
+                    break;
+                case CutProgram::RejectLess:
+                    reject_chunk<CutProgram::RejectLess>(inst, values, count, cut_bit, reject);
+                    break;
+                case CutProgram::RejectGreaterEqual:
+                    reject_chunk<CutProgram::RejectGreaterEqual>(inst, values, count, cut_bit, reject);
+                    break;
+                default:
+                    reject_chunk<CutProgram::RejectGreater>(inst, values, count, cut_bit, reject);
+                    break;
+            }
+        }
+
+        if (failed_cuts != nullptr) {
+            for (size_t i = 0; i < count; i++)
+                failed_cuts[first + i] = reject[i];
+        }
+
+        // compact the indices of the surviving events without branching
+        const size_t chunk_first_survivor = num_survivors;
+        for (size_t i = 0; i < count; i++) {
+            survivors[num_survivors] = first + i;
+            num_survivors += reject[i] == 0;
+        }
+
+        // most events fail, so only the survivors have their jets classified
+        for (size_t k = chunk_first_survivor; k < num_survivors; k++) {
+            first_jet_flavors[k] = classify_jet_flavor(b.first_jet_pdgid[survivors[k]]);
+            second_jet_flavors[k] = classify_jet_flavor(b.second_jet_pdgid[survivors[k]]);
+        }
+    }
+
+    return num_survivors;
+}
+
+static size_t
+select_baseline_scalar(const CutProgram& program, const EventBlock& b, UInt_t* survivors,
+        JetFlavor* first_jet_flavors, JetFlavor* second_jet_flavors, CutMask* failed_cuts)
+{
+    return select_baseline_generic(program, b, survivors, first_jet_flavors, second_jet_flavors, failed_cuts);
+}
+
+// 64-bit lane masks need SSE4 to be vectorised
+__attribute__((target("sse4.2")))
+static size_t
+select_baseline_sse42(const CutProgram& program, const EventBlock& b, UInt_t* survivors,
+        JetFlavor* first_jet_flavors, JetFlavor* second_jet_flavors, CutMask* failed_cuts)
+{
+    return select_baseline_generic(program, b, survivors, first_jet_flavors, second_jet_flavors, failed_cuts);
+}
+
+__attribute__((target("avx2")))
+static size_t
+select_baseline_avx2(const CutProgram& program, const EventBlock& b, UInt_t* survivors,
+        JetFlavor* first_jet_flavors, JetFlavor* second_jet_flavors, CutMask* failed_cuts)
+{
+    return select_baseline_generic(program, b, survivors, first_jet_flavors, second_jet_flavors, failed_cuts);
+}
+
+__attribute__((target("avx512f")))
+static size_t
+select_baseline_avx512(const CutProgram& program, const EventBlock& b, UInt_t* survivors,
+        JetFlavor* first_jet_flavors, JetFlavor* second_jet_flavors, CutMask* failed_cuts)
+{
+    return select_baseline_generic(program, b, survivors, first_jet_flavors, second_jet_flavors, failed_cuts);
+}
+
+SimdLevel
+detect_simd_level(void)
+{
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::AVX512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    } else if (__builtin_cpu_supports("sse4.2")) {
+        return SimdLevel::SSE42;
+    } else {
+        return SimdLevel::Scalar;
+    }
+}
+
+const char*
+simd_level_name(SimdLevel level)
+{
+    switch (level) {
+        case SimdLevel::AVX512: return "AVX-512";
+        case SimdLevel::AVX2:   return "AVX2";
+        case SimdLevel::SSE42:  return "SSE4.2";
+        default:                return "scalar";
+    }
+}
+
+size_t
+select_baseline(SimdLevel level, const CutProgram& program, const EventBlock& block,
+        UInt_t* survivors, JetFlavor* first_jet_flavors, JetFlavor* second_jet_flavors,
+        CutMask* failed_cuts)
+{
+    switch (level) {
+        case SimdLevel::AVX512:
+            return select_baseline_avx512(program, block, survivors, first_jet_flavors, second_jet_flavors,
+                    failed_cuts);
+        case SimdLevel::AVX2:
+            return select_baseline_avx2(program, block, survivors, first_jet_flavors, second_jet_flavors,
+                    failed_cuts);
+        case SimdLevel::SSE42:
+            return select_baseline_sse42(program, block, survivors, first_jet_flavors, second_jet_flavors,
+                    failed_cuts);
+        default:
+            return select_baseline_scalar(program, block, survivors, first_jet_flavors, second_jet_flavors,
+                    failed_cuts);
+    }
+}
+
+size_t
+select_baseline(const CutProgram& program, const EventBlock& block, UInt_t* survivors,
+        JetFlavor* first_jet_flavors, JetFlavor* second_jet_flavors, CutMask* failed_cuts)
+{
+    static const SimdLevel level = detect_simd_level();
+    return select_baseline(level, program, block, survivors, first_jet_flavors, second_jet_flavors, failed_cuts);
+}
@@ -0,0 +1,126 @@
+#ifndef BaselineSelection_h
+#define BaselineSelection_h
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include <Rtypes.h>
+
+#include "EventBlock.h"
+
+// Flavor of a large-R jet, from the pdgid of the parton it is matched to.
+enum JetFlavor : UChar_t {
+    FlavorOther,
+    FlavorQuark,
+    FlavorGluon
+};
+
+inline JetFlavor
+classify_jet_flavor(Double_t pdgid)
+{
+    if (pdgid >= 1 && pdgid <= 6) {
+        return FlavorQuark;
+    } else if (pdgid == 21) {
+        return FlavorGluon;
+    } else {
+        return FlavorOther;
+    }
+}
+
+enum class CutOp : UInt_t {
+    Greater,
+    GreaterEqual,
+    Less,
+    LessEqual
+};
+
+// One requirement of the baseline selection: (|x| if absolute, else x) /
+// divisor <op> threshold, where x is the value of column. The divisor is
+// e.g. 1000 to express a cut on a MeV column in GeV.
+struct Cut {
+    EventColumn column;
+    bool absolute;
+    CutOp op;
+    Double_t divisor;
+    Double_t threshold;
+};
+
+// The cuts of a CutProgram an event fails, one bit per cut in program order.
+typedef UInt_t CutMask;
+
+// The baseline event selection, compiled from a list of Cuts into a flat
+// program that is evaluated one cut at a time over whole blocks of events.
+//
+// NOTE: each cut is evaluated as a rejection (e.g. x <= 450 for the
+// requirement x > 450) so that, as in the original hand-written selection,
+// NaN inputs never cause an event to be rejected.
+class CutProgram {
+    public:
+        static const UInt_t MAX_CUTS = 8 * sizeof(CutMask);
+
+        enum RejectOp : UInt_t {
+            RejectLessEqual,     // requirement >
+            RejectLess,          // requirement >=
+            RejectGreaterEqual,  // requirement <
+            RejectGreater        // requirement <=
+        };
+
+        struct Instruction {
+            UInt_t column;
+            RejectOp reject_op;
+            bool absolute;
+            bool divide;
+            Double_t divisor;
+            Double_t threshold;
+        };
+
+    private:
+        std::vector<Instruction> instructions;
+
+    public:
+        CutProgram(void) { }
+        explicit CutProgram(const std::vector<Cut>& cuts);
+
+        const std::vector<Instruction>& get_instructions(void) const { return instructions; }
+
+        // evaluate the selection for a single event, given the address of
+        // the value of every column
+        bool passes(const Double_t* const column_values[NUM_EVENT_COLUMNS]) const;
+
+        // same as passes(), but evaluates every cut instead of stopping at
+        // the first one failed
+        CutMask failed_cuts(const Double_t* const column_values[NUM_EVENT_COLUMNS]) const;
+
+        // whether the event fails cut k alone, which only reads its column
+        bool fails(size_t k, const Double_t* const column_values[NUM_EVENT_COLUMNS]) const;
+};
+
+enum class SimdLevel {
+    Scalar,
+    SSE42,
+    AVX2,
+    AVX512
+};
+
+// the widest instruction set supported by the CPU we are running on
+SimdLevel detect_simd_level(void);
+const char* simd_level_name(SimdLevel level);
+
+// Evaluate the baseline selection over a whole block of events.
+//
+// The indices (within the block) of the events passing the selection are
+// written, in order, to survivors, along with the flavor of both of their
+// jets. If failed_cuts is not null, the cuts failed by every event of the
+// block are written to it as well. Every output array must have room for
+// block.size elements. Returns the number of surviving events.
+size_t select_baseline(const CutProgram& program, const EventBlock& block, UInt_t* survivors,
+        JetFlavor* first_jet_flavors, JetFlavor* second_jet_flavors, CutMask* failed_cuts = nullptr);
+
+// same as above, but with an explicitly chosen implementation (which must
+// be supported by the CPU)
+size_t select_baseline(SimdLevel level, const CutProgram& program, const EventBlock& block,
+        UInt_t* survivors, JetFlavor* first_jet_flavors, JetFlavor* second_jet_flavors,
+        CutMask* failed_cuts = nullptr);
+
+#endif // #ifdef BaselineSelection_h
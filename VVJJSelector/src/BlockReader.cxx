@@ -0,0 +1,143 @@
+#define BlockReader_cxx
+
+#include <RVersion.h>
+#include <TMath.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "BlockReader.h"
+
+// the bulk API returns baskets in ROOT's serialized, big-endian format
+static inline Double_t
+load_big_endian_double(const char* src)
+{
+    uint64_t bits;
+    std::memcpy(&bits, src, sizeof(bits));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    bits = __builtin_bswap64(bits);
+#endif
+    Double_t value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+BlockReader::BlockReader(TTree* tree_) :
+    tree(tree_),
+    basket_buffer(new TBufferFile(TBuffer::kWrite, 32 * 1024))
+{
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        branches[col] = tree->GetBranch(EVENT_COLUMN_NAMES[col]);
+        fallback_values[col] = 0;
+
+        if (branches[col] == nullptr) {
+            std::cout << "ERROR: missing branch in input tree: " << EVENT_COLUMN_NAMES[col] << std::endl;
+        }
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,14,0)
+        use_bulk_read[col] = true;
+#else
+        use_bulk_read[col] = false;
+#endif
+    }
+}
+
+Long64_t
+BlockReader::read_column_bulk(int col, Long64_t first, Long64_t count, Double_t* dest)
+{
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,14,0)
+    TBranch* branch = branches[col];
+    Long64_t num_read = 0;
+
+    while (num_read < count) {
+        const Long64_t entry = first + num_read;
+
+        // baskets can only be requested from their first entry
+        const Long64_t basket = TMath::BinarySearch(branch->GetWriteBasket() + 1,
+                branch->GetBasketEntry(), entry);
+        const Long64_t basket_first = branch->GetBasketEntry()[basket];
+
+        const Int_t basket_entries = branch->GetBulkRead().GetEntriesSerialized(basket_first, *basket_buffer);
+        if (basket_entries <= 0) break;
+
+        const Long64_t offset = entry - basket_first;
+        const Long64_t num_copy = std::min(basket_entries - offset, count - num_read);
+        const char* src = basket_buffer->GetCurrent() + offset * sizeof(Double_t);
+
+        for (Long64_t i = 0; i < num_copy; i++) {
+            dest[num_read + i] = load_big_endian_double(src + i * sizeof(Double_t));
+        }
+
+        num_read += num_copy;
+    }
+
+    return num_read;
+#else
+    (void) col; (void) first; (void) count; (void) dest;
+    return 0;
+#endif
+}
+
+void
+BlockReader::read_column_entries(int col, Long64_t first, Long64_t count, Double_t* dest)
+{
+    TBranch* branch = branches[col];
+
+    // read through whatever address the branch is already bound to (e.g. a
+    // selector member after Init()), or bind it to our own scratch value
+    if (branch->GetAddress() == nullptr)
+        branch->SetAddress(&fallback_values[col]);
+
+    const Double_t* value = reinterpret_cast<const Double_t*>(branch->GetAddress());
+
+    for (Long64_t i = 0; i < count; i++) {
+        branch->GetEntry(first + i);
+        dest[i] = *value;
+    }
+}
+
+size_t
+BlockReader::read(Long64_t first, Long64_t last, EventBlockBuffer& buffer)
+{
+    const Long64_t count = std::min<Long64_t>(last - first, buffer.capacity);
+
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        Double_t* dest = buffer.column(static_cast<EventColumn>(col));
+
+        if (branches[col] == nullptr) {
+            buffer.size = 0;
+            return 0;
+        }
+
+        Long64_t num_read = 0;
+        if (use_bulk_read[col]) {
+            num_read = read_column_bulk(col, first, count, dest);
+
+            if (num_read < count) {
+                // e.g. a branch with a streamer the bulk API does not support
+                std::cout << "WARNING: bulk read failed for branch " << EVENT_COLUMN_NAMES[col]
+                    << ", falling back to entry-by-entry reading" << std::endl;
+                use_bulk_read[col] = false;
+            }
+        }
+
+        if (num_read < count) {
+            read_column_entries(col, first + num_read, count - num_read, dest + num_read);
+        }
+    }
+
+    buffer.size = count;
+    return count;
+}
+
+void
+BlockReader::column_bytes(TTree* tree, Long64_t* compressed_bytes, Long64_t* uncompressed_bytes)
+{
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        TBranch* branch = tree->GetBranch(EVENT_COLUMN_NAMES[col]);
+        compressed_bytes[col] = branch ? branch->GetZipBytes() : 0;
+        uncompressed_bytes[col] = branch ? branch->GetTotBytes() : 0;
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef BlockReader_h
+#define BlockReader_h
+
+#include <memory>
+
+#include <TBranch.h>
+#include <TBufferFile.h>
+#include <TTree.h>
+
+#include "EventBlock.h"
+
+// Reads consecutive entries of the VVJJ_EVENT_COLUMNS branches of a single
+// TTree into an EventBlockBuffer, one column at a time.
+//
+// With ROOT >= 6.14 the columns are filled from whole baskets through the
+// bulk read API (TBranch::GetBulkRead), which avoids the per-entry TBranch
+// overhead of GetEntry. Branches the bulk API cannot serve fall back to
+// reading entry by entry.
+class BlockReader {
+    private:
+        TTree* tree;
+        TBranch* branches[NUM_EVENT_COLUMNS];
+
+        // destination of the per-entry fallback for unbound branches
+        Double_t fallback_values[NUM_EVENT_COLUMNS];
+        bool use_bulk_read[NUM_EVENT_COLUMNS];
+
+        std::unique_ptr<TBufferFile> basket_buffer;
+
+        Long64_t read_column_bulk(int col, Long64_t first, Long64_t count, Double_t* dest);
+        void read_column_entries(int col, Long64_t first, Long64_t count, Double_t* dest);
+
+    public:
+        explicit BlockReader(TTree* tree_);
+
+        // read entries [first, last) of the tree, up to the buffer capacity,
+        // returns the number of entries read, 0 if a column can't be read
+        // (i.e. its branch is missing from the tree)
+        size_t read(Long64_t first, Long64_t last, EventBlockBuffer& buffer);
+
+        // the compressed/uncompressed size of each event column of tree
+        static void column_bytes(TTree* tree, Long64_t* compressed_bytes, Long64_t* uncompressed_bytes);
+};
+
+#endif // #ifdef BlockReader_h
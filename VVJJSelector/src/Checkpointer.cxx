@@ -0,0 +1,224 @@
+#define Checkpointer_cxx
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "Checkpointer.h"
+#include "StateIO.h"
+#include "VVJJFlavorSelector.h"
+
+// checkpoint files start with CHECKPOINT_MAGIC, the format version, the
+// chain hash and the entry to resume from, followed by the selector state
+static const char CHECKPOINT_MAGIC[8] = { 'V', 'V', 'J', 'J', 'C', 'K', 'P', 'T' };
+static const UInt_t CHECKPOINT_FORMAT_VERSION = 1;
+
+Checkpointer::Checkpointer(std::string path_, ULong64_t chain_hash_, double interval_seconds) :
+    path(path_),
+    chain_hash(chain_hash_),
+    interval(std::chrono::duration_cast<RunClock::duration>(std::chrono::duration<double>(interval_seconds))),
+    next_due(RunStats::now() + interval),
+    pending(false),
+    stopping(false),
+    write_failed(false)
+{
+    writer = std::thread(&Checkpointer::run_writer, this);
+}
+
+Checkpointer::~Checkpointer(void)
+{
+    if (!writer.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cond.notify_one();
+    writer.join();
+}
+
+ULong64_t
+Checkpointer::hash_chain(TChain* chain)
+{
+    ULong64_t hash = 0xcbf29ce484222325ULL;
+    auto add = [&hash] (const char* data, size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 0x100000001b3ULL;
+        }
+    };
+
+    TObjArray* files = chain->GetListOfFiles();
+    for (Int_t i = 0; i < files->GetEntries(); i++) {
+        const char* file_path = files->At(i)->GetTitle();
+        add(file_path, std::strlen(file_path) + 1);
+    }
+
+    const Long64_t num_entries = chain->GetEntries();
+    add(reinterpret_cast<const char*>(&num_entries), sizeof(num_entries));
+
+    return hash;
+}
+
+Long64_t
+Checkpointer::load(const SelectionConfig* config)
+{
+    loaded_state.clear();
+
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in.is_open())
+        return 0;
+
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    UInt_t version;
+    ULong64_t file_chain_hash;
+    Long64_t next_entry;
+
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0
+            || !read_state_value(in, version) || version != CHECKPOINT_FORMAT_VERSION
+            || !read_state_value(in, file_chain_hash) || !read_state_value(in, next_entry)) {
+        std::cout << "ERROR: unreadable checkpoint, delete it to start over: " << path << std::endl;
+        return -1;
+    }
+
+    if (file_chain_hash != chain_hash) {
+        std::cout << "NOTE: ignoring the checkpoint of another input file list: " << path << std::endl;
+        return 0;
+    }
+
+    std::stringstream ss;
+    ss << in.rdbuf();
+    loaded_state = ss.str();
+
+    // make sure the state can be restored before the event loop starts
+    VVJJFlavorSelector probe("", config);
+    probe.Begin(nullptr);
+
+    std::istringstream state(loaded_state);
+    if (!probe.add_state(state, path)) {
+        std::cout << "ERROR: unusable checkpoint, delete it to start over: " << path << std::endl;
+        loaded_state.clear();
+        return -1;
+    }
+
+    return next_entry;
+}
+
+bool
+Checkpointer::restore(VVJJFlavorSelector& selector)
+{
+    std::istringstream state(loaded_state);
+    const bool ok = selector.add_state(state, path);
+
+    loaded_state.clear();
+    loaded_state.shrink_to_fit();
+
+    return ok;
+}
+
+void
+Checkpointer::snapshot(const VVJJFlavorSelector& selector, Long64_t next_entry)
+{
+    // never wait for the writer, try again at the next opportunity instead
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending) return;
+    }
+
+    std::ostringstream out(std::ios::binary);
+    out.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    write_state_value(out, CHECKPOINT_FORMAT_VERSION);
+    write_state_value(out, chain_hash);
+    write_state_value(out, next_entry);
+    selector.write_state(out);
+
+    front = out.str();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        front.swap(back);
+        pending = true;
+    }
+    cond.notify_one();
+
+    next_due = RunStats::now() + interval;
+}
+
+bool
+Checkpointer::write_file(const std::string& snapshot) const
+{
+    const std::string tmp_path = path + ".tmp";
+
+    const int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+
+    const char* data = snapshot.data();
+    size_t remaining = snapshot.size();
+
+    while (remaining > 0) {
+        const ssize_t written = ::write(fd, data, remaining);
+        if (written < 0) {
+            ::close(fd);
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+
+        data += written;
+        remaining -= written;
+    }
+
+    // the rename must not reach the disk before the contents
+    const bool synced = ::fsync(fd) == 0;
+    ::close(fd);
+
+    if (!synced || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+void
+Checkpointer::run_writer(void)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        cond.wait(lock, [this] { return pending || stopping; });
+        if (!pending) break;
+
+        // back belongs to this thread until pending is cleared
+        lock.unlock();
+        const bool ok = write_file(back);
+        lock.lock();
+
+        if (!ok && !write_failed) {
+            std::cout << "WARNING: failed to write checkpoint: " << path << std::endl;
+            write_failed = true;
+        }
+
+        pending = false;
+    }
+}
+
+void
+Checkpointer::finish(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cond.notify_one();
+
+    if (writer.joinable())
+        writer.join();
+
+    std::remove(path.c_str());
+}
@@ -0,0 +1,85 @@
+#ifndef Checkpointer_h
+#define Checkpointer_h
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <Rtypes.h>
+#include <TChain.h>
+
+#include "RunStats.h"
+#include "SelectionConfig.h"
+
+class VVJJFlavorSelector;
+
+// Periodic checkpoints of a sequential event loop, so that an interrupted
+// run can resume where it left off.
+//
+// A checkpoint is the state of the selector (see
+// VVJJFlavorSelector::write_state()) along with the chain entry to resume
+// from, in a side file identified by a hash of the chain. Snapshots are
+// serialized into memory on the event loop thread, then handed over (double
+// buffered) to a background thread that writes them to a temporary file,
+// syncs it and renames it into place, so the side file always holds a
+// complete checkpoint. A snapshot that comes due while the previous one is
+// still being written is put off rather than waited for.
+class Checkpointer {
+    private:
+        const std::string path;
+        const ULong64_t chain_hash;
+        const RunClock::duration interval;
+
+        RunClock::time_point next_due;
+
+        // the snapshot being filled by the event loop, and the one owned by
+        // the writer thread while pending is set
+        std::string front;
+        std::string back;
+
+        // the checkpoint read by load(), until restore()
+        std::string loaded_state;
+
+        std::mutex mutex;
+        std::condition_variable cond;
+        bool pending;
+        bool stopping;
+        bool write_failed;
+        std::thread writer;
+
+        void run_writer(void);
+        bool write_file(const std::string& snapshot) const;
+
+    public:
+        Checkpointer(std::string path_, ULong64_t chain_hash_, double interval_seconds);
+        ~Checkpointer(void);
+
+        Checkpointer(const Checkpointer&) = delete;
+        Checkpointer& operator=(const Checkpointer&) = delete;
+
+        // identifies the files (and entries) of a chain
+        static ULong64_t hash_chain(TChain* chain);
+
+        // Read the side file, if any. Returns the chain entry to resume from,
+        // 0 if there is no checkpoint (or one of another chain), or -1 if
+        // the checkpoint is unreadable or was saved with another config.
+        Long64_t load(const SelectionConfig* config);
+
+        // whether load() found a checkpoint to restore
+        bool resuming(void) const { return !loaded_state.empty(); }
+
+        // add the loaded checkpoint to selector, after its Begin()
+        bool restore(VVJJFlavorSelector& selector);
+
+        bool due(void) const { return RunStats::now() >= next_due; }
+
+        // snapshot selector, which has processed every entry before next_entry
+        void snapshot(const VVJJFlavorSelector& selector, Long64_t next_entry);
+
+        // wait for the writer and remove the side file, once the output is written
+        void finish(void);
+};
+
+#endif // #ifdef Checkpointer_h
@@ -0,0 +1,367 @@
+#define ColumnarDataset_cxx
+
+#include <TSystem.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#ifdef VVJJ_WITH_LZ4
+#include <lz4.h>
+#endif
+
+#include "BlockReader.h"
+#include "ColumnarDataset.h"
+
+static const int COLUMNAR_FORMAT_VERSION = 1;
+
+static const char*
+native_byte_order(void)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return "little";
+#else
+    return "big";
+#endif
+}
+
+static std::string
+manifest_path(const std::string& dir)
+{
+    return dir + "/manifest";
+}
+
+static std::string
+column_path(const std::string& dir, int col)
+{
+    return dir + "/" + EVENT_COLUMN_NAMES[col] + ".col";
+}
+
+ColumnarDataset::ColumnarDataset(void) :
+    num_entries(0),
+    block_size(DEFAULT_EVENT_BLOCK_SIZE),
+    encoding(ColumnEncoding::Raw)
+{
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        columns[col].data = nullptr;
+        columns[col].length = 0;
+    }
+}
+
+ColumnarDataset::~ColumnarDataset(void)
+{
+    unmap_columns();
+}
+
+bool
+ColumnarDataset::is_columnar(const std::string& path)
+{
+    struct stat info;
+    return stat(manifest_path(path).c_str(), &info) == 0 && S_ISREG(info.st_mode);
+}
+
+size_t
+ColumnarDataset::get_num_blocks(void) const
+{
+    return (num_entries + block_size - 1) / block_size;
+}
+
+bool
+ColumnarDataset::map_column(int col)
+{
+    const std::string file_path = column_path(path, col);
+
+    const int fd = ::open(file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cout << "ERROR: failed to open column file: " << file_path << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    const size_t length = info.st_size;
+    void* data = nullptr;
+
+    if (length > 0) {
+        data = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            std::cout << "ERROR: failed to mmap column file: " << file_path << std::endl;
+            ::close(fd);
+            return false;
+        }
+
+        // every column is streamed through exactly once
+        madvise(data, length, MADV_SEQUENTIAL);
+    }
+
+    // the mapping stays valid after the file is closed
+    ::close(fd);
+
+    columns[col].data = static_cast<const char*>(data);
+    columns[col].length = length;
+
+    // make sure the file holds what the manifest promises
+    size_t expected_length;
+    if (encoding == ColumnEncoding::Raw) {
+        expected_length = num_entries * sizeof(Double_t);
+    } else {
+        // the block offset table: the blocks follow it back to back, each
+        // small enough for LZ4 (whose sizes are ints)
+        const size_t table_length = (get_num_blocks() + 1) * sizeof(uint64_t);
+        uint64_t offset = table_length;
+        bool table_ok = length >= table_length;
+
+        for (size_t iblock = 0; table_ok && iblock <= get_num_blocks(); iblock++) {
+            uint64_t next_offset;
+            std::memcpy(&next_offset, columns[col].data + iblock * sizeof(uint64_t), sizeof(uint64_t));
+
+            table_ok = next_offset >= offset && next_offset - offset <= INT_MAX
+                && (iblock > 0 || next_offset == table_length);
+            offset = next_offset;
+        }
+
+        expected_length = table_ok ? offset : 0;
+    }
+
+    if (length != expected_length) {
+        std::cout << "ERROR: truncated or corrupt column file: " << file_path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void
+ColumnarDataset::unmap_columns(void)
+{
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        if (columns[col].data != nullptr)
+            munmap(const_cast<char*>(columns[col].data), columns[col].length);
+
+        columns[col].data = nullptr;
+        columns[col].length = 0;
+    }
+}
+
+bool
+ColumnarDataset::open(const std::string& path_)
+{
+    unmap_columns();
+    path = path_;
+
+    std::ifstream manifest(manifest_path(path).c_str());
+    if (!manifest.is_open()) {
+        std::cout << "ERROR: failed to open columnar dataset manifest: " << manifest_path(path) << std::endl;
+        return false;
+    }
+
+    std::string key, value;
+    int version = 0;
+    std::string byte_order;
+    std::vector<std::string> column_names;
+
+    while (manifest >> key >> value) {
+        if (key == "vvjj_columnar") {
+            version = std::stoi(value);
+        } else if (key == "num_entries") {
+            num_entries = std::stoll(value);
+        } else if (key == "block_size") {
+            block_size = std::stoul(value);
+        } else if (key == "byte_order") {
+            byte_order = value;
+        } else if (key == "encoding") {
+            encoding = value == "lz4" ? ColumnEncoding::LZ4 : ColumnEncoding::Raw;
+        } else if (key == "column") {
+            column_names.push_back(value);
+        }
+    }
+
+    if (version != COLUMNAR_FORMAT_VERSION || byte_order != native_byte_order() || block_size == 0) {
+        std::cout << "ERROR: unsupported columnar dataset: " << path << std::endl;
+        return false;
+    }
+
+#ifndef VVJJ_WITH_LZ4
+    if (encoding == ColumnEncoding::LZ4) {
+        std::cout << "ERROR: columnar dataset " << path
+            << " is LZ4-compressed, rebuild with WITH_LZ4=1 to read it" << std::endl;
+        return false;
+    }
+#endif
+
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        bool found = false;
+        for (auto const& name : column_names)
+            found = found || name == EVENT_COLUMN_NAMES[col];
+
+        if (!found) {
+            std::cout << "ERROR: columnar dataset " << path << " has no column "
+                << EVENT_COLUMN_NAMES[col] << std::endl;
+            return false;
+        }
+
+        if (!map_column(col))
+            return false;
+    }
+
+    return true;
+}
+
+bool
+ColumnarDataset::read_block(size_t iblock, EventBlockBuffer& scratch, EventBlock& block) const
+{
+    const Long64_t first = iblock * block_size;
+    const size_t count = std::min<Long64_t>(block_size, num_entries - first);
+
+    const Double_t* column_data[NUM_EVENT_COLUMNS];
+#ifndef VVJJ_WITH_LZ4
+    (void) scratch;
+#endif
+
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        if (encoding == ColumnEncoding::Raw) {
+            column_data[col] = reinterpret_cast<const Double_t*>(columns[col].data) + first;
+            continue;
+        }
+
+#ifdef VVJJ_WITH_LZ4
+        uint64_t offsets[2];
+        std::memcpy(offsets, columns[col].data + iblock * sizeof(uint64_t), sizeof(offsets));
+
+        // checked by map_column(), but never read past the mapping
+        const bool offsets_ok = offsets[0] <= offsets[1] && offsets[1] <= columns[col].length
+            && offsets[1] - offsets[0] <= INT_MAX;
+
+        Double_t* dest = scratch.column(static_cast<EventColumn>(col));
+        const int num_bytes = !offsets_ok ? -1
+            : LZ4_decompress_safe(columns[col].data + offsets[0], reinterpret_cast<char*>(dest),
+                    offsets[1] - offsets[0], scratch.capacity * sizeof(Double_t));
+
+        if (num_bytes != static_cast<int>(count * sizeof(Double_t))) {
+            std::cout << "ERROR: corrupt block " << iblock << " of column " << EVENT_COLUMN_NAMES[col]
+                << " in " << path << std::endl;
+            return false;
+        }
+
+        column_data[col] = dest;
+#endif
+    }
+
+    block.size = count;
+
+#define VVJJ_COLUMN_VIEW(name) block.name = column_data[COL_##name];
+    VVJJ_EVENT_COLUMNS(VVJJ_COLUMN_VIEW)
+#undef VVJJ_COLUMN_VIEW
+
+    return true;
+}
+
+bool
+write_columnar_dataset(TTree* tree, const std::string& dir, ColumnEncoding encoding, size_t block_size)
+{
+#ifndef VVJJ_WITH_LZ4
+    if (encoding == ColumnEncoding::LZ4) {
+        std::cout << "ERROR: LZ4 columnar output requires building with WITH_LZ4=1" << std::endl;
+        return false;
+    }
+#endif
+
+    gSystem->mkdir(dir.c_str(), kTRUE);
+
+    // an existing dataset is only valid again once its new manifest is written
+    std::remove(manifest_path(dir).c_str());
+
+    const Long64_t num_entries = tree->GetEntries();
+    const size_t num_blocks = (num_entries + block_size - 1) / block_size;
+
+    std::FILE* files[NUM_EVENT_COLUMNS];
+    std::vector<uint64_t> offsets[NUM_EVENT_COLUMNS];
+    bool ok = true;
+
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        files[col] = std::fopen(column_path(dir, col).c_str(), "wb");
+        ok = ok && files[col] != nullptr;
+
+        // reserve the block offset table, filled in once all blocks are written
+        if (files[col] != nullptr && encoding == ColumnEncoding::LZ4) {
+            offsets[col].assign(num_blocks + 1, 0);
+            offsets[col][0] = offsets[col].size() * sizeof(uint64_t);
+            std::fwrite(offsets[col].data(), sizeof(uint64_t), offsets[col].size(), files[col]);
+        }
+    }
+
+    BlockReader reader(tree);
+    EventBlockBuffer buffer(block_size);
+    std::vector<char> compressed;
+
+    for (size_t iblock = 0; ok && iblock < num_blocks; iblock++) {
+        const Long64_t first = iblock * block_size;
+        ok = reader.read(first, num_entries, buffer) > 0;
+
+        for (int col = 0; ok && col < NUM_EVENT_COLUMNS; col++) {
+            const Double_t* values = buffer.column(static_cast<EventColumn>(col));
+
+            if (encoding == ColumnEncoding::Raw) {
+                ok = std::fwrite(values, sizeof(Double_t), buffer.size, files[col]) == buffer.size;
+                continue;
+            }
+
+#ifdef VVJJ_WITH_LZ4
+            const int num_bytes = buffer.size * sizeof(Double_t);
+            compressed.resize(LZ4_compressBound(num_bytes));
+
+            const int num_compressed = LZ4_compress_default(reinterpret_cast<const char*>(values),
+                    compressed.data(), num_bytes, compressed.size());
+
+            ok = num_compressed > 0
+                && std::fwrite(compressed.data(), 1, num_compressed, files[col]) == static_cast<size_t>(num_compressed);
+            offsets[col][iblock + 1] = offsets[col][iblock] + num_compressed;
+#endif
+        }
+    }
+
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        if (files[col] == nullptr) continue;
+
+        if (ok && encoding == ColumnEncoding::LZ4) {
+            ok = std::fseek(files[col], 0, SEEK_SET) == 0
+                && std::fwrite(offsets[col].data(), sizeof(uint64_t), offsets[col].size(), files[col]) == offsets[col].size();
+        }
+
+        ok = (std::fclose(files[col]) == 0) && ok;
+    }
+
+    if (!ok) {
+        std::cout << "ERROR: failed to write columnar dataset: " << dir << std::endl;
+        return false;
+    }
+
+    const std::string tmp_path = manifest_path(dir) + ".tmp";
+    std::ofstream manifest(tmp_path.c_str());
+
+    manifest << "vvjj_columnar " << COLUMNAR_FORMAT_VERSION << std::endl;
+    manifest << "num_entries " << num_entries << std::endl;
+    manifest << "block_size " << block_size << std::endl;
+    manifest << "byte_order " << native_byte_order() << std::endl;
+    manifest << "encoding " << (encoding == ColumnEncoding::LZ4 ? "lz4" : "raw") << std::endl;
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        manifest << "column " << EVENT_COLUMN_NAMES[col] << std::endl;
+    }
+    manifest.close();
+
+    return !manifest.fail() && std::rename(tmp_path.c_str(), manifest_path(dir).c_str()) == 0;
+}
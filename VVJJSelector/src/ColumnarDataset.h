@@ -0,0 +1,80 @@
+#ifndef ColumnarDataset_h
+#define ColumnarDataset_h
+
+#include <cstddef>
+#include <string>
+
+#include <Rtypes.h>
+#include <TTree.h>
+
+#include "EventBlock.h"
+
+// A native, column-per-file copy of the VVJJ_EVENT_COLUMNS of a Nominal tree.
+//
+// A dataset is a directory holding one <column>.col file per column and a
+// plain text "manifest" (format version, number of entries, block size,
+// encoding and column names), which is written last and so also marks the
+// conversion as complete. Columns are either stored raw, as native-endian
+// Double_t arrays, or (when built with VVJJ_WITH_LZ4) as LZ4-compressed
+// blocks of block_size entries preceded by a table of their file offsets.
+//
+// Column files are mmap'ed read-only and shared, so concurrent jobs reading
+// the same dataset share its pages in the page cache. Raw blocks are handed
+// out as EventBlock views pointing straight into the mapping.
+enum class ColumnEncoding {
+    Raw,
+    LZ4
+};
+
+class ColumnarDataset {
+    private:
+        struct MappedColumn {
+            const char* data;
+            size_t length;
+        };
+
+        std::string path;
+        Long64_t num_entries;
+        size_t block_size;
+        ColumnEncoding encoding;
+
+        MappedColumn columns[NUM_EVENT_COLUMNS];
+
+        bool map_column(int col);
+        void unmap_columns(void);
+
+    public:
+        ColumnarDataset(void);
+        ~ColumnarDataset(void);
+
+        ColumnarDataset(const ColumnarDataset&) = delete;
+        ColumnarDataset& operator=(const ColumnarDataset&) = delete;
+
+        // true if path is a (complete) columnar dataset directory
+        static bool is_columnar(const std::string& path);
+
+        // map every column of the dataset at path, returns false on failure
+        bool open(const std::string& path_);
+
+        const std::string& get_path(void) const { return path; }
+        Long64_t get_num_entries(void) const { return num_entries; }
+        size_t get_block_size(void) const { return block_size; }
+        size_t get_num_blocks(void) const;
+
+        // size of the mapped file of a column
+        size_t get_column_bytes(int col) const { return columns[col].length; }
+
+        // View of block iblock (entries [iblock * block_size, ...) of the
+        // dataset). Compressed columns are decoded into scratch, which must
+        // have a capacity of at least block_size; raw columns are not copied.
+        // The view is valid until scratch is reused or the dataset closed.
+        // Returns false if a column of the block can't be decoded.
+        bool read_block(size_t iblock, EventBlockBuffer& scratch, EventBlock& block) const;
+};
+
+// Convert the VVJJ_EVENT_COLUMNS of tree into a columnar dataset in the
+// directory dir (created if needed). Returns false on failure.
+bool write_columnar_dataset(TTree* tree, const std::string& dir, ColumnEncoding encoding,
+        size_t block_size = DEFAULT_EVENT_BLOCK_SIZE);
+
+#endif // #ifdef ColumnarDataset_h
@@ -0,0 +1,126 @@
+#define ColumnarProcessor_cxx
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+#include "ColumnarProcessor.h"
+#include "ParallelProcessor.h"
+
+ColumnarProcessor::ColumnarProcessor(unsigned num_threads_) :
+    num_threads(num_threads_ > 0 ? num_threads_ : 1),
+    num_entries(0),
+    next_block(0),
+    num_entries_done(0),
+    failed(false)
+{ }
+
+bool
+ColumnarProcessor::add(const std::string& path)
+{
+    std::unique_ptr<ColumnarDataset> dataset(new ColumnarDataset());
+
+    if (!dataset->open(path))
+        return false;
+
+    for (size_t iblock = 0; iblock < dataset->get_num_blocks(); iblock++) {
+        BlockRef ref;
+        ref.dataset = datasets.size();
+        ref.block = iblock;
+        blocks.push_back(ref);
+    }
+
+    num_entries += dataset->get_num_entries();
+    datasets.push_back(std::move(dataset));
+
+    return true;
+}
+
+void
+ColumnarProcessor::run_worker(VVJJFlavorSelector* worker)
+{
+    // only used for compressed datasets, raw blocks are read in place
+    size_t max_block_size = 0;
+    for (auto const& dataset : datasets) {
+        max_block_size = std::max(max_block_size, dataset->get_block_size());
+    }
+
+    EventBlockBuffer scratch(max_block_size);
+    size_t current_dataset = datasets.size();
+    size_t iblock;
+
+    while ((iblock = next_block++) < blocks.size()) {
+        const BlockRef& ref = blocks[iblock];
+        const ColumnarDataset& dataset = *datasets[ref.dataset];
+
+        if (ref.dataset != current_dataset) {
+            current_dataset = ref.dataset;
+
+            Long64_t compressed_bytes[NUM_EVENT_COLUMNS];
+            Long64_t uncompressed_bytes[NUM_EVENT_COLUMNS];
+            for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+                compressed_bytes[col] = dataset.get_column_bytes(col);
+                uncompressed_bytes[col] = dataset.get_num_entries() * sizeof(Double_t);
+            }
+
+            worker->run_stats.begin_file(dataset.get_path(), dataset.get_num_entries(),
+                    worker->num_entries_processed, compressed_bytes, uncompressed_bytes);
+        }
+
+        const RunClock::time_point read_start = RunStats::now();
+        EventBlock block;
+        if (!dataset.read_block(ref.block, scratch, block)) {
+            failed = true;
+            next_block = blocks.size();
+            return;
+        }
+        worker->run_stats.lap(PhaseIO, read_start);
+
+        worker->ProcessBatch(block);
+
+        num_entries_done += block.size;
+    }
+}
+
+bool
+ColumnarProcessor::process(VVJJFlavorSelector* selector)
+{
+    selector->Begin(nullptr);
+    selector->SlaveBegin(nullptr);
+
+    std::vector< std::unique_ptr<VVJJFlavorSelector> > workers;
+    std::vector<std::thread> threads;
+
+    std::cout << "processing " << blocks.size() << " columnar blocks with "
+        << num_threads << " threads" << std::endl;
+
+    for (unsigned i = 0; i < num_threads; i++) {
+        workers.emplace_back(new VVJJFlavorSelector(selector->output_path, selector->config));
+        workers.back()->print_progress = kFALSE;
+        workers.back()->Begin(nullptr);
+        workers.back()->SlaveBegin(nullptr);
+    }
+
+    for (unsigned i = 0; i < num_threads; i++) {
+        threads.emplace_back(&ColumnarProcessor::run_worker, this, workers[i].get());
+    }
+
+    report_progress(num_entries_done, num_entries, failed);
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    if (failed)
+        return false;
+
+    for (auto const& worker : workers) {
+        worker->SlaveTerminate();
+        selector->merge(*worker);
+    }
+
+    selector->SlaveTerminate();
+    selector->Terminate();
+
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef ColumnarProcessor_h
+#define ColumnarProcessor_h
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ColumnarDataset.h"
+#include "VVJJFlavorSelector.h"
+
+// Runs a VVJJFlavorSelector over a list of columnar datasets (see
+// ColumnarDataset) using a pool of threads, with no TTree in the loop.
+//
+// Like ParallelProcessor, the blocks of every dataset are pulled by the worker
+// threads from a shared queue into private VVJJFlavorSelectors, which are
+// merged into the caller's selector before Terminate().
+class ColumnarProcessor {
+    private:
+        struct BlockRef {
+            size_t dataset;
+            size_t block;
+        };
+
+        const unsigned num_threads;
+
+        std::vector< std::unique_ptr<ColumnarDataset> > datasets;
+        std::vector<BlockRef> blocks;
+        Long64_t num_entries;
+
+        std::atomic<size_t> next_block;
+        std::atomic<Long64_t> num_entries_done;
+
+        // set by a worker that could not decode a block, which stops the others
+        std::atomic<bool> failed;
+
+        void run_worker(VVJJFlavorSelector* worker);
+
+    public:
+        explicit ColumnarProcessor(unsigned num_threads_);
+
+        // map the dataset at path, returns false on failure
+        bool add(const std::string& path);
+
+        // returns false (without writing the output) if a block can't be decoded
+        bool process(VVJJFlavorSelector* selector);
+};
+
+#endif // #ifdef ColumnarProcessor_h
@@ -0,0 +1,204 @@
+#define CutFlow_cxx
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <TH1D.h>
+
+#include "CutFlow.h"
+#include "StateIO.h"
+#include "SelectionConfig.h"
+
+static const int N_MINUS_ONE_NUM_BINS = 50;
+
+// N-1 histograms span [0, 2 * threshold] for cuts on positive (or absolute)
+// values, and [2 * threshold, -2 * threshold] otherwise
+static std::unique_ptr<TH1Topo>
+book_n_minus_one(TH1TopoStore* store, const TagRegistry* tags, const std::string& name, const Cut& cut)
+{
+    float x_min, x_max;
+
+    if (cut.threshold == 0) {
+        x_min = -1.;
+        x_max = 1.;
+    } else if (cut.absolute || cut.threshold > 0) {
+        x_min = 0.;
+        x_max = 2. * std::abs(cut.threshold);
+    } else {
+        x_min = 2. * cut.threshold;
+        x_max = -2. * cut.threshold;
+    }
+
+    // TH1Topo truncates (x_max - x_min) / bin_spacing to get its number of bins
+    float bin_spacing = (x_max - x_min) / N_MINUS_ONE_NUM_BINS;
+    while (int((x_max - x_min) / bin_spacing) < N_MINUS_ONE_NUM_BINS) {
+        bin_spacing = std::nextafter(bin_spacing, 0.f);
+    }
+
+    return std::unique_ptr<TH1Topo>(new TH1Topo(store, tags, name, x_min, x_max, bin_spacing, false));
+}
+
+CutFlow::CutFlow(const std::vector<Cut>& cuts_, TH1TopoStore* store, const TagRegistry* tags) :
+    sum_weights_first_failed(cuts_.size() + 1, 0.),
+    sum_weights_failed(cuts_.size(), 0.),
+    sum_weights_only_failed(cuts_.size(), 0.),
+    cuts(cuts_),
+    sum_weights_total(0),
+    complete(true)
+{
+    for (UInt_t cut = 0; cut < cuts.size(); cut++) {
+        std::string name = std::string("n_minus_one_") + EVENT_COLUMN_NAMES[cuts[cut].column];
+
+        // e.g. a lower and an upper cut on the same variable
+        for (UInt_t other = 0; other < cut; other++) {
+            if (cuts[other].column == cuts[cut].column) {
+                name += "_" + std::to_string(cut);
+                break;
+            }
+        }
+
+        h_n_minus_one.push_back(book_n_minus_one(store, tags, name, cuts[cut]));
+    }
+}
+
+Double_t
+CutFlow::sum_weights_sequential(UInt_t cut) const
+{
+    Double_t sum = 0;
+    for (size_t first_failed = cut + 1; first_failed <= cuts.size(); first_failed++) {
+        sum += sum_weights_first_failed[first_failed];
+    }
+
+    return sum;
+}
+
+Double_t
+CutFlow::sum_weights_individual(UInt_t cut) const
+{
+    return sum_weights_total - sum_weights_failed[cut];
+}
+
+Double_t
+CutFlow::sum_weights_n_minus_one(UInt_t cut) const
+{
+    return sum_weights_only_failed[cut] + sum_weights_first_failed[cuts.size()];
+}
+
+void
+CutFlow::merge_counters(const CutFlow& other)
+{
+    sum_weights_total += other.sum_weights_total;
+    complete = complete && other.complete;
+
+    for (size_t i = 0; i < sum_weights_first_failed.size(); i++) {
+        sum_weights_first_failed[i] += other.sum_weights_first_failed[i];
+    }
+
+    for (size_t cut = 0; cut < cuts.size(); cut++) {
+        sum_weights_failed[cut] += other.sum_weights_failed[cut];
+        sum_weights_only_failed[cut] += other.sum_weights_only_failed[cut];
+    }
+}
+
+void
+CutFlow::write_counters(std::ostream& out) const
+{
+    write_state_value<UInt_t>(out, cuts.size());
+    write_state_value(out, sum_weights_total);
+    write_state_value<UChar_t>(out, complete);
+
+    write_state_values(out, sum_weights_first_failed.data(), sum_weights_first_failed.size());
+    write_state_values(out, sum_weights_failed.data(), sum_weights_failed.size());
+    write_state_values(out, sum_weights_only_failed.data(), sum_weights_only_failed.size());
+}
+
+bool
+CutFlow::add_counters(std::istream& in)
+{
+    UInt_t num_cuts;
+    UChar_t state_complete;
+    if (!read_state_value(in, num_cuts) || num_cuts != cuts.size()
+            || !add_state_values(in, &sum_weights_total, 1)
+            || !read_state_value(in, state_complete))
+        return false;
+
+    complete = complete && state_complete;
+
+    return add_state_values(in, sum_weights_first_failed.data(), sum_weights_first_failed.size())
+        && add_state_values(in, sum_weights_failed.data(), sum_weights_failed.size())
+        && add_state_values(in, sum_weights_only_failed.data(), sum_weights_only_failed.size());
+}
+
+void
+CutFlow::write_all_histograms(void) const
+{
+    if (!complete) {
+        std::cout << "NOTE: not every event was evaluated against every cut, the cut flow and N-1 histograms"
+            " are not written" << std::endl;
+        return;
+    }
+
+    // one bin for all the events evaluated, then one per cut
+    auto write_cut_flow = [this] (const char* name, Double_t (CutFlow::*sum_weights)(UInt_t) const) {
+        TH1D h(name, name, cuts.size() + 1, 0., cuts.size() + 1);
+        h.SetDirectory(nullptr);
+
+        h.GetXaxis()->SetBinLabel(1, "all");
+        h.SetBinContent(1, sum_weights_total);
+
+        for (UInt_t cut = 0; cut < cuts.size(); cut++) {
+            h.GetXaxis()->SetBinLabel(cut + 2, SelectionConfig::format_cut(cuts[cut]).c_str());
+            h.SetBinContent(cut + 2, (this->*sum_weights)(cut));
+        }
+
+        h.Write();
+    };
+
+    write_cut_flow("cutflow_sequential", &CutFlow::sum_weights_sequential);
+    write_cut_flow("cutflow_individual", &CutFlow::sum_weights_individual);
+    write_cut_flow("cutflow_n_minus_one", &CutFlow::sum_weights_n_minus_one);
+
+    for (auto const& h : h_n_minus_one) {
+        h->write_all_histograms();
+    }
+}
+
+void
+CutFlow::print_summary(void) const
+{
+    auto format_percent = [this] (Double_t sum_weights) {
+        std::stringstream ss;
+        ss.precision(2);
+        ss << std::fixed << 100.0 * sum_weights / sum_weights_total << "%";
+        return ss.str();
+    };
+
+    size_t cut_width = 3;
+    for (auto const& cut : cuts) {
+        cut_width = std::max(cut_width, SelectionConfig::format_cut(cut).size());
+    }
+
+    std::cout << "CUT FLOW (" << sum_weights_total << " TOTAL EVENT WEIGHT):" << std::endl;
+
+    if (!complete) {
+        std::cout << "\tall cuts: " << format_percent(sum_weights_first_failed[cuts.size()]) << std::endl;
+        std::cout << "NOTE: not every event was evaluated against every cut, only the weight passing all of"
+            " them is known" << std::endl;
+        return;
+    }
+
+    std::cout << "\t" << std::left << std::setw(cut_width) << "CUT" << std::right
+        << std::setw(12) << "SEQUENTIAL" << std::setw(12) << "INDIVIDUAL" << std::setw(12) << "N-1"
+        << std::endl;
+
+    for (UInt_t cut = 0; cut < cuts.size(); cut++) {
+        std::cout << "\t" << std::left << std::setw(cut_width) << SelectionConfig::format_cut(cuts[cut])
+            << std::right
+            << std::setw(12) << format_percent(sum_weights_sequential(cut))
+            << std::setw(12) << format_percent(sum_weights_individual(cut))
+            << std::setw(12) << format_percent(sum_weights_n_minus_one(cut))
+            << std::endl;
+    }
+}
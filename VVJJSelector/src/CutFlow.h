@@ -0,0 +1,120 @@
+#ifndef CutFlow_h
+#define CutFlow_h
+
+#include <cmath>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include <Rtypes.h>
+
+#include "BaselineSelection.h"
+#include "EventBlock.h"
+#include "TagRegistry.h"
+#include "TH1Topo.h"
+#include "TH1TopoStore.h"
+
+// The weighted cut flow of the baseline selection, filled from the CutMask of
+// every event (so every cut is seen, not just the first one failed):
+//
+//   sequential   weight passing the first i + 1 cuts, in config order
+//   individual   weight passing cut i on its own
+//   N-1          weight passing every cut but cut i
+//
+// along with an N-1 histogram of the variable of each cut, i.e. its
+// (|x| if absolute) / divisor, for the events passing every other cut.
+//
+// NOTE: events left out of skim cache files are never evaluated, and
+// --lazy-branches stops evaluating an event at the first cut it fails. Such
+// events are added with fill_unevaluated(), after which only the total and
+// the final (all cuts) entry are known: the cut flows and N-1 histograms are
+// then neither written nor printed.
+class CutFlow {
+    private:
+        // [i] is the weight of the events whose first failed cut is i, with
+        // [cuts.size()] for those passing them all
+        std::vector<Double_t> sum_weights_first_failed;
+
+        // weight of the events failing cut i, and failing only cut i
+        std::vector<Double_t> sum_weights_failed;
+        std::vector<Double_t> sum_weights_only_failed;
+
+        void fill_n_minus_one(UInt_t cut, float weight,
+                const Double_t* const column_values[NUM_EVENT_COLUMNS], size_t i) {
+            const Cut& c = cuts[cut];
+            Double_t value = column_values[c.column][i];
+            if (c.absolute) value = std::abs(value);
+
+            h_n_minus_one[cut]->fill_inclusive(value / c.divisor, weight);
+        }
+
+    public:
+        CutFlow(const std::vector<Cut>& cuts_, TH1TopoStore* store, const TagRegistry* tags);
+
+        const std::vector<Cut> cuts;
+
+        // weight of all the events evaluated
+        Double_t sum_weights_total;
+
+        // booked in the TH1TopoStore given to the constructor
+        std::vector< std::unique_ptr<TH1Topo> > h_n_minus_one;
+
+        // Add an event failing the cuts in failed. Its cut variables are
+        // read from column_values[column][i], i.e. either from the columns
+        // of an EventBlock or (with i = 0) from the selector members.
+        void fill(CutMask failed, float weight,
+                const Double_t* const column_values[NUM_EVENT_COLUMNS], size_t i) {
+            sum_weights_total += weight;
+
+            if (failed == 0) {
+                sum_weights_first_failed[cuts.size()] += weight;
+                for (UInt_t cut = 0; cut < cuts.size(); cut++) {
+                    fill_n_minus_one(cut, weight, column_values, i);
+                }
+                return;
+            }
+
+            sum_weights_first_failed[__builtin_ctz(failed)] += weight;
+
+            if ((failed & (failed - 1)) == 0) {
+                const UInt_t cut = __builtin_ctz(failed);
+                sum_weights_only_failed[cut] += weight;
+                fill_n_minus_one(cut, weight, column_values, i);
+            }
+
+            for (CutMask remaining = failed; remaining != 0; remaining &= remaining - 1) {
+                sum_weights_failed[__builtin_ctz(remaining)] += weight;
+            }
+        }
+
+        // false once an event was added without evaluating every cut
+        bool complete;
+
+        // add an event rejected without evaluating every cut, it only
+        // counts towards sum_weights_total
+        void fill_unevaluated(Double_t weight) {
+            sum_weights_total += weight;
+            complete = false;
+        }
+
+        Double_t sum_weights_sequential(UInt_t cut) const;
+        Double_t sum_weights_individual(UInt_t cut) const;
+        Double_t sum_weights_n_minus_one(UInt_t cut) const;
+
+        // add the counters of other (the histograms are merged by the store)
+        void merge_counters(const CutFlow& other);
+
+        // write the counters, or add counters written by a cut flow of the
+        // same cuts (the histograms are saved with the store)
+        void write_counters(std::ostream& out) const;
+        bool add_counters(std::istream& in);
+
+        // write the cut flows, as labelled histograms, and the N-1
+        // histograms to the current ROOT directory, if complete
+        void write_all_histograms(void) const;
+
+        void print_summary(void) const;
+};
+
+#endif // #ifdef CutFlow_h
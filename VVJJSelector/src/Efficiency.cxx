@@ -0,0 +1,59 @@
+#define Efficiency_cxx
+
+#include <algorithm>
+
+#include <TEfficiency.h>
+
+#include "Efficiency.h"
+
+// the coverage of a one standard deviation interval
+static const Double_t EFFICIENCY_CONFIDENCE_LEVEL = 0.682689492137086;
+
+const char*
+efficiency_interval_name(EfficiencyInterval interval)
+{
+    switch (interval) {
+        case EfficiencyInterval::Bayesian: return "bayesian";
+        default:                           return "clopper-pearson";
+    }
+}
+
+bool
+parse_efficiency_interval(const std::string& name, EfficiencyInterval& interval)
+{
+    if (name == "clopper-pearson") {
+        interval = EfficiencyInterval::ClopperPearson;
+    } else if (name == "bayesian") {
+        interval = EfficiencyInterval::Bayesian;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+bool
+compute_efficiency(Double_t passed_sumw, Double_t total_sumw, Double_t total_sumw2,
+        EfficiencyInterval interval, Efficiency& efficiency)
+{
+    if (!(total_sumw > 0))
+        return false;
+
+    efficiency.value = passed_sumw / total_sumw;
+
+    // unweighted (or equally weighted) events give back the plain counts
+    const Double_t total = total_sumw2 > 0 ? total_sumw * total_sumw / total_sumw2 : total_sumw;
+    const Double_t passed = std::min(std::max(efficiency.value, 0.), 1.) * total;
+
+    const Double_t level = EFFICIENCY_CONFIDENCE_LEVEL;
+
+    if (interval == EfficiencyInterval::Bayesian) {
+        efficiency.low = TEfficiency::Bayesian(total, passed, level, 1., 1., kFALSE);
+        efficiency.high = TEfficiency::Bayesian(total, passed, level, 1., 1., kTRUE);
+    } else {
+        efficiency.low = TEfficiency::ClopperPearson(total, passed, level, kFALSE);
+        efficiency.high = TEfficiency::ClopperPearson(total, passed, level, kTRUE);
+    }
+
+    return true;
+}
@@ -0,0 +1,33 @@
+#ifndef Efficiency_h
+#define Efficiency_h
+
+#include <string>
+
+#include <Rtypes.h>
+
+// How the (68.3% CL) uncertainty interval of an efficiency is computed:
+// Clopper-Pearson, or Bayesian with a uniform prior.
+enum class EfficiencyInterval {
+    ClopperPearson,
+    Bayesian
+};
+
+// "clopper-pearson" or "bayesian"
+const char* efficiency_interval_name(EfficiencyInterval interval);
+bool parse_efficiency_interval(const std::string& name, EfficiencyInterval& interval);
+
+struct Efficiency {
+    Double_t value;
+    Double_t low;
+    Double_t high;
+};
+
+// The efficiency passed_sumw / total_sumw of a weighted selection, where the
+// passing events are a subset of the total ones. With weights, the interval
+// is computed from the effective number of entries, total_sumw^2 /
+// total_sumw2 (as TEfficiency does). Returns false if total_sumw isn't
+// positive.
+bool compute_efficiency(Double_t passed_sumw, Double_t total_sumw, Double_t total_sumw2,
+        EfficiencyInterval interval, Efficiency& efficiency);
+
+#endif // #ifdef Efficiency_h
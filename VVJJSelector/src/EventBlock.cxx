@@ -0,0 +1,66 @@
+#define EventBlock_cxx
+
+#include <cstring>
+
+#include "EventBlock.h"
+
+const char* const EVENT_COLUMN_NAMES[NUM_EVENT_COLUMNS] = {
+#define VVJJ_COLUMN_NAME(name) #name,
+    VVJJ_EVENT_COLUMNS(VVJJ_COLUMN_NAME)
+#undef VVJJ_COLUMN_NAME
+};
+
+int
+find_event_column(const char* name)
+{
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        if (std::strcmp(name, EVENT_COLUMN_NAMES[col]) == 0)
+            return col;
+    }
+
+    return -1;
+}
+
+const Double_t*
+EventBlock::column(EventColumn col) const
+{
+    switch (col) {
+#define VVJJ_COLUMN_CASE(name) case COL_##name: return name;
+        VVJJ_EVENT_COLUMNS(VVJJ_COLUMN_CASE)
+#undef VVJJ_COLUMN_CASE
+        default: return nullptr;
+    }
+}
+
+void
+EventBlock::set_column(EventColumn col, const Double_t* values)
+{
+    switch (col) {
+#define VVJJ_COLUMN_CASE(name) case COL_##name: name = values; break;
+        VVJJ_EVENT_COLUMNS(VVJJ_COLUMN_CASE)
+#undef VVJJ_COLUMN_CASE
+        default: break;
+    }
+}
+
+EventBlockBuffer::EventBlockBuffer(size_t capacity_) :
+    capacity(capacity_),
+    size(0)
+{
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        columns[col].resize(capacity);
+    }
+}
+
+EventBlock
+EventBlockBuffer::view(void) const
+{
+    EventBlock block;
+    block.size = size;
+
+#define VVJJ_COLUMN_VIEW(name) block.name = columns[COL_##name].data();
+    VVJJ_EVENT_COLUMNS(VVJJ_COLUMN_VIEW)
+#undef VVJJ_COLUMN_VIEW
+
+    return block;
+}
@@ -0,0 +1,89 @@
+#ifndef EventBlock_h
+#define EventBlock_h
+
+#include <cstddef>
+#include <vector>
+
+#include <Rtypes.h>
+
+// The Nominal branches read by VVJJFlavorSelector for each event. Every
+// column is a Double_t branch with the same name as the selector member it
+// is read into.
+#define VVJJ_EVENT_COLUMNS(COLUMN)                \
+    COLUMN(weight)                                \
+    COLUMN(pileup_weight)                         \
+    COLUMN(dijet_mass_massordered)                \
+    COLUMN(first_jet_pt)                          \
+    COLUMN(first_jet_eta)                         \
+    COLUMN(first_jet_phi)                         \
+    COLUMN(first_jet_m)                           \
+    COLUMN(first_jet_D2)                          \
+    COLUMN(first_jet_passedWSubstructure)         \
+    COLUMN(first_jet_passedZSubstructure)         \
+    COLUMN(first_jet_passedWMassCut)              \
+    COLUMN(first_jet_passedZMassCut)              \
+    COLUMN(first_jet_pdgid)                       \
+    COLUMN(second_jet_pt)                         \
+    COLUMN(second_jet_eta)                        \
+    COLUMN(second_jet_phi)                        \
+    COLUMN(second_jet_m)                          \
+    COLUMN(second_jet_D2)                         \
+    COLUMN(second_jet_passedWSubstructure)        \
+    COLUMN(second_jet_passedZSubstructure)        \
+    COLUMN(second_jet_passedWMassCut)             \
+    COLUMN(second_jet_passedZMassCut)             \
+    COLUMN(second_jet_pdgid)                      \
+    COLUMN(dyjj)                                  \
+    COLUMN(ptasym)                                \
+    COLUMN(n_muons)                               \
+    COLUMN(n_elecs)                               \
+    COLUMN(jet1_m)                                \
+    COLUMN(jet2_m)                                \
+    COLUMN(jet1_ungrtrk500)                       \
+    COLUMN(jet2_ungrtrk500)
+
+enum EventColumn {
+#define VVJJ_COLUMN_ENUM(name) COL_##name,
+    VVJJ_EVENT_COLUMNS(VVJJ_COLUMN_ENUM)
+#undef VVJJ_COLUMN_ENUM
+    NUM_EVENT_COLUMNS
+};
+
+extern const char* const EVENT_COLUMN_NAMES[NUM_EVENT_COLUMNS];
+
+// the column of the branch called name, or -1 if it is not an event column
+int find_event_column(const char* name);
+
+// default number of events per block, enough to amortize the per-call
+// overhead while keeping every column of a block in L2 cache
+const size_t DEFAULT_EVENT_BLOCK_SIZE = 4096;
+
+// A non-owning, structure-of-arrays view of a block of consecutive events.
+struct EventBlock {
+    size_t size;
+
+#define VVJJ_COLUMN_POINTER(name) const Double_t* name;
+    VVJJ_EVENT_COLUMNS(VVJJ_COLUMN_POINTER)
+#undef VVJJ_COLUMN_POINTER
+
+    // access to the columns by EventColumn rather than by name
+    const Double_t* column(EventColumn col) const;
+    void set_column(EventColumn col, const Double_t* values);
+};
+
+// Owns the column storage of an EventBlock.
+class EventBlockBuffer {
+    public:
+        explicit EventBlockBuffer(size_t capacity_ = DEFAULT_EVENT_BLOCK_SIZE);
+
+        const size_t capacity;
+        size_t size;
+
+        std::vector<Double_t> columns[NUM_EVENT_COLUMNS];
+
+        Double_t* column(EventColumn col) { return columns[col].data(); }
+
+        EventBlock view(void) const;
+};
+
+#endif // #ifdef EventBlock_h
@@ -0,0 +1,191 @@
+#define EventIndex_cxx
+
+#include <TFile.h>
+#include <TROOT.h>
+#include <TSystem.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "EventIndex.h"
+#include "StateIO.h"
+
+// index files start with INDEX_MAGIC and the format version
+static const char INDEX_MAGIC[8] = { 'V', 'V', 'J', 'J', 'E', 'I', 'D', 'X' };
+static const UInt_t INDEX_FORMAT_VERSION = 1;
+
+EventIndex::EventIndex(std::string index_dir_) :
+    index_dir(index_dir_)
+{
+    if (!index_dir.empty())
+        gSystem->mkdir(index_dir.c_str(), kTRUE);
+}
+
+bool
+EventIndex::read(const std::string& index_path, const std::string& uuid, Long64_t size,
+        RunEventIndex& index) const
+{
+    std::ifstream in(index_path.c_str(), std::ios::binary);
+    if (!in.is_open())
+        return false;
+
+    char magic[sizeof(INDEX_MAGIC)];
+    UInt_t version;
+    std::string index_uuid;
+    Long64_t index_size;
+    ULong64_t num_events;
+
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0
+            || !read_state_value(in, version) || version != INDEX_FORMAT_VERSION
+            || !read_state_string(in, index_uuid) || index_uuid != uuid
+            || !read_state_value(in, index_size) || index_size != size
+            || !read_state_value(in, num_events)) {
+        return false;
+    }
+
+    index.resize(num_events);
+    for (auto& x : index) {
+        if (!read_state_value(in, x.run) || !read_state_value(in, x.event) || !read_state_value(in, x.entry))
+            return false;
+    }
+
+    return true;
+}
+
+bool
+EventIndex::write(const std::string& index_path, const std::string& uuid, Long64_t size,
+        const RunEventIndex& index) const
+{
+    const std::string tmp_path = index_path + ".tmp";
+
+    std::ofstream out(tmp_path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+        return false;
+
+    out.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    write_state_value(out, INDEX_FORMAT_VERSION);
+    write_state_string(out, uuid);
+    write_state_value(out, size);
+    write_state_value<ULong64_t>(out, index.size());
+
+    for (auto const& x : index) {
+        write_state_value(out, x.run);
+        write_state_value(out, x.event);
+        write_state_value(out, x.entry);
+    }
+
+    out.close();
+
+    if (!out || std::rename(tmp_path.c_str(), index_path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool
+EventIndex::load(const std::string& input_path, RunEventIndex& index) const
+{
+    std::unique_ptr<TFile> input_file(TFile::Open(input_path.c_str(), "READ"));
+    TTree* tree = nullptr;
+    if (input_file && !input_file->IsZombie())
+        tree = dynamic_cast<TTree*>(input_file->Get("Nominal"));
+
+    if (tree == nullptr) {
+        std::cout << "ERROR: failed to read Nominal tree from input file: " << input_path << std::endl;
+        return false;
+    }
+
+    const std::string uuid = input_file->GetUUID().AsString();
+    const Long64_t size = input_file->GetSize();
+
+    const std::string index_path = index_dir.empty() ? input_path + ".eventindex"
+        : index_dir + "/" + uuid + "-" + std::to_string(size) + ".eventindex";
+
+    if (read(index_path, uuid, size, index))
+        return true;
+
+    // only the run and event branches are read
+    Int_t run;
+    ULong64_t event;
+    TBranch* b_run = nullptr;
+    TBranch* b_event = nullptr;
+
+    tree->SetBranchStatus("*", kFALSE);
+    if (tree->GetBranch("run") == nullptr || tree->GetBranch("event") == nullptr) {
+        std::cout << "ERROR: no run and event branches to index in input file: " << input_path << std::endl;
+        return false;
+    }
+
+    tree->SetBranchStatus("run", kTRUE);
+    tree->SetBranchStatus("event", kTRUE);
+    tree->SetBranchAddress("run", &run, &b_run);
+    tree->SetBranchAddress("event", &event, &b_event);
+
+    const Long64_t num_entries = tree->GetEntries();
+    index.clear();
+    index.reserve(num_entries);
+
+    for (Long64_t entry = 0; entry < num_entries; entry++) {
+        if (tree->GetEntry(entry) <= 0) {
+            std::cout << "ERROR: failed to read entry " << entry << " of input file: " << input_path << std::endl;
+            return false;
+        }
+
+        index.push_back(IndexedEvent {run, event, entry});
+    }
+
+    std::sort(index.begin(), index.end(), [] (const IndexedEvent& a, const IndexedEvent& b) {
+        if (a.run != b.run) return a.run < b.run;
+        if (a.event != b.event) return a.event < b.event;
+        return a.entry < b.entry;
+    });
+
+    if (write(index_path, uuid, size, index)) {
+        std::cout << "\tevent index written: " + index_path + "\n" << std::flush;
+    } else {
+        std::cout << "WARNING: failed to write event index: " + index_path + "\n" << std::flush;
+    }
+
+    return true;
+}
+
+bool
+EventIndex::load_all(const std::vector<std::string>& paths, unsigned num_threads,
+        std::vector<RunEventIndex>& indices) const
+{
+    indices.assign(paths.size(), RunEventIndex());
+
+    // one file per thread at a time, each through its own TFile
+    ROOT::EnableThreadSafety();
+
+    std::vector<char> loaded(paths.size(), 0);
+    std::atomic<size_t> next_path(0);
+
+    auto run_worker = [&] {
+        size_t i;
+        while ((i = next_path++) < paths.size()) {
+            loaded[i] = load(paths[i], indices[i]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    const size_t num_workers = std::max<size_t>(1, std::min<size_t>(num_threads, paths.size()));
+    for (size_t t = 0; t < num_workers; t++) {
+        workers.emplace_back(run_worker);
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    return std::find(loaded.begin(), loaded.end(), 0) == loaded.end();
+}
@@ -0,0 +1,53 @@
+#ifndef EventIndex_h
+#define EventIndex_h
+
+#include <string>
+#include <vector>
+
+#include <Rtypes.h>
+
+// the entry of the Nominal tree holding an event
+struct IndexedEvent {
+    Int_t run;
+    ULong64_t event;
+    Long64_t entry;
+};
+
+// The (run, event) -> entry index of the Nominal tree of an input file,
+// sorted by run, then event number.
+typedef std::vector<IndexedEvent> RunEventIndex;
+
+// Persistent (run, event) indices of the input files, for processing only
+// selected runs or events (see EventSelection).
+//
+// The index of an input file is built by reading only its run and event
+// branches, then saved to a sidecar file: <input_path>.eventindex next to
+// the input, or <uuid>-<size>.eventindex in index_dir if one is given (e.g.
+// for read-only or remote inputs). Index files record the UUID and size of
+// the input they were built from, and are rebuilt when those change. They
+// are written to a temporary name, then renamed into place.
+class EventIndex {
+    private:
+        const std::string index_dir;
+
+        // read the index file of input_path, false if it is missing or stale
+        bool read(const std::string& index_path, const std::string& uuid, Long64_t size,
+                RunEventIndex& index) const;
+        bool write(const std::string& index_path, const std::string& uuid, Long64_t size,
+                const RunEventIndex& index) const;
+
+    public:
+        explicit EventIndex(std::string index_dir_ = "");
+
+        // Set index to the index of input_path, building and saving it if
+        // there is no up to date index file. Returns false (after printing
+        // an error) if input_path can't be read; failing to save the index
+        // is only a warning.
+        bool load(const std::string& input_path, RunEventIndex& index) const;
+
+        // load() the index of every path, with up to num_threads files at a time
+        bool load_all(const std::vector<std::string>& paths, unsigned num_threads,
+                std::vector<RunEventIndex>& indices) const;
+};
+
+#endif // #ifdef EventIndex_h
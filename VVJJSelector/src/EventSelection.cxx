@@ -0,0 +1,186 @@
+#define EventSelection_cxx
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "EventSelection.h"
+
+// parse "A,B-C,..." into inclusive ranges, false if malformed
+template <class T>
+static bool
+parse_ranges(const std::string& spec, std::vector< std::pair<T, T> >& ranges)
+{
+    std::stringstream ss(spec);
+    std::string item;
+
+    while (std::getline(ss, item, ',')) {
+        // the leading '-' of a negative number is not a separator
+        const size_t dash = item.find('-', 1);
+
+        try {
+            size_t end;
+            const long long first = std::stoll(item.substr(0, dash), &end);
+            if (end != item.substr(0, dash).size()) return false;
+
+            long long last = first;
+            if (dash != std::string::npos) {
+                last = std::stoll(item.substr(dash + 1), &end);
+                if (end != item.size() - dash - 1) return false;
+            }
+
+            if (first < 0 || last < first) return false;
+
+            ranges.push_back(std::make_pair(static_cast<T>(first), static_cast<T>(last)));
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    return !ranges.empty();
+}
+
+EventSelection::EventSelection(void) :
+    has_events(false)
+{ }
+
+bool
+EventSelection::add_runs(const std::string& spec)
+{
+    return parse_ranges(spec, run_ranges);
+}
+
+bool
+EventSelection::add_entries(const std::string& spec)
+{
+    return parse_ranges(spec, entry_ranges);
+}
+
+bool
+EventSelection::add_events(const std::string& path)
+{
+    std::ifstream in(path.c_str());
+    if (!in.is_open())
+        return false;
+
+    Int_t run;
+    ULong64_t event;
+    while (in >> run >> event) {
+        events.push_back(std::make_pair(run, event));
+    }
+
+    if (!in.eof())
+        return false;
+
+    std::sort(events.begin(), events.end());
+    events.erase(std::unique(events.begin(), events.end()), events.end());
+    has_events = true;
+
+    return true;
+}
+
+bool
+EventSelection::selects_run(Int_t run) const
+{
+    if (run_ranges.empty())
+        return true;
+
+    for (auto const& range : run_ranges) {
+        if (run >= range.first && run <= range.second)
+            return true;
+    }
+
+    return false;
+}
+
+bool
+EventSelection::selects_entry(Long64_t entry) const
+{
+    if (entry_ranges.empty())
+        return true;
+
+    for (auto const& range : entry_ranges) {
+        if (entry >= range.first && entry <= range.second)
+            return true;
+    }
+
+    return false;
+}
+
+std::unique_ptr<TEntryList>
+EventSelection::make_entry_list(TChain* chain, const EventIndex& index, unsigned num_threads) const
+{
+    // GetEntries() forces the chain to compute the entry offset of every tree
+    const Long64_t num_entries = chain->GetEntries();
+    const Long64_t* tree_offsets = chain->GetTreeOffset();
+
+    TObjArray* files = chain->GetListOfFiles();
+    std::vector<std::string> paths;
+    for (Int_t i = 0; i < files->GetEntries(); i++) {
+        paths.push_back(files->At(i)->GetTitle());
+    }
+
+    std::vector<RunEventIndex> indices;
+    if (needs_index() && !index.load_all(paths, num_threads, indices))
+        return nullptr;
+
+    std::unique_ptr<TEntryList> entry_list(new TEntryList("vvjj_selection", "selected entries"));
+    entry_list->SetDirectory(nullptr);
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        const Long64_t tree_entries = tree_offsets[i + 1] - tree_offsets[i];
+        std::vector<Long64_t> local_entries;
+
+        if (has_events) {
+            // look up each event, rather than scanning the index
+            for (auto const& x : events) {
+                if (!selects_run(x.first))
+                    continue;
+
+                const IndexedEvent key {x.first, x.second, 0};
+                auto matches = std::equal_range(indices[i].begin(), indices[i].end(), key,
+                        [] (const IndexedEvent& a, const IndexedEvent& b) {
+                            return a.run != b.run ? a.run < b.run : a.event < b.event;
+                        });
+
+                for (auto it = matches.first; it != matches.second; ++it) {
+                    local_entries.push_back(it->entry);
+                }
+            }
+        } else if (!run_ranges.empty()) {
+            // the index is sorted by run, so each range is contiguous
+            for (auto const& range : run_ranges) {
+                auto it = std::lower_bound(indices[i].begin(), indices[i].end(), range.first,
+                        [] (const IndexedEvent& a, Int_t run) { return a.run < run; });
+
+                for (; it != indices[i].end() && it->run <= range.second; ++it) {
+                    local_entries.push_back(it->entry);
+                }
+            }
+        } else {
+            for (auto const& range : entry_ranges) {
+                const Long64_t first = std::max(range.first - tree_offsets[i], 0LL);
+                const Long64_t last = std::min(range.second - tree_offsets[i], tree_entries - 1);
+                for (Long64_t entry = first; entry <= last; entry++) {
+                    local_entries.push_back(entry);
+                }
+            }
+        }
+
+        // in entry order, once each, so that baskets are read sequentially
+        std::sort(local_entries.begin(), local_entries.end());
+        local_entries.erase(std::unique(local_entries.begin(), local_entries.end()), local_entries.end());
+
+        entry_list->SetTree(chain->GetName(), paths[i].c_str());
+        for (Long64_t entry : local_entries) {
+            if (selects_entry(tree_offsets[i] + entry))
+                entry_list->Enter(entry);
+        }
+    }
+
+    std::cout << "\tselected " << entry_list->GetN() << " of " << num_entries << " entries" << std::endl;
+
+    return entry_list;
+}
@@ -0,0 +1,56 @@
+#ifndef EventSelection_h
+#define EventSelection_h
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <Rtypes.h>
+#include <TChain.h>
+#include <TEntryList.h>
+
+#include "EventIndex.h"
+
+// The events of a chain to process, for --runs, --events and --entries.
+//
+// Events are selected by run (ranges), by (run, event) number, and by chain
+// entry (ranges); an event must match every kind of selection given. The
+// runs and events are looked up in the EventIndex of each input file, the
+// entries need no index. The selection is applied as a TEntryList on the
+// chain, so that TTree::Process only reads the baskets holding selected
+// entries.
+class EventSelection {
+    private:
+        // inclusive ranges
+        std::vector< std::pair<Int_t, Int_t> > run_ranges;
+        std::vector< std::pair<Long64_t, Long64_t> > entry_ranges;
+
+        // sorted (run, event) numbers
+        std::vector< std::pair<Int_t, ULong64_t> > events;
+        bool has_events;
+
+        bool selects_run(Int_t run) const;
+        bool selects_entry(Long64_t entry) const;
+
+    public:
+        EventSelection(void);
+
+        // "RUN" or "FIRST-LAST" (inclusive) ranges, separated by commas, false if malformed
+        bool add_runs(const std::string& spec);
+        bool add_entries(const std::string& spec);
+
+        // add the "RUN EVENT" lines of a text file, false if it can't be read
+        bool add_events(const std::string& path);
+
+        bool empty(void) const { return run_ranges.empty() && entry_ranges.empty() && !has_events; }
+        bool needs_index(void) const { return !run_ranges.empty() || has_events; }
+
+        // The selected entries of chain (whose files index is loaded from,
+        // building the missing indices with num_threads threads), null if an
+        // index can't be loaded.
+        std::unique_ptr<TEntryList> make_entry_list(TChain* chain, const EventIndex& index,
+                unsigned num_threads) const;
+};
+
+#endif // #ifdef EventSelection_h
@@ -0,0 +1,286 @@
+#define HistogramSet_cxx
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <TDirectory.h>
+#include <TParameter.h>
+#include <TTree.h>
+
+#include "HistogramSet.h"
+#include "StateIO.h"
+
+HistogramSet::HistogramSet(const std::string& name_, TH1TopoStore* store, THnTopoStore* sparse_store,
+        const TagRegistry* tags_, const std::vector<Cut>& cuts) :
+    tags(tags_),
+    name(name_),
+    sum_weights_total(0),
+    sum_weights_baseline_selection(0),
+    sum_weights_qq(0),
+    sum_weights_qg(0),
+    sum_weights_gg(0),
+    sum_weights_qg_firstjet_quark(0),
+    sum_weights_qg_firstjet_gluon(0),
+    sum_weights_non_quark_gluon_rejections(0)
+{
+    // only pt, mass and dijet mass are filled with tags
+    h_first_jet_pt.reset(new TH1Topo(store, tags, "first_jet_pt"  , 0. , 4000. , 100));
+    h_second_jet_pt.reset(new TH1Topo(store, tags, "second_jet_pt" , 0. , 4000. , 100));
+
+    h_first_jet_eta.reset(new TH1Topo(store, tags, "first_jet_eta"  , -2.5 , 2.5 , 0.2 , false));
+    h_second_jet_eta.reset(new TH1Topo(store, tags, "second_jet_eta" , -2.5 , 2.5 , 0.2 , false));
+
+    h_first_jet_phi.reset(new TH1Topo(store, tags, "first_jet_phi"  , -3.2 , 3.2 , 0.2 , false));
+    h_second_jet_phi.reset(new TH1Topo(store, tags, "second_jet_phi" , -3.2 , 3.2 , 0.2 , false));
+
+    h_first_jet_m.reset(new TH1Topo(store, tags, "first_jet_m"  , 0. , 400. , 10.0));
+    h_second_jet_m.reset(new TH1Topo(store, tags, "second_jet_m" , 0. , 400. , 10.0));
+
+    h_first_jet_D2.reset(new TH1Topo(store, tags, "first_jet_D2"  , 0. , 5. , 0.2 , false));
+    h_second_jet_D2.reset(new TH1Topo(store, tags, "second_jet_D2" , 0. , 5. , 0.2 , false));
+
+    h_first_jet_ungNtrk.reset(new TH1Topo(store, tags, "first_jet_ntrk"  , 0. , 100. , 2.0 , false));
+    h_second_jet_ungNtrk.reset(new TH1Topo(store, tags, "second_jet_ntrk" , 0. , 100. , 2.0 , false));
+
+    h_dijet_mass.reset(new TH1Topo(store, tags, "dijet_mass" , 0. , 8000. , 100));
+
+    const THnAxis first_jet_pt   = { "first_jet_pt"   , 0. , 4000. , 100  };
+    const THnAxis second_jet_pt  = { "second_jet_pt"  , 0. , 4000. , 100  };
+    const THnAxis first_jet_ntrk  = { "first_jet_ntrk"  , 0. , 100.  , 2.0  };
+    const THnAxis second_jet_ntrk = { "second_jet_ntrk" , 0. , 100.  , 2.0  };
+    const THnAxis first_jet_m    = { "first_jet_m"    , 0. , 400.  , 10.0 };
+    const THnAxis second_jet_m   = { "second_jet_m"   , 0. , 400.  , 10.0 };
+    const THnAxis first_jet_D2   = { "first_jet_D2"   , 0. , 5.    , 0.2  };
+    const THnAxis second_jet_D2  = { "second_jet_D2"  , 0. , 5.    , 0.2  };
+    const THnAxis dijet_mass     = { "dijet_mass"     , 0. , 8000. , 100  };
+
+    hn_first_jet_ntrk_pt.reset(new THnTopo(sparse_store, tags, "first_jet_ntrk_vs_pt", {first_jet_pt, first_jet_ntrk}));
+    hn_second_jet_ntrk_pt.reset(new THnTopo(sparse_store, tags, "second_jet_ntrk_vs_pt", {second_jet_pt, second_jet_ntrk}));
+
+    hn_first_jet_D2_m.reset(new THnTopo(sparse_store, tags, "first_jet_D2_vs_m", {first_jet_m, first_jet_D2}));
+    hn_second_jet_D2_m.reset(new THnTopo(sparse_store, tags, "second_jet_D2_vs_m", {second_jet_m, second_jet_D2}));
+
+    hn_dijet_mass_first_jet_m.reset(new THnTopo(sparse_store, tags, "dijet_mass_vs_first_jet_m", {first_jet_m, dijet_mass}));
+
+    cut_flow.reset(new CutFlow(cuts, store, tags));
+
+    ntrk_scan_first_jet_pt.reset(new NtrkScan(store, tags, false, "first_jet_pt"  , 0. , 4000. , 100));
+    ntrk_scan_second_jet_pt.reset(new NtrkScan(store, tags, false, "second_jet_pt" , 0. , 4000. , 100));
+    ntrk_scan_dijet_mass.reset(new NtrkScan(store, tags, true, "dijet_mass" , 0. , 8000. , 200));
+}
+
+void
+HistogramSet::merge_counters(const HistogramSet& other)
+{
+    sum_weights_total                      += other.sum_weights_total;
+    sum_weights_baseline_selection         += other.sum_weights_baseline_selection;
+    sum_weights_qq                         += other.sum_weights_qq;
+    sum_weights_qg                         += other.sum_weights_qg;
+    sum_weights_gg                         += other.sum_weights_gg;
+    sum_weights_qg_firstjet_quark          += other.sum_weights_qg_firstjet_quark;
+    sum_weights_qg_firstjet_gluon          += other.sum_weights_qg_firstjet_gluon;
+    sum_weights_non_quark_gluon_rejections += other.sum_weights_non_quark_gluon_rejections;
+
+    cut_flow->merge_counters(*other.cut_flow);
+}
+
+void
+HistogramSet::write_counters(std::ostream& out) const
+{
+    write_state_string(out, name);
+
+    write_state_value(out, sum_weights_total);
+    write_state_value(out, sum_weights_baseline_selection);
+    write_state_value(out, sum_weights_qq);
+    write_state_value(out, sum_weights_qg);
+    write_state_value(out, sum_weights_gg);
+    write_state_value(out, sum_weights_qg_firstjet_quark);
+    write_state_value(out, sum_weights_qg_firstjet_gluon);
+    write_state_value(out, sum_weights_non_quark_gluon_rejections);
+
+    cut_flow->write_counters(out);
+}
+
+bool
+HistogramSet::add_counters(std::istream& in)
+{
+    std::string state_name;
+    if (!read_state_string(in, state_name) || state_name != name)
+        return false;
+
+    return add_state_values(in, &sum_weights_total, 1)
+        && add_state_values(in, &sum_weights_baseline_selection, 1)
+        && add_state_values(in, &sum_weights_qq, 1)
+        && add_state_values(in, &sum_weights_qg, 1)
+        && add_state_values(in, &sum_weights_gg, 1)
+        && add_state_values(in, &sum_weights_qg_firstjet_quark, 1)
+        && add_state_values(in, &sum_weights_qg_firstjet_gluon, 1)
+        && add_state_values(in, &sum_weights_non_quark_gluon_rejections, 1)
+        && cut_flow->add_counters(in);
+}
+
+void
+HistogramSet::write_all_histograms(void) const
+{
+    h_first_jet_pt->write_all_histograms();
+    h_first_jet_eta->write_all_histograms();
+    h_first_jet_phi->write_all_histograms();
+    h_first_jet_m->write_all_histograms();
+    h_first_jet_D2->write_all_histograms();
+    h_first_jet_ungNtrk->write_all_histograms();
+
+    h_second_jet_pt->write_all_histograms();
+    h_second_jet_eta->write_all_histograms();
+    h_second_jet_phi->write_all_histograms();
+    h_second_jet_m->write_all_histograms();
+    h_second_jet_D2->write_all_histograms();
+    h_second_jet_ungNtrk->write_all_histograms();
+
+    h_dijet_mass->write_all_histograms();
+
+    hn_first_jet_ntrk_pt->write_all_histograms();
+    hn_second_jet_ntrk_pt->write_all_histograms();
+    hn_first_jet_D2_m->write_all_histograms();
+    hn_second_jet_D2_m->write_all_histograms();
+    hn_dijet_mass_first_jet_m->write_all_histograms();
+
+    cut_flow->write_all_histograms();
+}
+
+void
+HistogramSet::write_sum_weights(void) const
+{
+    auto write_parameter = [] (const char* parameter_name, Double_t value) {
+        TParameter<Double_t> parameter(parameter_name, value);
+        parameter.Write();
+    };
+
+    write_parameter("sum_weights_total", sum_weights_total);
+    write_parameter("sum_weights_baseline_selection", sum_weights_baseline_selection);
+    write_parameter("sum_weights_qq", sum_weights_qq);
+    write_parameter("sum_weights_qg", sum_weights_qg);
+    write_parameter("sum_weights_gg", sum_weights_gg);
+    write_parameter("sum_weights_qg_firstjet_quark", sum_weights_qg_firstjet_quark);
+    write_parameter("sum_weights_qg_firstjet_gluon", sum_weights_qg_firstjet_gluon);
+    write_parameter("sum_weights_non_quark_gluon_rejections", sum_weights_non_quark_gluon_rejections);
+}
+
+void
+HistogramSet::write_efficiencies(EfficiencyInterval interval) const
+{
+    TDirectory* parent = gDirectory;
+    parent->mkdir("efficiencies")->cd();
+
+    // only pt, mass and dijet mass are filled with tags
+    h_first_jet_pt->write_efficiencies(interval);
+    h_first_jet_m->write_efficiencies(interval);
+    h_second_jet_pt->write_efficiencies(interval);
+    h_second_jet_m->write_efficiencies(interval);
+    h_dijet_mass->write_efficiencies(interval);
+
+    write_roc_points(interval);
+
+    parent->cd();
+}
+
+void
+HistogramSet::write_roc_points(EfficiencyInterval interval) const
+{
+    // one entry per jet and jet tag, over all the jets filled
+    char jet[16];
+    char tag[128];
+    Efficiency quark, gluon;
+    Double_t gluon_rejection;
+
+    TTree tree("roc_points", "quark vs. gluon jet tag efficiencies");
+    tree.Branch("jet", jet, "jet/C");
+    tree.Branch("tag", tag, "tag/C");
+    tree.Branch("eff_quark", &quark.value, "eff_quark/D");
+    tree.Branch("eff_quark_low", &quark.low, "eff_quark_low/D");
+    tree.Branch("eff_quark_high", &quark.high, "eff_quark_high/D");
+    tree.Branch("eff_gluon", &gluon.value, "eff_gluon/D");
+    tree.Branch("eff_gluon_low", &gluon.low, "eff_gluon_low/D");
+    tree.Branch("eff_gluon_high", &gluon.high, "eff_gluon_high/D");
+    tree.Branch("gluon_rejection", &gluon_rejection, "gluon_rejection/D");
+
+    const struct {
+        const char* name;
+        const TH1Topo* hist;
+    } jets[] = {
+        { "first_jet"  , h_first_jet_pt.get()  },
+        { "second_jet" , h_second_jet_pt.get() }
+    };
+
+    for (auto const& j : jets) {
+        for (UInt_t id = 0; id < tags->num_jet_tags(); id++) {
+            if (!j.hist->jet_tag_efficiency(JetTopo::Quark, id, interval, quark)
+                    || !j.hist->jet_tag_efficiency(JetTopo::Gluon, id, interval, gluon))
+                continue;
+
+            std::strncpy(jet, j.name, sizeof(jet) - 1);
+            jet[sizeof(jet) - 1] = '\0';
+            std::strncpy(tag, tags->jet_tag_name(id), sizeof(tag) - 1);
+            tag[sizeof(tag) - 1] = '\0';
+
+            gluon_rejection = gluon.value > 0 ? 1. / gluon.value : 0.;
+
+            tree.Fill();
+        }
+    }
+
+    tree.Write();
+}
+
+void
+HistogramSet::write_ntrk_scans(EfficiencyInterval interval) const
+{
+    TDirectory* parent = gDirectory;
+    parent->mkdir("ntrk_scan")->cd();
+
+    ntrk_scan_first_jet_pt->write_all_histograms(interval);
+    ntrk_scan_second_jet_pt->write_all_histograms(interval);
+    ntrk_scan_dijet_mass->write_all_histograms(interval);
+
+    parent->cd();
+}
+
+void
+HistogramSet::print_summary(void) const
+{
+    auto print_percent = [] (Double_t numerator, Double_t denomenator) {
+        Double_t percent = 100.0 * numerator / denomenator;
+
+        std::stringstream ss;
+        ss.precision(4);
+
+        ss << std::fixed << numerator << " (" << percent << "%)";
+
+        std::cout << ss.str() << std::endl;
+    };
+
+    std::cout << "TOTAL EVENT WEIGHT PROCESSED: " << sum_weights_total << std::endl;
+
+    std::cout << "WEIGHT OF EVENTS PASSING BASELINE CUTS: ";
+    print_percent(sum_weights_baseline_selection, sum_weights_total);
+
+    std::cout << "WEIGHT OF BASELINE QUARK-QUARK EVENTS: ";
+    print_percent(sum_weights_qq, sum_weights_baseline_selection);
+
+    std::cout << "WEIGHT OF BASELINE QUARK-GLUON EVENTS: ";
+    print_percent(sum_weights_qg, sum_weights_baseline_selection);
+
+    std::cout << "WEIGHT OF BASELINE GLUON-GLUON EVENTS: ";
+    print_percent(sum_weights_gg, sum_weights_baseline_selection);
+
+    std::cout << "WEIGHT OF NON-QUARK-GLUON REJECTED EVENTS: ";
+    print_percent(sum_weights_non_quark_gluon_rejections, sum_weights_baseline_selection);
+
+    std::cout << std::endl;
+
+    std::cout << "IN BASELINE QUARK-GLUON EVENTS:" << std::endl;
+    std::cout << "\t" << "WEIGHT OF QUARK-INITIATED LEADING JET EVENTS: ";
+    print_percent(sum_weights_qg_firstjet_quark, sum_weights_qg);
+    std::cout << "\t" << "WEIGHT OF GLUON-INITIATED LEADING JET EVENTS: ";
+    print_percent(sum_weights_qg_firstjet_gluon, sum_weights_qg);
+}
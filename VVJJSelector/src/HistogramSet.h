@@ -0,0 +1,111 @@
+#ifndef HistogramSet_h
+#define HistogramSet_h
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <Rtypes.h>
+
+#include "CutFlow.h"
+#include "Efficiency.h"
+#include "NtrkScan.h"
+#include "TagRegistry.h"
+#include "TH1Topo.h"
+#include "TH1TopoStore.h"
+#include "THnTopo.h"
+#include "THnTopoStore.h"
+
+// The TH1Topo histograms, weight counters and cut flow filled by
+// VVJJFlavorSelector for one systematic variation (or for the nominal
+// selection).
+//
+// All the histograms are booked in the TH1TopoStore (or, for the THnTopo
+// correlation histograms, the THnTopoStore) given to the constructor, so
+// sets booked in the same order by two selectors share the same store
+// layout and are merged along with it.
+class HistogramSet {
+    private:
+        const TagRegistry* tags;
+
+        void write_roc_points(EfficiencyInterval interval) const;
+
+    public:
+        HistogramSet(const std::string& name_, TH1TopoStore* store, THnTopoStore* sparse_store,
+                const TagRegistry* tags, const std::vector<Cut>& cuts);
+
+        // "nominal", or the name of the variation
+        const std::string name;
+
+        Double_t sum_weights_total;
+        Double_t sum_weights_baseline_selection;
+        Double_t sum_weights_qq;
+        Double_t sum_weights_qg;
+        Double_t sum_weights_gg;
+        Double_t sum_weights_qg_firstjet_quark;
+        Double_t sum_weights_qg_firstjet_gluon;
+        Double_t sum_weights_non_quark_gluon_rejections;
+
+        std::unique_ptr<TH1Topo> h_first_jet_pt;
+        std::unique_ptr<TH1Topo> h_first_jet_eta;
+        std::unique_ptr<TH1Topo> h_first_jet_phi;
+        std::unique_ptr<TH1Topo> h_first_jet_m;
+        std::unique_ptr<TH1Topo> h_first_jet_D2;
+        std::unique_ptr<TH1Topo> h_first_jet_ungNtrk;
+
+        std::unique_ptr<TH1Topo> h_second_jet_pt;
+        std::unique_ptr<TH1Topo> h_second_jet_eta;
+        std::unique_ptr<TH1Topo> h_second_jet_phi;
+        std::unique_ptr<TH1Topo> h_second_jet_m;
+        std::unique_ptr<TH1Topo> h_second_jet_D2;
+        std::unique_ptr<TH1Topo> h_second_jet_ungNtrk;
+
+        std::unique_ptr<TH1Topo> h_dijet_mass;
+
+        // correlations, jet tagged (ntrk and D2) or event tagged (dijet mass)
+        std::unique_ptr<THnTopo> hn_first_jet_ntrk_pt;
+        std::unique_ptr<THnTopo> hn_second_jet_ntrk_pt;
+        std::unique_ptr<THnTopo> hn_first_jet_D2_m;
+        std::unique_ptr<THnTopo> hn_second_jet_D2_m;
+        std::unique_ptr<THnTopo> hn_dijet_mass_first_jet_m;
+
+        std::unique_ptr<CutFlow> cut_flow;
+
+        // ntrk_max working point scans of the jet tags (in the jet pt) and
+        // of the event tags (in the dijet mass)
+        std::unique_ptr<NtrkScan> ntrk_scan_first_jet_pt;
+        std::unique_ptr<NtrkScan> ntrk_scan_second_jet_pt;
+        std::unique_ptr<NtrkScan> ntrk_scan_dijet_mass;
+
+        // add the counters of other (the histograms are merged by the store)
+        void merge_counters(const HistogramSet& other);
+
+        // write the counters, or add counters written by a set of the same
+        // name (the histograms are saved with the stores)
+        void write_counters(std::ostream& out) const;
+        bool add_counters(std::istream& in);
+
+        // write every histogram to the current ROOT directory
+        void write_all_histograms(void) const;
+
+        // write the sum_weights_* counters to the current ROOT directory, as
+        // TParameter<Double_t> of the same names
+        void write_sum_weights(void) const;
+
+        // Write the efficiency of every tag of the tagged histograms (see
+        // TH1Topo::write_efficiencies) to an "efficiencies" directory of the
+        // current ROOT directory, along with a "roc_points" TTree holding
+        // the quark and gluon jet efficiency of every jet tag.
+        void write_efficiencies(EfficiencyInterval interval) const;
+
+        // write the ntrk_max scans (see NtrkScan::write_all_histograms) to an
+        // "ntrk_scan" directory of the current ROOT directory
+        void write_ntrk_scans(EfficiencyInterval interval) const;
+
+        // print the weight fractions passing each step of the selection
+        void print_summary(void) const;
+};
+
+#endif // #ifdef HistogramSet_h
@@ -0,0 +1,244 @@
+#define IncrementalCache_cxx
+
+#include <TSystem.h>
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "IncrementalCache.h"
+
+static const int MANIFEST_FORMAT_VERSION = 1;
+static const char* const MANIFEST_HEADER = "vvjj-incremental-manifest";
+
+static bool
+file_exists(const std::string& path)
+{
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode);
+}
+
+bool
+checksum_file(const std::string& path, ULong64_t& checksum)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    std::vector<char> buffer(1 << 20);
+    ULong64_t hash = 0xcbf29ce484222325ULL;
+
+    while (file) {
+        file.read(buffer.data(), buffer.size());
+        const std::streamsize count = file.gcount();
+
+        for (std::streamsize i = 0; i < count; i++) {
+            hash ^= static_cast<unsigned char>(buffer[i]);
+            hash *= 0x100000001b3ULL;
+        }
+    }
+
+    if (file.bad())
+        return false;
+
+    checksum = hash;
+    return true;
+}
+
+IncrementalCache::IncrementalCache(std::string cache_dir_, ULong64_t config_hash_) :
+    cache_dir(cache_dir_),
+    config_hash(config_hash_)
+{
+    gSystem->mkdir(cache_dir.c_str(), kTRUE);
+}
+
+bool
+IncrementalCache::load(void)
+{
+    entries.clear();
+
+    std::ifstream manifest(manifest_path().c_str());
+    if (!manifest.is_open())
+        return true;
+
+    std::string header;
+    int version = 0;
+    if (!(manifest >> header >> version) || header != MANIFEST_HEADER
+            || version != MANIFEST_FORMAT_VERSION) {
+        std::cout << "ERROR: unknown incremental manifest format: " << manifest_path() << std::endl;
+        return false;
+    }
+
+    std::string line;
+    std::getline(manifest, line);
+
+    while (std::getline(manifest, line)) {
+        if (line.empty()) continue;
+
+        std::istringstream ss(line);
+        Entry entry;
+
+        // the path comes last, it may hold spaces
+        ss >> std::hex >> entry.config_hash >> entry.checksum >> std::dec
+            >> entry.size >> entry.mtime >> entry.state_file;
+        if (ss) std::getline(ss >> std::ws, entry.path);
+
+        if (entry.path.empty()) {
+            std::cout << "ERROR: malformed incremental manifest line: " << line << std::endl;
+            return false;
+        }
+
+        entries.push_back(entry);
+    }
+
+    return true;
+}
+
+bool
+IncrementalCache::write_manifest(void) const
+{
+    const std::string path = manifest_path();
+    const std::string tmp_path = path + ".tmp";
+
+    std::ofstream manifest(tmp_path.c_str(), std::ios::trunc);
+    manifest << MANIFEST_HEADER << " " << MANIFEST_FORMAT_VERSION << std::endl;
+
+    for (auto const& entry : entries) {
+        manifest << std::hex << std::setw(16) << std::setfill('0') << entry.config_hash
+            << " " << std::setw(16) << entry.checksum << std::dec << std::setfill(' ')
+            << " " << entry.size << " " << entry.mtime
+            << " " << entry.state_file << " " << entry.path << std::endl;
+    }
+
+    manifest.close();
+
+    if (!manifest || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::cout << "ERROR: failed to write incremental manifest: " << path << std::endl;
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+IncrementalCache::Entry*
+IncrementalCache::find_entry(const std::string& path)
+{
+    for (auto& entry : entries) {
+        if (entry.config_hash == config_hash && entry.path == path)
+            return &entry;
+    }
+
+    return nullptr;
+}
+
+bool
+IncrementalCache::lookup(const std::string& input_path, std::string& state_path)
+{
+    state_path.clear();
+
+    // e.g. remote (root://) inputs are never cached
+    struct stat info;
+    if (stat(input_path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+        return false;
+
+    const Long64_t size = info.st_size;
+    const Long64_t mtime = info.st_mtime;
+
+    Entry* entry = find_entry(input_path);
+
+    // unchanged metadata, trust the checksum of the manifest
+    if (entry && entry->size == size && entry->mtime == mtime
+            && file_exists(cache_dir + "/" + entry->state_file)) {
+        state_path = cache_dir + "/" + entry->state_file;
+        return true;
+    }
+
+    ULong64_t checksum;
+    if (!checksum_file(input_path, checksum))
+        return false;
+
+    // touched (or moved) but with the same contents
+    std::string same_state_file;
+    for (auto const& other : entries) {
+        if (other.config_hash == config_hash && other.checksum == checksum && other.size == size
+                && file_exists(cache_dir + "/" + other.state_file))
+            same_state_file = other.state_file;
+    }
+
+    if (!same_state_file.empty()) {
+        if (entry == nullptr) {
+            entries.push_back(Entry());
+            entry = &entries.back();
+        }
+
+        entry->config_hash = config_hash;
+        entry->checksum = checksum;
+        entry->size = size;
+        entry->mtime = mtime;
+        entry->state_file = same_state_file;
+        entry->path = input_path;
+
+        state_path = cache_dir + "/" + same_state_file;
+        return write_manifest();
+    }
+
+    std::stringstream ss;
+    ss << std::hex << std::setfill('0') << std::setw(16) << checksum << "-"
+        << std::setw(16) << config_hash << ".state";
+
+    Entry& pending_entry = pending[input_path];
+    pending_entry.config_hash = config_hash;
+    pending_entry.checksum = checksum;
+    pending_entry.size = size;
+    pending_entry.mtime = mtime;
+    pending_entry.state_file = ss.str();
+    pending_entry.path = input_path;
+
+    state_path = cache_dir + "/" + pending_entry.state_file;
+    return false;
+}
+
+bool
+IncrementalCache::commit(const std::string& input_path)
+{
+    auto it = pending.find(input_path);
+    if (it == pending.end())
+        return false;
+
+    const Entry committed = it->second;
+    pending.erase(it);
+
+    if (!file_exists(cache_dir + "/" + committed.state_file)) {
+        std::cout << "WARNING: no partial result saved for: " << input_path << std::endl;
+        return false;
+    }
+
+    std::string replaced_state_file;
+
+    Entry* entry = find_entry(input_path);
+    if (entry != nullptr) {
+        replaced_state_file = entry->state_file;
+        *entry = committed;
+    } else {
+        entries.push_back(committed);
+    }
+
+    // drop the partial result of the old contents, unless another input shares it
+    if (!replaced_state_file.empty() && replaced_state_file != committed.state_file) {
+        bool shared = false;
+        for (auto const& other : entries) {
+            shared = shared || other.state_file == replaced_state_file;
+        }
+
+        if (!shared)
+            std::remove((cache_dir + "/" + replaced_state_file).c_str());
+    }
+
+    return write_manifest();
+}
@@ -0,0 +1,67 @@
+#ifndef IncrementalCache_h
+#define IncrementalCache_h
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <Rtypes.h>
+
+// The per-input-file partial results of earlier runs, for --incremental.
+//
+// The partial result of an input file is the state file (see
+// VVJJFlavorSelector::write_state()) of a selector that processed only that
+// file. Each one is recorded in a plain text manifest in the cache directory,
+// keyed by the path, size, modification time and checksum of the input file
+// and by the config_hash() of the SelectionConfig, so that changing either
+// the input or the config invalidates it. Only inputs whose size or
+// modification time changed are checksummed again, so a rerun over
+// unchanged files reads nothing but their metadata.
+//
+// The manifest is rewritten (to a temporary name, then renamed into place)
+// after every committed file, so an interrupted run keeps the partial results
+// of the files it finished.
+class IncrementalCache {
+    private:
+        struct Entry {
+            ULong64_t config_hash;
+            ULong64_t checksum;
+            Long64_t size;
+            Long64_t mtime;
+            std::string state_file;
+            std::string path;
+        };
+
+        const std::string cache_dir;
+        const ULong64_t config_hash;
+
+        std::vector<Entry> entries;
+
+        // entries of the inputs being processed, until they are committed
+        std::map<std::string, Entry> pending;
+
+        std::string manifest_path(void) const { return cache_dir + "/manifest"; }
+        Entry* find_entry(const std::string& path);
+        bool write_manifest(void) const;
+
+    public:
+        IncrementalCache(std::string cache_dir_, ULong64_t config_hash_);
+
+        // read the manifest (if any), returns false if it is malformed
+        bool load(void);
+
+        // If an up to date partial result of input_path exists, set
+        // state_path to it and return true. Otherwise return false and, if
+        // input_path is a local file, set state_path to where the partial
+        // result of this pass must be saved before commit() (empty if it
+        // can't be cached).
+        bool lookup(const std::string& input_path, std::string& state_path);
+
+        // record the partial result saved for input_path since lookup()
+        bool commit(const std::string& input_path);
+};
+
+// FNV-1a hash of the contents of the file at path, false if it can't be read
+bool checksum_file(const std::string& path, ULong64_t& checksum);
+
+#endif // #ifdef IncrementalCache_h
@@ -0,0 +1,145 @@
+#define LazyBranchReader_cxx
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "BlockReader.h"
+#include "LazyBranchReader.h"
+#include "SelectionConfig.h"
+
+static_assert(NUM_EVENT_COLUMNS <= 64, "the columns read for an entry are tracked in a ULong64_t");
+
+LazyBranchReader::LazyBranchReader(const CutProgram& program_,
+        TBranch** const column_branches_[NUM_EVENT_COLUMNS]) :
+    program(program_),
+    columns_read(0),
+    num_events(0)
+{
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        column_branches[col] = column_branches_[col];
+        column_costs[col] = 1.;
+    }
+
+    // config order, until the first reorder()
+    for (UInt_t cut = 0; cut < program.get_instructions().size(); cut++) {
+        order.push_back(CutStats {cut, 0, 0});
+    }
+}
+
+void
+LazyBranchReader::begin_tree(TTree* tree)
+{
+    Long64_t compressed_bytes[NUM_EVENT_COLUMNS];
+    Long64_t uncompressed_bytes[NUM_EVENT_COLUMNS];
+
+    BlockReader::column_bytes(tree, compressed_bytes, uncompressed_bytes);
+
+    const Double_t num_entries = std::max<Long64_t>(tree->GetEntries(), 1);
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        column_costs[col] = std::max(uncompressed_bytes[col] / num_entries, 1.);
+    }
+
+    reorder();
+}
+
+void
+LazyBranchReader::read_column(UInt_t column, Long64_t entry)
+{
+    const ULong64_t bit = ULong64_t(1) << column;
+    if (columns_read & bit)
+        return;
+
+    (*column_branches[column])->GetEntry(entry);
+    columns_read |= bit;
+}
+
+void
+LazyBranchReader::reorder(void)
+{
+    // Greedy: the next cut is the one rejecting the most per byte read,
+    // given the columns the cuts before it already read.
+    const std::vector<CutProgram::Instruction>& instructions = program.get_instructions();
+
+    ULong64_t columns = 0;
+    for (size_t i = 0; i < order.size(); i++) {
+        auto best = order.begin() + i;
+        Double_t best_rank = -1.;
+
+        for (auto it = order.begin() + i; it != order.end(); ++it) {
+            const UInt_t column = instructions[it->cut].column;
+            const Double_t cost = (columns >> column) & 1 ? 1. : column_costs[column];
+            const Double_t rank = it->rejection_rate() / cost;
+
+            if (rank > best_rank) {
+                best = it;
+                best_rank = rank;
+            }
+        }
+
+        std::iter_swap(order.begin() + i, best);
+        columns |= ULong64_t(1) << instructions[order[i].cut].column;
+    }
+}
+
+Int_t
+LazyBranchReader::read_selection(Long64_t entry, const Double_t* const column_values[NUM_EVENT_COLUMNS])
+{
+    if (++num_events % REORDER_INTERVAL == 0)
+        reorder();
+
+    columns_read = 0;
+    read_column(COL_weight, entry);
+    read_column(COL_pileup_weight, entry);
+
+    const std::vector<CutProgram::Instruction>& instructions = program.get_instructions();
+
+    for (auto& stats : order) {
+        read_column(instructions[stats.cut].column, entry);
+        stats.num_evaluated++;
+
+        if (program.fails(stats.cut, column_values)) {
+            stats.num_rejected++;
+            return stats.cut;
+        }
+    }
+
+    return -1;
+}
+
+void
+LazyBranchReader::read_rest(Long64_t entry)
+{
+    for (UInt_t col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        read_column(col, entry);
+    }
+}
+
+void
+LazyBranchReader::print_summary(const std::vector<Cut>& cuts) const
+{
+    size_t cut_width = 3;
+    for (auto const& cut : cuts) {
+        cut_width = std::max(cut_width, SelectionConfig::format_cut(cut).size());
+    }
+
+    std::cout << "LAZY BRANCH READING, CUTS IN EVALUATION ORDER:" << std::endl;
+    std::cout << "\t" << std::left << std::setw(cut_width) << "CUT" << std::right
+        << std::setw(12) << "EVALUATED" << std::setw(12) << "REJECTED" << std::setw(12) << "BYTES"
+        << std::endl;
+
+    for (auto const& stats : order) {
+        std::stringstream rejected;
+        rejected.precision(2);
+        rejected << std::fixed << (stats.num_evaluated > 0 ? 100.0 * stats.num_rejected / stats.num_evaluated : 0.)
+            << "%";
+
+        std::cout << "\t" << std::left << std::setw(cut_width) << SelectionConfig::format_cut(cuts[stats.cut])
+            << std::right
+            << std::setw(12) << stats.num_evaluated
+            << std::setw(12) << rejected.str()
+            << std::setw(12) << static_cast<Long64_t>(column_costs[cuts[stats.cut].column])
+            << std::endl;
+    }
+}
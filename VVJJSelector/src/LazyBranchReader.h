@@ -0,0 +1,77 @@
+#ifndef LazyBranchReader_h
+#define LazyBranchReader_h
+
+#include <vector>
+
+#include <Rtypes.h>
+#include <TBranch.h>
+#include <TTree.h>
+
+#include "BaselineSelection.h"
+#include "EventBlock.h"
+
+// Reads the event columns of the sequential event loop lazily, for
+// --lazy-branches: the column of each cut of the baseline selection is only
+// read (i.e. its basket decompressed and the value unpacked) once the event
+// has passed the cuts before it, and the remaining columns only for events
+// passing every cut.
+//
+// The cuts are evaluated cheapest and most rejecting first: every
+// REORDER_INTERVAL events they are greedily reordered by their observed
+// rejection rate (among the events that reached them) over the cost of
+// reading their column, i.e. its uncompressed bytes per entry in the current
+// tree (nothing for a column an earlier cut already read).
+class LazyBranchReader {
+    private:
+        struct CutStats {
+            UInt_t cut;
+            ULong64_t num_evaluated;
+            ULong64_t num_rejected;
+
+            // smoothed, so that a cut not evaluated yet is neither favored nor ruled out
+            Double_t rejection_rate(void) const {
+                return (num_rejected + 1.) / (num_evaluated + 2.);
+            }
+        };
+
+        const CutProgram& program;
+
+        // the selector's branch pointer of each column
+        TBranch** column_branches[NUM_EVENT_COLUMNS];
+
+        // uncompressed bytes per entry of each column in the current tree
+        Double_t column_costs[NUM_EVENT_COLUMNS];
+
+        // the cuts, in evaluation order
+        std::vector<CutStats> order;
+
+        // the columns read for the current entry, one bit per EventColumn
+        ULong64_t columns_read;
+
+        ULong64_t num_events;
+
+        void read_column(UInt_t column, Long64_t entry);
+        void reorder(void);
+
+    public:
+        static const UInt_t REORDER_INTERVAL = 4096;
+
+        LazyBranchReader(const CutProgram& program_, TBranch** const column_branches_[NUM_EVENT_COLUMNS]);
+
+        // take the column costs of a new tree of the chain
+        void begin_tree(TTree* tree);
+
+        // Read weight and pileup_weight, then the columns of the cuts in
+        // order until one rejects the event. Returns the index (in config
+        // order) of that cut, or -1 if the event passes every cut.
+        Int_t read_selection(Long64_t entry, const Double_t* const column_values[NUM_EVENT_COLUMNS]);
+
+        // read every column read_selection() left out
+        void read_rest(Long64_t entry);
+
+        // print the cuts (cuts being those program was compiled from) in
+        // their current order, with their rejection rates
+        void print_summary(const std::vector<Cut>& cuts) const;
+};
+
+#endif // #ifdef LazyBranchReader_h
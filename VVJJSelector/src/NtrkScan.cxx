@@ -0,0 +1,217 @@
+#define NtrkScan_cxx
+
+#include <TH2D.h>
+#include <TGraphAsymmErrors.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "NtrkScan.h"
+
+NtrkScan::NtrkScan(TH1TopoStore* store_, const TagRegistry* tags, bool event_tags_, std::string var_name_,
+        float x_min_, float x_max_, float bin_spacing_) :
+    store(store_),
+    store_offset(0),
+    event_tags(event_tags_),
+    num_topologies(event_tags_ ? 3 : 2),
+    var_name(var_name_),
+    x_min(x_min_),
+    x_max(x_max_),
+    bin_spacing(bin_spacing_),
+    num_bins( (x_max - x_min) / bin_spacing )
+{
+    const UInt_t num_tags = event_tags ? tags->num_event_tags() : tags->num_jet_tags();
+
+    for (UInt_t id = 0; id < num_tags; id++) {
+        Slot slot;
+        if (event_tags) {
+            const TagRegistry::EventTagDef& def = tags->event_tag(id);
+            slot.first_jet_components = def.first_jet_required_components & ~PassNtrk;
+            slot.second_jet_components = def.second_jet_required_components & ~PassNtrk;
+            slot.first_jet_ntrk = def.first_jet_required_components & PassNtrk;
+            slot.second_jet_ntrk = def.second_jet_required_components & PassNtrk;
+        } else {
+            const TagRegistry::JetTagDef& def = tags->jet_tag(id);
+            slot.first_jet_components = def.required_components & ~PassNtrk;
+            slot.second_jet_components = 0;
+            slot.first_jet_ntrk = def.required_components & PassNtrk;
+            slot.second_jet_ntrk = false;
+        }
+
+        // tags without an ntrk requirement have nothing to scan
+        if (!slot.first_jet_ntrk && !slot.second_jet_ntrk) continue;
+
+        UInt_t index = 0;
+        while (index < slots.size()
+                && !(slots[index].first_jet_components == slot.first_jet_components
+                    && slots[index].second_jet_components == slot.second_jet_components
+                    && slots[index].first_jet_ntrk == slot.first_jet_ntrk
+                    && slots[index].second_jet_ntrk == slot.second_jet_ntrk))
+            index++;
+
+        if (index == slots.size()) slots.push_back(slot);
+
+        ScannedTag scanned;
+        scanned.name = event_tags ? tags->event_tag_name(id) : tags->jet_tag_name(id);
+        scanned.slot = index;
+        scanned_tags.push_back(scanned);
+    }
+
+    if (slots.empty()) return;
+
+    // (sumw, sumw2) for every observable bin, then a multiplicity histogram
+    // for every slot and observable bin, including underflow/overflow
+    store_offset = store->allocate(num_topologies * (num_bins + 2) * (2 + slots.size() * NUM_NTRK_BINS));
+}
+
+int
+NtrkScan::find_bin(double x) const
+{
+    // same binning as TH1Topo::find_bin
+    if (x < x_min) {
+        return 0;
+    } else if (!(x < x_max)) {
+        return num_bins + 1;
+    } else {
+        return 1 + int(num_bins * (x - (double) x_min) / ((double) x_max - (double) x_min));
+    }
+}
+
+int
+NtrkScan::find_ntrk_bin(Double_t ntrk)
+{
+    // a jet passes ntrk_max when ntrk < ntrk_max, i.e. floor(ntrk) < ntrk_max
+    // for an integer ntrk_max, so bin k holds floor(ntrk) = k and the last
+    // bin (never passing) everything from MAX_THRESHOLD up, including NaN
+    if (ntrk < 0) {
+        return 0;
+    } else if (!(ntrk < MAX_THRESHOLD)) {
+        return MAX_THRESHOLD;
+    } else {
+        return int(ntrk);
+    }
+}
+
+void
+NtrkScan::fill(UInt_t topo, UInt_t first_jet_components, UInt_t second_jet_components,
+        Double_t first_jet_ntrk, Double_t second_jet_ntrk, float val, float weight)
+{
+    if (slots.empty()) return;
+
+    const int bin = find_bin(val);
+
+    Double_t* bin_totals = totals(topo) + 2 * bin;
+    bin_totals[0] += weight;
+    bin_totals[1] += weight * weight;
+
+    const int first_jet_ntrk_bin = find_ntrk_bin(first_jet_ntrk);
+    const int second_jet_ntrk_bin = find_ntrk_bin(second_jet_ntrk);
+
+    for (UInt_t slot = 0; slot < slots.size(); slot++) {
+        const Slot& s = slots[slot];
+        if ((first_jet_components & s.first_jet_components) != s.first_jet_components
+                || (second_jet_components & s.second_jet_components) != s.second_jet_components)
+            continue;
+
+        // an event passes when every jet requiring ntrk does
+        int ntrk_bin = 0;
+        if (s.first_jet_ntrk) ntrk_bin = first_jet_ntrk_bin;
+        if (s.second_jet_ntrk) ntrk_bin = std::max(ntrk_bin, second_jet_ntrk_bin);
+
+        counts(topo, slot, bin)[ntrk_bin] += weight;
+    }
+}
+
+void
+NtrkScan::fill_jet_topo(JetTopo jet_topo, UInt_t components, Double_t ntrk, float val, float weight)
+{
+    fill(static_cast<UInt_t>(jet_topo), components, 0, ntrk, 0, val, weight);
+}
+
+void
+NtrkScan::fill_event_topo(EventFlavorTopo event_topo, UInt_t first_jet_components,
+        UInt_t second_jet_components, Double_t first_jet_ntrk, Double_t second_jet_ntrk,
+        float val, float weight)
+{
+    fill(static_cast<UInt_t>(event_topo), first_jet_components, second_jet_components,
+            first_jet_ntrk, second_jet_ntrk, val, weight);
+}
+
+void
+NtrkScan::write_all_histograms(EfficiencyInterval interval) const
+{
+    static const char* const jet_topology_suffixes[] = { "_q", "_g" };
+    static const char* const event_topology_suffixes[] = { "_qq", "_qg", "_gg" };
+
+    for (auto const& scanned : scanned_tags) {
+        for (UInt_t topo = 0; topo < num_topologies; topo++) {
+            const Double_t* bin_totals = totals(topo);
+
+            // skip tags that were never passed, like TH1Topo
+            bool filled = false;
+            for (int bin = 0; bin < num_bins + 2 && !filled; bin++) {
+                const Double_t* ntrk_counts = counts(topo, scanned.slot, bin);
+                for (int ntrk_bin = 0; ntrk_bin < NUM_NTRK_BINS; ntrk_bin++) {
+                    if (ntrk_counts[ntrk_bin] != 0) filled = true;
+                }
+            }
+            if (!filled) continue;
+
+            const std::string name = var_name + "_" + scanned.name
+                + (event_tags ? event_topology_suffixes[topo] : jet_topology_suffixes[topo])
+                + "_ntrk_scan";
+
+            // y bin N holds the efficiency for ntrk_max = N
+            TH2D map(name.c_str(), name.c_str(), num_bins, x_min, x_max,
+                    MAX_THRESHOLD, 0.5, MAX_THRESHOLD + 0.5);
+            map.SetDirectory(nullptr);
+
+            TGraphAsymmErrors graph;
+            graph.SetName((name + "_eff").c_str());
+            graph.SetTitle((name + "_eff").c_str());
+
+            // the passing weight at ntrk_max = N is the cumulative sum of
+            // the multiplicity bins below N
+            std::vector<Double_t> passed_all_bins(MAX_THRESHOLD + 1, 0.);
+            Double_t total_sumw = 0, total_sumw2 = 0;
+
+            for (int bin = 0; bin < num_bins + 2; bin++) {
+                const Double_t* ntrk_counts = counts(topo, scanned.slot, bin);
+                total_sumw  += bin_totals[2 * bin];
+                total_sumw2 += bin_totals[2 * bin + 1];
+
+                Double_t passed = 0;
+                for (int threshold = 1; threshold <= MAX_THRESHOLD; threshold++) {
+                    passed += ntrk_counts[threshold - 1];
+                    passed_all_bins[threshold] += passed;
+
+                    // under/overflow only enter the graph
+                    if (bin == 0 || bin > num_bins) continue;
+
+                    Efficiency eff;
+                    if (!compute_efficiency(passed, bin_totals[2 * bin], bin_totals[2 * bin + 1],
+                                interval, eff))
+                        continue;
+
+                    map.SetBinContent(bin, threshold, eff.value);
+                    map.SetBinError(bin, threshold, 0.5 * (eff.high - eff.low));
+                }
+            }
+
+            for (int threshold = 1; threshold <= MAX_THRESHOLD; threshold++) {
+                Efficiency eff;
+                if (!compute_efficiency(passed_all_bins[threshold], total_sumw, total_sumw2,
+                            interval, eff))
+                    continue;
+
+                const Int_t point = graph.GetN();
+                graph.SetPoint(point, threshold, eff.value);
+                graph.SetPointError(point, 0.5, 0.5,
+                        std::max(eff.value - eff.low, 0.), std::max(eff.high - eff.value, 0.));
+            }
+
+            map.Write();
+            graph.Write();
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef NtrkScan_h
+#define NtrkScan_h
+
+#include <string>
+#include <vector>
+
+#include <Rtypes.h>
+
+#include "Efficiency.h"
+#include "TagRegistry.h"
+#include "TH1Topo.h"
+#include "TH1TopoStore.h"
+
+// A scan of the ntrk_max working point of the tags with an ntrk component,
+// filled in a single pass.
+//
+// For every tag requiring ntrk, the jets (or events) passing its other
+// components are histogrammed in an observable against their ungroomed track
+// multiplicity, split by flavor topology. As a jet passes ntrk for
+// ntrk < ntrk_max, the cumulative sum over the multiplicity gives the tag
+// efficiency at every integer ntrk_max from 1 to MAX_THRESHOLD, in every
+// observable bin. For event tags the multiplicity is the largest one of the
+// jets whose requirements include ntrk.
+//
+// Like TH1Topo, the bin contents live in a region of a TH1TopoStore, laid
+// out as [topology][slot][observable bin][multiplicity], where tags with
+// the same requirements besides ntrk share a slot.
+class NtrkScan {
+    public:
+        static const int MAX_THRESHOLD = 100;
+
+    private:
+        static const int NUM_NTRK_BINS = MAX_THRESHOLD + 1;
+
+        // the requirements of a slot besides ntrk, and which jets need ntrk
+        struct Slot {
+            UInt_t first_jet_components;
+            UInt_t second_jet_components;
+            bool first_jet_ntrk;
+            bool second_jet_ntrk;
+        };
+
+        struct ScannedTag {
+            std::string name;
+            UInt_t slot;
+        };
+
+        TH1TopoStore* store;  //!
+        size_t store_offset;  //!
+
+        const bool event_tags;
+        const UInt_t num_topologies;
+
+        std::vector<Slot> slots;
+        std::vector<ScannedTag> scanned_tags;
+
+        // the total weight (sumw, sumw2) of each observable bin, per topology
+        Double_t* totals(UInt_t topo) {
+            return store->data(store_offset + topo * 2 * (num_bins + 2));
+        }
+        const Double_t* totals(UInt_t topo) const {
+            return store->data(store_offset + topo * 2 * (num_bins + 2));
+        }
+
+        Double_t* counts(UInt_t topo, UInt_t slot, int bin) {
+            return store->data(counts_offset(topo, slot, bin));
+        }
+        const Double_t* counts(UInt_t topo, UInt_t slot, int bin) const {
+            return store->data(counts_offset(topo, slot, bin));
+        }
+
+        size_t counts_offset(UInt_t topo, UInt_t slot, int bin) const {
+            return store_offset + num_topologies * 2 * (num_bins + 2)
+                + ((topo * slots.size() + slot) * (num_bins + 2) + bin) * NUM_NTRK_BINS;
+        }
+
+        int find_bin(double x) const;
+        static int find_ntrk_bin(Double_t ntrk);
+        void fill(UInt_t topo, UInt_t first_jet_components, UInt_t second_jet_components,
+                Double_t first_jet_ntrk, Double_t second_jet_ntrk, float val, float weight);
+
+    public:
+        // A scan of the jet tags (filled with fill_jet_topo) or the event
+        // tags (filled with fill_event_topo) of tags, which must outlive it.
+        NtrkScan(TH1TopoStore* store_, const TagRegistry* tags, bool event_tags_, std::string var_name_,
+                float x_min_, float x_max_, float bin_spacing_);
+
+        const std::string var_name;
+        const float x_min;
+        const float x_max;
+        const float bin_spacing;
+        const int num_bins;
+
+        void fill_jet_topo(JetTopo jet_topo, UInt_t components, Double_t ntrk, float val, float weight);
+        void fill_event_topo(EventFlavorTopo event_topo, UInt_t first_jet_components,
+                UInt_t second_jet_components, Double_t first_jet_ntrk, Double_t second_jet_ntrk,
+                float val, float weight);
+
+        // Write, for each scanned tag and topology, a TH2D of the efficiency
+        // against the observable and ntrk_max (<name>_<tag><topology>_ntrk_scan)
+        // and a TGraphAsymmErrors of the efficiency over all observable bins
+        // against ntrk_max (the same with an "_eff" suffix).
+        void write_all_histograms(EfficiencyInterval interval) const;
+};
+
+#endif // #ifdef NtrkScan_h
@@ -0,0 +1,201 @@
+#define OutputWriter_cxx
+
+#include <Compression.h>
+#include <TKey.h>
+#include <TROOT.h>
+#include <TTree.h>
+
+#include <iostream>
+#include <set>
+#include <stdexcept>
+
+#include "OutputWriter.h"
+
+bool
+parse_compression(const std::string& spec, Int_t& compression_settings)
+{
+    const size_t colon = spec.find(':');
+    const std::string algorithm = spec.substr(0, colon);
+
+    Int_t level = -1;
+    if (colon != std::string::npos) {
+        try {
+            level = std::stoi(spec.substr(colon + 1));
+        } catch (const std::exception&) {
+            return false;
+        }
+
+        if (level < 0 || level > 9)
+            return false;
+    }
+
+    if (algorithm == "zlib") {
+        compression_settings = ROOT::CompressionSettings(ROOT::kZLIB, level < 0 ? 1 : level);
+    } else if (algorithm == "lzma") {
+        compression_settings = ROOT::CompressionSettings(ROOT::kLZMA, level < 0 ? 1 : level);
+    } else if (algorithm == "lz4") {
+        compression_settings = ROOT::CompressionSettings(ROOT::kLZ4, level < 0 ? 4 : level);
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,20,0)
+    } else if (algorithm == "zstd") {
+        compression_settings = ROOT::CompressionSettings(ROOT::kZSTD, level < 0 ? 5 : level);
+#endif
+    } else if (algorithm == "none" && colon == std::string::npos) {
+        compression_settings = 0;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+OutputWriter::OutputWriter(std::string output_path_, Int_t compression_settings_) :
+    output_path(output_path_),
+    compression_settings(compression_settings_),
+    stopping(false),
+    failed(false)
+{
+    // the event loop keeps reading while this writes
+    ROOT::EnableThreadSafety();
+
+    writer = std::thread(&OutputWriter::run_writer, this);
+}
+
+OutputWriter::~OutputWriter(void)
+{
+    finish();
+}
+
+void
+OutputWriter::submit(const std::string& generator, std::unique_ptr<TMemFile> contents)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(Job {generator, std::move(contents)});
+    }
+    cond.notify_one();
+}
+
+bool
+OutputWriter::finish(void)
+{
+    if (writer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cond.notify_one();
+        writer.join();
+    }
+
+    return !failed;
+}
+
+bool
+OutputWriter::copy_directory(TDirectory* src, TDirectory* dst, const std::string& suffix)
+{
+    bool ok = true;
+    std::set<std::string> names;
+
+    TIter next(src->GetListOfKeys());
+    TKey* key;
+
+    while ((key = static_cast<TKey*>(next()))) {
+        const std::string name = key->GetName();
+
+        // the keys of older cycles follow the latest one
+        if (!names.insert(name).second)
+            continue;
+
+        if (std::string(key->GetClassName()) == "TDirectoryFile") {
+            TDirectory* subdir = dst->mkdir(name.c_str(), "", kTRUE);
+            ok = subdir && copy_directory(src->GetDirectory(name.c_str()), subdir, suffix) && ok;
+            continue;
+        }
+
+        std::unique_ptr<TObject> object(key->ReadObj());
+        if (!object) {
+            ok = false;
+            continue;
+        }
+
+        const std::string new_name = name + suffix;
+
+        // trees are cloned into the output, the rest written as is
+        if (TTree* tree = dynamic_cast<TTree*>(object.get())) {
+            dst->cd();
+            std::unique_ptr<TTree> copy(tree->CloneTree(-1, "fast"));
+            copy->SetName(new_name.c_str());
+            ok = copy->Write() > 0 && ok;
+            copy->SetDirectory(nullptr);
+            continue;
+        }
+
+        if (TNamed* named = dynamic_cast<TNamed*>(object.get()))
+            named->SetName(new_name.c_str());
+
+        ok = dst->WriteTObject(object.get(), new_name.c_str()) > 0 && ok;
+    }
+
+    return ok;
+}
+
+void
+OutputWriter::run_writer(void)
+{
+    // gDirectory is per thread, the output file is only ever touched here
+    TDirectory::TContext context;
+
+    std::unique_ptr<TFile> output_file(new TFile(output_path.c_str(), "RECREATE", "", compression_settings));
+    if (output_file->IsZombie()) {
+        std::cout << "ERROR: failed to create output file: " << output_path << std::endl;
+        output_file.reset();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        cond.wait(lock, [this] { return !jobs.empty() || stopping; });
+        if (jobs.empty()) break;
+
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        lock.unlock();
+
+        bool ok = output_file != nullptr;
+
+        if (ok) {
+            const std::string suffix = job.generator.empty() ? "" : "_" + job.generator;
+
+            // <set>/<gen>/... for each histogram set of the output
+            TIter next(job.contents->GetListOfKeys());
+            TKey* key;
+            while ((key = static_cast<TKey*>(next()))) {
+                TDirectory* dst = output_file->mkdir(key->GetName(), "", kTRUE);
+                if (dst && !job.generator.empty())
+                    dst = dst->mkdir(job.generator.c_str(), "", kTRUE);
+
+                ok = dst && copy_directory(job.contents->GetDirectory(key->GetName()), dst, suffix) && ok;
+            }
+
+            if (ok)
+                std::cout << "output of " << (job.generator.empty() ? "the run" : job.generator)
+                    << " written to: " << output_path << std::endl;
+        }
+
+        job.contents->Close();
+        job.contents.reset();
+
+        lock.lock();
+
+        if (!ok && output_file) {
+            std::cout << "ERROR: failed to write the output of " << job.generator << " to: "
+                << output_path << std::endl;
+        }
+        failed = failed || !ok;
+    }
+
+    lock.unlock();
+
+    if (output_file)
+        output_file->Close();
+}
@@ -0,0 +1,65 @@
+#ifndef OutputWriter_h
+#define OutputWriter_h
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <TDirectory.h>
+#include <TFile.h>
+#include <TMemFile.h>
+
+// The compression of the output file, e.g. "lz4", "zstd:5" or "zlib:1" (the
+// level defaults to ROOT's for the algorithm). Returns false if the
+// algorithm is unknown (or unavailable in this ROOT version).
+bool parse_compression(const std::string& spec, Int_t& compression_settings);
+
+// Writes the outputs of every generator of a run into one file, on a
+// background thread.
+//
+// Each generator's output is first written (uncompressed) to a TMemFile by
+// the selector, with one top level directory per histogram set ("nominal"
+// and each variation), then handed over to the writer thread, which copies
+// it into the output file as <set>/<gen>/..., suffixing the name of every
+// object with "_<gen>" (the layout of plot_util.DMDRawLoader). Compressing
+// and writing one generator thus overlaps with processing the next.
+class OutputWriter {
+    private:
+        struct Job {
+            std::string generator;
+            std::unique_ptr<TMemFile> contents;
+        };
+
+        const std::string output_path;
+        const Int_t compression_settings;
+
+        std::mutex mutex;
+        std::condition_variable cond;
+        std::deque<Job> jobs;
+        bool stopping;
+        bool failed;
+        std::thread writer;
+
+        void run_writer(void);
+        bool copy_directory(TDirectory* src, TDirectory* dst, const std::string& suffix);
+
+    public:
+        OutputWriter(std::string output_path_, Int_t compression_settings_);
+        ~OutputWriter(void);
+
+        OutputWriter(const OutputWriter&) = delete;
+        OutputWriter& operator=(const OutputWriter&) = delete;
+
+        // queue the output of generator (empty: written without a generator
+        // directory or suffix), never blocks
+        void submit(const std::string& generator, std::unique_ptr<TMemFile> contents);
+
+        // write every queued output and close the file, returns false
+        // (after printing an error) if anything failed
+        bool finish(void);
+};
+
+#endif // #ifdef OutputWriter_h
@@ -0,0 +1,182 @@
+#define ParallelProcessor_cxx
+
+#include <TChain.h>
+#include <TChainElement.h>
+#include <TROOT.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "BlockReader.h"
+#include "ParallelProcessor.h"
+
+void
+report_progress(const std::atomic<Long64_t>& num_entries_done, Long64_t num_entries,
+        const std::atomic<bool>& failed)
+{
+    ProgressReporter progress(num_entries);
+
+    while (num_entries_done < num_entries && !failed) {
+        progress.update(num_entries_done);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    progress.finish(num_entries_done);
+}
+
+ParallelProcessor::ParallelProcessor(TChain* chain_, unsigned num_threads_) :
+    chain(chain_),
+    num_threads(num_threads_ > 0 ? num_threads_ : 1),
+    num_entries(0),
+    next_range(0),
+    num_entries_done(0),
+    failed(false)
+{
+    TObjArray* files = chain->GetListOfFiles();
+    for (Int_t i = 0; i < files->GetEntries(); i++) {
+        file_paths.push_back(files->At(i)->GetTitle());
+    }
+
+    find_cluster_ranges();
+}
+
+void
+ParallelProcessor::find_cluster_ranges(void)
+{
+    // GetEntries() forces the chain to compute the entry offset of every tree
+    num_entries = chain->GetEntries();
+    const Long64_t* tree_offsets = chain->GetTreeOffset();
+
+    for (Int_t itree = 0; itree < chain->GetNtrees(); itree++) {
+        const Long64_t tree_entries = tree_offsets[itree + 1] - tree_offsets[itree];
+        if (tree_entries == 0) continue;
+
+        chain->LoadTree(tree_offsets[itree]);
+        TTree* tree = chain->GetTree();
+
+        TTree::TClusterIterator clusters = tree->GetClusterIterator(0);
+        Long64_t cluster_start;
+
+        while ((cluster_start = clusters()) < tree_entries) {
+            EntryRange range;
+            range.first = tree_offsets[itree] + cluster_start;
+            range.last = tree_offsets[itree] + std::min(clusters.GetNextEntry(), tree_entries);
+            range.tree = itree;
+            entry_ranges.push_back(range);
+        }
+    }
+}
+
+void
+ParallelProcessor::run_worker(VVJJFlavorSelector* worker)
+{
+    // TChain is not thread-safe, so each worker reads through its own copy
+    TChain worker_chain(chain->GetName());
+    for (auto const& path : file_paths) {
+        if (worker_chain.Add(path.c_str(), 0) != 1) {
+            std::cout << "ERROR: failed to open input file: " << path << std::endl;
+            failed = true;
+            next_range = entry_ranges.size();
+            return;
+        }
+    }
+
+    // the workers only ever read the event columns
+    worker_chain.SetBranchStatus("*", kFALSE);
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        worker_chain.SetBranchStatus(EVENT_COLUMN_NAMES[col], kTRUE);
+    }
+
+    EventBlockBuffer buffer;
+    std::unique_ptr<BlockReader> reader;
+
+    Int_t current_tree = -1;
+    size_t irange;
+
+    while ((irange = next_range++) < entry_ranges.size()) {
+        const EntryRange& range = entry_ranges[irange];
+
+        // a range never crosses a tree boundary, so it can be read in
+        // blocks directly from the underlying TTree
+        const Long64_t local_first = worker_chain.LoadTree(range.first);
+
+        if (local_first < 0) {
+            std::cout << "ERROR: failed to load input file: " << file_paths[range.tree] << std::endl;
+            failed = true;
+            next_range = entry_ranges.size();
+            return;
+        }
+
+        if (worker_chain.GetTreeNumber() != current_tree) {
+            current_tree = worker_chain.GetTreeNumber();
+            reader.reset(new BlockReader(worker_chain.GetTree()));
+            worker->begin_tree(worker_chain.GetTree());
+        }
+
+        const Long64_t local_last = local_first + (range.last - range.first);
+
+        for (Long64_t entry = local_first; entry < local_last; entry += buffer.size) {
+            const RunClock::time_point read_start = RunStats::now();
+            if (reader->read(entry, local_last, buffer) == 0) {
+                std::cout << "ERROR: failed to read entries of input file: "
+                    << file_paths[range.tree] << std::endl;
+                failed = true;
+                next_range = entry_ranges.size();
+                return;
+            }
+            worker->run_stats.lap(PhaseIO, read_start);
+
+            worker->ProcessBatch(buffer.view());
+        }
+
+        num_entries_done += range.last - range.first;
+    }
+}
+
+bool
+ParallelProcessor::process(VVJJFlavorSelector* selector)
+{
+    ROOT::EnableThreadSafety();
+
+    selector->Begin(nullptr);
+    selector->SlaveBegin(nullptr);
+
+    std::vector< std::unique_ptr<VVJJFlavorSelector> > workers;
+    std::vector<std::thread> threads;
+
+    std::cout << "processing " << entry_ranges.size() << " clusters with "
+        << num_threads << " threads" << std::endl;
+
+    for (unsigned i = 0; i < num_threads; i++) {
+        workers.emplace_back(new VVJJFlavorSelector(selector->output_path, selector->config));
+        workers.back()->print_progress = kFALSE;
+        workers.back()->Begin(nullptr);
+        workers.back()->SlaveBegin(nullptr);
+    }
+
+    for (unsigned i = 0; i < num_threads; i++) {
+        threads.emplace_back(&ParallelProcessor::run_worker, this, workers[i].get());
+    }
+
+    report_progress(num_entries_done, num_entries, failed);
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    if (failed)
+        return false;
+
+    for (auto const& worker : workers) {
+        worker->SlaveTerminate();
+        selector->merge(*worker);
+    }
+
+    selector->SlaveTerminate();
+    selector->Terminate();
+
+    return true;
+}
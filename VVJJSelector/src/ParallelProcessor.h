@@ -0,0 +1,59 @@
+#ifndef ParallelProcessor_h
+#define ParallelProcessor_h
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <TChain.h>
+
+#include "VVJJFlavorSelector.h"
+
+// A contiguous range of TChain entries [first, last), aligned with the
+// cluster boundaries of the underlying TTree.
+struct EntryRange {
+    Long64_t first;
+    Long64_t last;
+    Int_t tree;
+};
+
+// Print periodic progress lines for a multi-threaded event loop, in the same
+// format as the sequential VVJJFlavorSelector, returning once
+// num_entries_done reaches num_entries or a worker has failed.
+void report_progress(const std::atomic<Long64_t>& num_entries_done, Long64_t num_entries,
+        const std::atomic<bool>& failed);
+
+// Runs a VVJJFlavorSelector over a TChain using a pool of threads.
+//
+// The chain is split into cluster-aligned entry ranges, which the worker
+// threads pull from a shared queue. Each worker opens its own copy of the
+// chain, reads its ranges in blocks with a BlockReader, and owns a private
+// VVJJFlavorSelector (and thus its own TH1Topo histograms and sum_weights_*
+// counters). Once all ranges are processed the workers are merged into the
+// caller's selector, which then writes the output in Terminate() as usual.
+class ParallelProcessor {
+    private:
+        TChain* chain;
+        const unsigned num_threads;
+
+        std::vector<std::string> file_paths;
+        std::vector<EntryRange> entry_ranges;
+        Long64_t num_entries;
+
+        std::atomic<size_t> next_range;
+        std::atomic<Long64_t> num_entries_done;
+
+        // set by a worker that could not read its range, which stops the others
+        std::atomic<bool> failed;
+
+        void find_cluster_ranges(void);
+        void run_worker(VVJJFlavorSelector* worker);
+
+    public:
+        ParallelProcessor(TChain* chain_, unsigned num_threads_);
+
+        // returns false (without writing the output) if a range can't be read
+        bool process(VVJJFlavorSelector* selector);
+};
+
+#endif // #ifdef ParallelProcessor_h
@@ -0,0 +1,186 @@
+#define ReadAheadProcessor_cxx
+
+#include <TROOT.h>
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+#include "BlockReader.h"
+#include "ReadAheadProcessor.h"
+#include "RunStats.h"
+
+ReadAheadProcessor::ReadAheadProcessor(TChain* chain_, size_t memory_budget_bytes, Long64_t first_entry_) :
+    chain(chain_),
+    cache_size(memory_budget_bytes / 2),
+    first_entry(first_entry_),
+    failed(false)
+{
+    const size_t buffer_bytes = NUM_EVENT_COLUMNS * DEFAULT_EVENT_BLOCK_SIZE * sizeof(Double_t);
+    const size_t num_buffers = std::max<size_t>(2, (memory_budget_bytes / 2) / buffer_bytes);
+
+    for (size_t i = 0; i < num_buffers; i++) {
+        buffers.emplace_back(new EventBlockBuffer());
+        free_buffers.push_back(buffers.back().get());
+    }
+}
+
+void
+ReadAheadProcessor::read_chain(void)
+{
+    chain->SetCacheSize(cache_size);
+
+    std::unique_ptr<BlockReader> reader;
+    Int_t current_tree = -1;
+
+    const Long64_t num_entries = chain->GetEntries();
+    Long64_t entry = first_entry;
+    bool read_failed = false;
+
+    while (entry < num_entries) {
+        const Long64_t local_entry = chain->LoadTree(entry);
+        if (local_entry < 0) {
+            std::cout << "ERROR: failed to load entry " << entry << " of the input chain" << std::endl;
+            read_failed = true;
+            break;
+        }
+
+        TTree* tree = chain->GetTree();
+
+        if (chain->GetTreeNumber() != current_tree) {
+            current_tree = chain->GetTreeNumber();
+            reader.reset(new BlockReader(tree));
+
+            // prefetch the event columns only, without a learning phase
+            for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+                tree->AddBranchToCache(EVENT_COLUMN_NAMES[col], kTRUE);
+            }
+            tree->StopCacheLearningPhase();
+
+            TreeInfo info;
+            info.path = tree->GetCurrentFile() ? tree->GetCurrentFile()->GetName() : tree->GetName();
+            info.entries = tree->GetEntries();
+            BlockReader::column_bytes(tree, info.compressed_bytes.data(), info.uncompressed_bytes.data());
+
+            std::lock_guard<std::mutex> lock(mutex);
+            trees.push_back(info);
+        }
+
+        EventBlockBuffer* buffer;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            free_cond.wait(lock, [this] { return !free_buffers.empty(); });
+
+            buffer = free_buffers.back();
+            free_buffers.pop_back();
+        }
+
+        const size_t num_read = reader->read(local_entry, tree->GetEntries(), *buffer);
+
+        if (num_read == 0) {
+            std::cout << "ERROR: failed to read entries of input file: " << trees.back().path << std::endl;
+            read_failed = true;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            free_buffers.push_back(buffer);
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ReadBlock block;
+            block.buffer = buffer;
+            block.tree = trees.size() - 1;
+            ready_blocks.push_back(block);
+        }
+        ready_cond.notify_one();
+
+        entry += num_read;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        failed = read_failed;
+
+        ReadBlock end;
+        end.buffer = nullptr;
+        end.tree = 0;
+        ready_blocks.push_back(end);
+    }
+    ready_cond.notify_one();
+}
+
+bool
+ReadAheadProcessor::process(VVJJFlavorSelector* selector)
+{
+    ROOT::EnableThreadSafety();
+
+    selector->Begin(nullptr);
+    selector->SlaveBegin(nullptr);
+
+    // the chain belongs to the I/O thread from now on
+    const Long64_t num_entries = chain->GetEntries();
+
+    std::cout << "processing with " << buffers.size() << " read-ahead blocks and a "
+        << cache_size / (1024 * 1024) << " MB TTreeCache" << std::endl;
+
+    std::thread reader_thread(&ReadAheadProcessor::read_chain, this);
+
+    std::unique_ptr<ProgressReporter> progress;
+    if (selector->print_progress)
+        progress.reset(new ProgressReporter(num_entries));
+
+    size_t current_tree = static_cast<size_t>(-1);
+
+    while (true) {
+        ReadBlock block;
+
+        // any time spent waiting here is I/O the read-ahead could not hide
+        const RunClock::time_point wait_start = RunStats::now();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready_cond.wait(lock, [this] { return !ready_blocks.empty(); });
+
+            block = ready_blocks.front();
+            ready_blocks.pop_front();
+
+            if (block.buffer != nullptr && block.tree != current_tree) {
+                current_tree = block.tree;
+                const TreeInfo& info = trees[current_tree];
+                selector->run_stats.begin_file(info.path, info.entries, selector->num_entries_processed,
+                        info.compressed_bytes.data(), info.uncompressed_bytes.data());
+            }
+        }
+        selector->run_stats.lap(PhaseIO, wait_start);
+
+        if (block.buffer == nullptr) break;
+
+        selector->ProcessBatch(block.buffer->view());
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            free_buffers.push_back(block.buffer);
+        }
+        free_cond.notify_one();
+
+        if (progress)
+            progress->update(selector->num_entries_processed);
+
+        // blocks are processed in chain order, up to the entries processed
+        if (selector->checkpointer && selector->checkpointer->due())
+            selector->checkpointer->snapshot(*selector, selector->num_entries_processed);
+    }
+
+    reader_thread.join();
+
+    if (failed)
+        return false;
+
+    if (progress)
+        progress->finish(selector->num_entries_processed);
+
+    selector->SlaveTerminate();
+    selector->Terminate();
+
+    return true;
+}
@@ -0,0 +1,65 @@
+#ifndef ReadAheadProcessor_h
+#define ReadAheadProcessor_h
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <TChain.h>
+
+#include "EventBlock.h"
+#include "VVJJFlavorSelector.h"
+
+// Runs a VVJJFlavorSelector over a TChain with a background read-ahead stage.
+//
+// An I/O thread walks the chain, reading and decompressing the event columns
+// into a bounded pool of EventBlockBuffers with a BlockReader, while the
+// calling thread runs ProcessBatch() on the blocks that are ready. The
+// memory budget is split evenly between the TTreeCache of the chain (which
+// prefetches whole clusters of the event columns only) and the block pool,
+// so reads of the next clusters overlap with the processing of this one.
+class ReadAheadProcessor {
+    private:
+        struct TreeInfo {
+            std::string path;
+            Long64_t entries;
+            std::array<Long64_t, NUM_EVENT_COLUMNS> compressed_bytes;
+            std::array<Long64_t, NUM_EVENT_COLUMNS> uncompressed_bytes;
+        };
+
+        struct ReadBlock {
+            EventBlockBuffer* buffer;  // nullptr marks the end of the chain
+            size_t tree;
+        };
+
+        TChain* chain;
+        Long64_t cache_size;
+        Long64_t first_entry;
+
+        std::vector< std::unique_ptr<EventBlockBuffer> > buffers;
+
+        std::mutex mutex;
+        std::condition_variable free_cond;
+        std::condition_variable ready_cond;
+        std::vector<EventBlockBuffer*> free_buffers;
+        std::deque<ReadBlock> ready_blocks;
+        std::vector<TreeInfo> trees;
+
+        // set by the I/O thread if it stopped before the end of the chain
+        bool failed;
+
+        void read_chain(void);
+
+    public:
+        // first_entry_ > 0 resumes a checkpointed loop
+        ReadAheadProcessor(TChain* chain_, size_t memory_budget_bytes, Long64_t first_entry_ = 0);
+
+        // returns false (without writing the output) if the chain can't be read
+        bool process(VVJJFlavorSelector* selector);
+};
+
+#endif // #ifdef ReadAheadProcessor_h
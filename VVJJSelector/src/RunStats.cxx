@@ -0,0 +1,257 @@
+#define RunStats_cxx
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "RunStats.h"
+
+static const char* const RUN_PHASE_NAMES[NUM_RUN_PHASES] = {
+    "io",
+    "baseline_selection",
+    "tag_evaluation",
+    "histogram_fill",
+    "terminate_write"
+};
+
+static std::string
+json_string(const std::string& str)
+{
+    std::stringstream ss;
+    ss << '"';
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            ss << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            ss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+        } else {
+            ss << c;
+        }
+    }
+    ss << '"';
+    return ss.str();
+}
+
+ProgressReporter::ProgressReporter(Long64_t num_entries_, double interval_seconds_) :
+    num_entries(num_entries_),
+    interval_seconds(interval_seconds_),
+    start_time(RunClock::now()),
+    last_print_time(start_time)
+{ }
+
+void
+ProgressReporter::print(Long64_t num_done, RunClock::time_point now) const
+{
+    const double elapsed = std::chrono::duration<double>(now - start_time).count();
+    const double percent = num_entries > 0 ? 100.0 * num_done / num_entries : 100.0;
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1)
+        << "[" << std::setw(7) << elapsed << " s] "
+        << num_done << " / " << num_entries << " events (" << percent << "%), "
+        << std::setprecision(0) << (elapsed > 0 ? num_done / elapsed : 0.) << " events/s";
+
+    std::cout << ss.str() << std::endl;
+}
+
+void
+ProgressReporter::update(Long64_t num_done)
+{
+    const RunClock::time_point now = RunClock::now();
+
+    if (std::chrono::duration<double>(now - last_print_time).count() >= interval_seconds) {
+        print(num_done, now);
+        last_print_time = now;
+    }
+}
+
+void
+ProgressReporter::finish(Long64_t num_done)
+{
+    print(num_done, RunClock::now());
+    std::cout << "DONE." << std::endl;
+}
+
+RunStats::RunStats(void) :
+    wall_seconds(0),
+    in_file(kFALSE),
+    file_first_entry(0),
+    file_num_entries(0),
+    num_entries_processed(0)
+{
+    phase_seconds.fill(0);
+    branch_bytes.fill(BranchBytes{0, 0});
+    file_branch_bytes.fill(BranchBytes{0, 0});
+}
+
+void
+RunStats::start(void)
+{
+    start_time = now();
+}
+
+void
+RunStats::stop(Long64_t num_entries_processed_)
+{
+    num_entries_processed = num_entries_processed_;
+    wall_seconds = std::chrono::duration<double>(now() - start_time).count();
+}
+
+void
+RunStats::begin_file(const std::string& path, Long64_t num_entries, Long64_t num_entries_done,
+        const Long64_t* compressed_bytes, const Long64_t* uncompressed_bytes)
+{
+    end_file(num_entries_done);
+
+    FileStats file;
+    file.path = path;
+    file.entries = 0;
+    file.seconds = 0;
+    files.push_back(file);
+
+    in_file = kTRUE;
+    file_start_time = now();
+    file_first_entry = num_entries_done;
+    file_num_entries = num_entries;
+
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        file_branch_bytes[col].compressed = compressed_bytes[col];
+        file_branch_bytes[col].uncompressed = uncompressed_bytes[col];
+    }
+}
+
+void
+RunStats::end_file(Long64_t num_entries_done)
+{
+    if (!in_file) return;
+    in_file = kFALSE;
+
+    const Long64_t entries = num_entries_done - file_first_entry;
+
+    FileStats& file = files.back();
+    file.entries += entries;
+    file.seconds += std::chrono::duration<double>(now() - file_start_time).count();
+
+    // the selector reads every entry of its columns, possibly in several
+    // chunks (e.g. the cluster ranges of a ParallelProcessor worker)
+    const Double_t fraction = file_num_entries > 0 ? (Double_t) entries / file_num_entries : 0.;
+
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        branch_bytes[col].compressed += fraction * file_branch_bytes[col].compressed;
+        branch_bytes[col].uncompressed += fraction * file_branch_bytes[col].uncompressed;
+    }
+}
+
+void
+RunStats::merge(const RunStats& other)
+{
+    for (int phase = 0; phase < NUM_RUN_PHASES; phase++) {
+        phase_seconds[phase] += other.phase_seconds[phase];
+    }
+
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        branch_bytes[col].compressed += other.branch_bytes[col].compressed;
+        branch_bytes[col].uncompressed += other.branch_bytes[col].uncompressed;
+    }
+
+    for (auto const& other_file : other.files) {
+        bool found = false;
+
+        for (auto& file : files) {
+            if (file.path != other_file.path) continue;
+
+            file.entries += other_file.entries;
+            file.seconds += other_file.seconds;
+            found = true;
+            break;
+        }
+
+        if (!found)
+            files.push_back(other_file);
+    }
+}
+
+Double_t
+RunStats::total_bytes(bool compressed) const
+{
+    Double_t total = 0;
+
+    for (auto const& bytes : branch_bytes) {
+        total += compressed ? bytes.compressed : bytes.uncompressed;
+    }
+
+    return total;
+}
+
+void
+RunStats::print_summary(void) const
+{
+    const double mb = 1024. * 1024.;
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+
+    ss << "PROCESSED " << num_entries_processed << " EVENTS IN " << wall_seconds << " s ("
+        << std::setprecision(0) << (wall_seconds > 0 ? num_entries_processed / wall_seconds : 0.)
+        << " events/s, " << std::setprecision(1)
+        << (wall_seconds > 0 ? total_bytes(false) / mb / wall_seconds : 0.) << " MB/s decompressed)" << std::endl;
+
+    ss << std::setprecision(3);
+    for (int phase = 0; phase < NUM_RUN_PHASES; phase++) {
+        ss << "\t" << std::left << std::setw(20) << RUN_PHASE_NAMES[phase] << std::right
+            << phase_seconds[phase] << " s" << std::endl;
+    }
+
+    std::cout << ss.str();
+}
+
+bool
+RunStats::write_json(const std::string& path) const
+{
+    std::ofstream out(path.c_str());
+    if (!out.is_open()) {
+        std::cout << "WARNING: failed to write run report: " << path << std::endl;
+        return false;
+    }
+
+    const double mb = 1024. * 1024.;
+
+    out << std::setprecision(10);
+    out << "{" << std::endl;
+    out << "  \"events_processed\": " << num_entries_processed << "," << std::endl;
+    out << "  \"wall_seconds\": " << wall_seconds << "," << std::endl;
+    out << "  \"events_per_second\": " << (wall_seconds > 0 ? num_entries_processed / wall_seconds : 0.) << "," << std::endl;
+    out << "  \"bytes_read_compressed\": " << total_bytes(true) << "," << std::endl;
+    out << "  \"bytes_read_decompressed\": " << total_bytes(false) << "," << std::endl;
+    out << "  \"decompressed_mb_per_second\": "
+        << (wall_seconds > 0 ? total_bytes(false) / mb / wall_seconds : 0.) << "," << std::endl;
+
+    out << "  \"phase_seconds\": {" << std::endl;
+    for (int phase = 0; phase < NUM_RUN_PHASES; phase++) {
+        out << "    " << json_string(RUN_PHASE_NAMES[phase]) << ": " << phase_seconds[phase]
+            << (phase + 1 < NUM_RUN_PHASES ? "," : "") << std::endl;
+    }
+    out << "  }," << std::endl;
+
+    out << "  \"branches\": [" << std::endl;
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        out << "    {\"name\": " << json_string(EVENT_COLUMN_NAMES[col])
+            << ", \"bytes_compressed\": " << branch_bytes[col].compressed
+            << ", \"bytes_decompressed\": " << branch_bytes[col].uncompressed << "}"
+            << (col + 1 < NUM_EVENT_COLUMNS ? "," : "") << std::endl;
+    }
+    out << "  ]," << std::endl;
+
+    out << "  \"files\": [" << std::endl;
+    for (size_t i = 0; i < files.size(); i++) {
+        out << "    {\"path\": " << json_string(files[i].path)
+            << ", \"entries\": " << files[i].entries
+            << ", \"seconds\": " << files[i].seconds << "}"
+            << (i + 1 < files.size() ? "," : "") << std::endl;
+    }
+    out << "  ]" << std::endl;
+    out << "}" << std::endl;
+
+    return !out.fail();
+}
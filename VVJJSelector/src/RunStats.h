@@ -0,0 +1,111 @@
+#ifndef RunStats_h
+#define RunStats_h
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <Rtypes.h>
+
+#include "EventBlock.h"
+
+enum RunPhase {
+    PhaseIO,
+    PhaseSelection,
+    PhaseTagging,
+    PhaseFill,
+    PhaseWrite,
+    NUM_RUN_PHASES
+};
+
+typedef std::chrono::steady_clock RunClock;
+
+// Prints a progress line (entries done, percent and rate) at most once per
+// interval. update() is cheap enough to be called every few thousand events.
+class ProgressReporter {
+    private:
+        const Long64_t num_entries;
+        const double interval_seconds;
+
+        RunClock::time_point start_time;
+        RunClock::time_point last_print_time;
+
+        void print(Long64_t num_done, RunClock::time_point now) const;
+
+    public:
+        explicit ProgressReporter(Long64_t num_entries_, double interval_seconds_ = 10.);
+
+        void update(Long64_t num_done);
+        void finish(Long64_t num_done);
+};
+
+// Throughput and timing counters of a selector, reported at the end of the
+// run and written as JSON next to the output file.
+//
+// Phase times are summed over every selector merged into this one, so with
+// several threads they are thread-seconds rather than wall-clock seconds.
+// Bytes read per branch are taken from the compressed/uncompressed sizes of
+// the branches of each input, in proportion to the entries processed.
+class RunStats {
+    private:
+        struct FileStats {
+            std::string path;
+            Long64_t entries;
+            double seconds;
+        };
+
+        struct BranchBytes {
+            Double_t compressed;
+            Double_t uncompressed;
+        };
+
+        RunClock::time_point start_time;
+        double wall_seconds;
+
+        std::array<double, NUM_RUN_PHASES> phase_seconds;
+        std::array<BranchBytes, NUM_EVENT_COLUMNS> branch_bytes;
+
+        std::vector<FileStats> files;
+
+        // the input currently being processed
+        Bool_t in_file;
+        RunClock::time_point file_start_time;
+        Long64_t file_first_entry;
+        Long64_t file_num_entries;
+        std::array<BranchBytes, NUM_EVENT_COLUMNS> file_branch_bytes;
+
+        Long64_t num_entries_processed;
+
+        Double_t total_bytes(bool compressed) const;
+
+    public:
+        RunStats(void);
+
+        static RunClock::time_point now(void) { return RunClock::now(); }
+
+        // add the time since start to phase, returns the current time so that
+        // consecutive phases can be chained
+        RunClock::time_point lap(RunPhase phase, RunClock::time_point start) {
+            const RunClock::time_point t = now();
+            phase_seconds[phase] += std::chrono::duration<double>(t - start).count();
+            return t;
+        }
+
+        void start(void);
+        void stop(Long64_t num_entries_processed_);
+
+        // Mark the start of an input with num_entries entries, with the
+        // compressed and uncompressed sizes of each of its event columns.
+        // num_entries_done is the number of entries processed so far.
+        void begin_file(const std::string& path, Long64_t num_entries, Long64_t num_entries_done,
+                const Long64_t* compressed_bytes, const Long64_t* uncompressed_bytes);
+        void end_file(Long64_t num_entries_done);
+
+        void merge(const RunStats& other);
+
+        void print_summary(void) const;
+        bool write_json(const std::string& path) const;
+};
+
+#endif // #ifdef RunStats_h
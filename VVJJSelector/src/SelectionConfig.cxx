@@ -0,0 +1,410 @@
+#define SelectionConfig_cxx
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "SelectionConfig.h"
+
+const char* const SelectionConfig::DEFAULT_SELECTION_CONFIG =
+    "# baseline event selection, momenta and masses are in MeV unless given in GeV\n"
+    "cut first_jet_pt > 450 GeV\n"
+    "cut first_jet_m > 50 GeV\n"
+    "cut second_jet_m > 50 GeV\n"
+    "cut |first_jet_eta| < 2\n"
+    "cut |second_jet_eta| < 2\n"
+    "cut dijet_mass_massordered > 1000 GeV\n"
+    "cut |dyjj| < 1.2\n"
+    "cut |ptasym| < 0.15\n"
+    "\n"
+    "# jets with fewer ungroomed tracks than this pass the ntrk tag component\n"
+    "ntrk_max 30\n"
+    "\n"
+    "jet_tag partial_ntrk ntrk\n"
+    "\n"
+    "jet_tag W_partial_mass Wmass\n"
+    "jet_tag W_partial_D2 WD2\n"
+    "jet_tag W_partial_massD2 Wmass+WD2\n"
+    "jet_tag W_partial_massNtrk Wmass+ntrk\n"
+    "jet_tag W_partial_ntrkD2 WD2+ntrk\n"
+    "jet_tag W_full Wmass+WD2+ntrk\n"
+    "\n"
+    "jet_tag Z_partial_mass Zmass\n"
+    "jet_tag Z_partial_D2 ZD2\n"
+    "jet_tag Z_partial_massD2 Zmass+ZD2\n"
+    "jet_tag Z_partial_massNtrk Zmass+ntrk\n"
+    "jet_tag Z_partial_ntrkD2 ZD2+ntrk\n"
+    "jet_tag Z_full Zmass+ZD2+ntrk\n"
+    "\n"
+    "event_tag partial_ntrk ntrk ntrk\n"
+    "\n"
+    "event_tag WW_partial_mass Wmass Wmass\n"
+    "event_tag WW_partial_D2 WD2 WD2\n"
+    "event_tag WW_partial_massD2 Wmass+WD2 Wmass+WD2\n"
+    "event_tag WW_partial_massNtrk Wmass+ntrk Wmass+ntrk\n"
+    "event_tag WW_partial_ntrkD2 WD2+ntrk WD2+ntrk\n"
+    "event_tag WW_full Wmass+WD2+ntrk Wmass+WD2+ntrk\n"
+    "\n"
+    "# NOTE: WZ is defined as a Z-tagged leading jet and a W-tagged subleading jet\n"
+    "event_tag WZ_partial_mass Zmass Wmass\n"
+    "event_tag WZ_partial_D2 ZD2 WD2\n"
+    "event_tag WZ_partial_massD2 Zmass+ZD2 Wmass+WD2\n"
+    "event_tag WZ_partial_massNtrk Zmass+ntrk Wmass+ntrk\n"
+    "event_tag WZ_partial_ntrkD2 ZD2+ntrk WD2+ntrk\n"
+    "event_tag WZ_full Zmass+ZD2+ntrk Wmass+WD2+ntrk\n"
+    "\n"
+    "event_tag ZZ_partial_mass Zmass Zmass\n"
+    "event_tag ZZ_partial_D2 ZD2 ZD2\n"
+    "event_tag ZZ_partial_massD2 Zmass+ZD2 Zmass+ZD2\n"
+    "event_tag ZZ_partial_massNtrk Zmass+ntrk Zmass+ntrk\n"
+    "event_tag ZZ_partial_ntrkD2 ZD2+ntrk ZD2+ntrk\n"
+    "event_tag ZZ_full Zmass+ZD2+ntrk Zmass+ZD2+ntrk\n";
+
+static const char* const CUT_OP_NAMES[] = { ">", ">=", "<", "<=" };
+
+static const struct {
+    const char* name;
+    JetTagComponent component;
+} JET_TAG_COMPONENT_NAMES[] = {
+    { "ntrk"  , PassNtrk  },
+    { "Wmass" , PassWMass },
+    { "WD2"   , PassWD2   },
+    { "Zmass" , PassZMass },
+    { "ZD2"   , PassZD2   }
+};
+
+static bool
+parse_number(const std::string& str, Double_t& value)
+{
+    char* end = nullptr;
+    value = std::strtod(str.c_str(), &end);
+    return !str.empty() && *end == '\0';
+}
+
+// the shortest representation of value that parses back to exactly value
+static std::string
+format_number(Double_t value)
+{
+    for (int precision = 6; ; precision++) {
+        std::ostringstream ss;
+        ss.precision(precision);
+        ss << value;
+
+        if (precision == 17 || std::strtod(ss.str().c_str(), nullptr) == value)
+            return ss.str();
+    }
+}
+
+// parse e.g. "Wmass+WD2+ntrk" into a JetTagComponent mask
+static bool
+parse_components(const std::string& str, UInt_t& components)
+{
+    components = 0;
+
+    std::istringstream ss(str);
+    std::string name;
+
+    while (std::getline(ss, name, '+')) {
+        bool found = false;
+
+        for (auto const& x : JET_TAG_COMPONENT_NAMES) {
+            if (name == x.name) {
+                components |= x.component;
+                found = true;
+            }
+        }
+
+        if (!found) return false;
+    }
+
+    return components != 0;
+}
+
+static std::string
+format_components(UInt_t components)
+{
+    std::string str;
+
+    for (auto const& x : JET_TAG_COMPONENT_NAMES) {
+        if (components & x.component) {
+            if (!str.empty()) str += "+";
+            str += x.name;
+        }
+    }
+
+    return str;
+}
+
+static ULong64_t
+fnv1a_hash(const std::string& str, ULong64_t hash)
+{
+    for (char c : str) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+SelectionConfig::SelectionConfig(void) :
+    ntrk_max(NAN)
+{ }
+
+const SelectionConfig&
+SelectionConfig::defaults(void)
+{
+    static const SelectionConfig config = [] () {
+        SelectionConfig c;
+        if (!c.parse(DEFAULT_SELECTION_CONFIG, "<default>"))
+            std::abort();
+        return c;
+    }();
+
+    return config;
+}
+
+bool
+SelectionConfig::parse_line(const std::string& line, const std::string& where)
+{
+    std::istringstream ss(line.substr(0, line.find('#')));
+
+    std::vector<std::string> words;
+    std::string word;
+    while (ss >> word) words.push_back(word);
+
+    if (words.empty())
+        return true;
+
+    const std::string& keyword = words[0];
+
+    if (keyword == "cut" && (words.size() == 4 || words.size() == 5)) {
+        Cut cut;
+        std::string column_name = words[1];
+
+        cut.absolute = column_name.size() > 2 && column_name.front() == '|' && column_name.back() == '|';
+        if (cut.absolute)
+            column_name = column_name.substr(1, column_name.size() - 2);
+
+        const int column = find_event_column(column_name.c_str());
+        if (column < 0) {
+            std::cout << "ERROR: " << where << ": unknown cut variable: " << column_name << std::endl;
+            return false;
+        }
+        cut.column = static_cast<EventColumn>(column);
+
+        bool found_op = false;
+        for (UInt_t op = 0; op < 4; op++) {
+            if (words[2] == CUT_OP_NAMES[op]) {
+                cut.op = static_cast<CutOp>(op);
+                found_op = true;
+            }
+        }
+
+        if (!found_op) {
+            std::cout << "ERROR: " << where << ": unknown cut operator: " << words[2] << std::endl;
+            return false;
+        }
+
+        if (!parse_number(words[3], cut.threshold)) {
+            std::cout << "ERROR: " << where << ": invalid cut value: " << words[3] << std::endl;
+            return false;
+        }
+
+        cut.divisor = 1.;
+        if (words.size() == 5 && words[4] == "GeV") {
+            cut.divisor = 1000.;
+        } else if (words.size() == 5 && words[4] != "MeV") {
+            std::cout << "ERROR: " << where << ": unknown unit: " << words[4] << std::endl;
+            return false;
+        }
+
+        if (cuts.size() == CutProgram::MAX_CUTS) {
+            std::cout << "ERROR: " << where << ": too many cuts, at most "
+                << CutProgram::MAX_CUTS << " are supported" << std::endl;
+            return false;
+        }
+
+        cuts.push_back(cut);
+    } else if (keyword == "ntrk_max" && words.size() == 2) {
+        if (!parse_number(words[1], ntrk_max)) {
+            std::cout << "ERROR: " << where << ": invalid ntrk_max: " << words[1] << std::endl;
+            return false;
+        }
+    } else if (keyword == "jet_tag" && words.size() == 3) {
+        UInt_t components;
+        if (!parse_components(words[2], components)) {
+            std::cout << "ERROR: " << where << ": invalid tag components: " << words[2] << std::endl;
+            return false;
+        }
+
+        if (!tags.add_jet_tag(words[1], components)) {
+            std::cout << "ERROR: " << where << ": duplicate jet tag or more than "
+                << TagRegistry::MAX_TAGS << " jet tags: " << words[1] << std::endl;
+            return false;
+        }
+    } else if (keyword == "event_tag" && words.size() == 4) {
+        UInt_t first_components, second_components;
+        if (!parse_components(words[2], first_components) || !parse_components(words[3], second_components)) {
+            std::cout << "ERROR: " << where << ": invalid tag components: " << words[2] << " " << words[3] << std::endl;
+            return false;
+        }
+
+        if (!tags.add_event_tag(words[1], first_components, second_components)) {
+            std::cout << "ERROR: " << where << ": duplicate event tag or more than "
+                << TagRegistry::MAX_TAGS << " event tags: " << words[1] << std::endl;
+            return false;
+        }
+    } else if (keyword == "variation" && words.size() >= 5 && (words.size() - 2) % 3 == 0) {
+        Variation variation;
+        variation.name = words[1];
+
+        bool valid_name = variation.name != "nominal" && variation.name.find('/') == std::string::npos;
+        for (auto const& v : variations) {
+            valid_name = valid_name && v.name != variation.name;
+        }
+
+        if (!valid_name) {
+            std::cout << "ERROR: " << where << ": invalid or duplicate variation name: " << variation.name << std::endl;
+            return false;
+        }
+
+        for (size_t i = 2; i < words.size(); i += 3) {
+            VariationOp op;
+            const int column = find_event_column(words[i + 1].c_str());
+
+            if ((words[i] != "scale" && words[i] != "set") || column < 0 || !parse_number(words[i + 2], op.value)) {
+                std::cout << "ERROR: " << where << ": invalid variation step: "
+                    << words[i] << " " << words[i + 1] << " " << words[i + 2] << std::endl;
+                return false;
+            }
+
+            op.column = static_cast<EventColumn>(column);
+            op.scale = words[i] == "scale";
+            variation.ops.push_back(op);
+        }
+
+        variations.push_back(variation);
+    } else {
+        std::cout << "ERROR: " << where << ": invalid line: " << line << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool
+SelectionConfig::parse(const std::string& text, const std::string& source)
+{
+    *this = SelectionConfig();
+
+    std::istringstream ss(text);
+    std::string line;
+
+    for (int line_number = 1; std::getline(ss, line); line_number++) {
+        if (!parse_line(line, source + ":" + std::to_string(line_number)))
+            return false;
+    }
+
+    if (std::isnan(ntrk_max)) {
+        std::cout << "ERROR: " << source << ": missing ntrk_max" << std::endl;
+        return false;
+    }
+
+    program = CutProgram(cuts);
+    return true;
+}
+
+bool
+SelectionConfig::load(const std::string& path)
+{
+    std::ifstream file(path.c_str());
+    if (!file.is_open()) {
+        std::cout << "ERROR: failed to open selection config: " << path << std::endl;
+        return false;
+    }
+
+    std::stringstream text;
+    text << file.rdbuf();
+
+    return parse(text.str(), path);
+}
+
+std::string
+SelectionConfig::format_cut(const Cut& cut)
+{
+    const std::string column_name = EVENT_COLUMN_NAMES[cut.column];
+
+    return (cut.absolute ? "|" + column_name + "|" : column_name)
+        + " " + CUT_OP_NAMES[static_cast<UInt_t>(cut.op)]
+        + " " + format_number(cut.threshold)
+        + (cut.divisor == 1000. ? " GeV" : "");
+}
+
+std::string
+SelectionConfig::to_string(void) const
+{
+    std::ostringstream ss;
+
+    for (auto const& cut : cuts) {
+        ss << "cut " << format_cut(cut) << std::endl;
+    }
+
+    ss << "ntrk_max " << format_number(ntrk_max) << std::endl;
+
+    for (UInt_t id = 0; id < tags.num_jet_tags(); id++) {
+        ss << "jet_tag " << tags.jet_tag_name(id) << " "
+            << format_components(tags.jet_tag(id).required_components) << std::endl;
+    }
+
+    for (UInt_t id = 0; id < tags.num_event_tags(); id++) {
+        ss << "event_tag " << tags.event_tag_name(id) << " "
+            << format_components(tags.event_tag(id).first_jet_required_components) << " "
+            << format_components(tags.event_tag(id).second_jet_required_components) << std::endl;
+    }
+
+    for (auto const& variation : variations) {
+        ss << "variation " << variation.name;
+        for (auto const& op : variation.ops) {
+            ss << " " << (op.scale ? "scale " : "set ") << EVENT_COLUMN_NAMES[op.column]
+                << " " << format_number(op.value);
+        }
+        ss << std::endl;
+    }
+
+    return ss.str();
+}
+
+ULong64_t
+SelectionConfig::selection_hash(void) const
+{
+    ULong64_t hash = 0xcbf29ce484222325ULL;
+
+    // only the cuts, so that changing the tags doesn't invalidate cached
+    // results of the selection
+    std::istringstream ss(to_string());
+    std::string line;
+    while (std::getline(ss, line)) {
+        if (line.compare(0, 4, "cut ") == 0)
+            hash = fnv1a_hash(line + ";", hash);
+    }
+
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        hash = fnv1a_hash(EVENT_COLUMN_NAMES[col], hash);
+    }
+
+    return hash;
+}
+
+ULong64_t
+SelectionConfig::config_hash(void) const
+{
+    ULong64_t hash = fnv1a_hash(to_string(), 0xcbf29ce484222325ULL);
+
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        hash = fnv1a_hash(EVENT_COLUMN_NAMES[col], hash);
+    }
+
+    return hash;
+}
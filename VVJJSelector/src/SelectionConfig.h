@@ -0,0 +1,94 @@
+#ifndef SelectionConfig_h
+#define SelectionConfig_h
+
+#include <string>
+#include <vector>
+
+#include <Rtypes.h>
+
+#include "BaselineSelection.h"
+#include "TagRegistry.h"
+
+// One step of a systematic variation: scale a column by value, or set it to
+// value.
+struct VariationOp {
+    EventColumn column;
+    bool scale;
+    Double_t value;
+};
+
+// A systematic variation of the event columns, applied before the baseline
+// selection. Its histograms are filled alongside the nominal ones.
+struct Variation {
+    std::string name;
+    std::vector<VariationOp> ops;
+};
+
+// The baseline selection cuts, the ntrk tagging threshold, the jet/event tag
+// definitions and the systematic variations of a run, loaded at startup from
+// a plain text config:
+//
+//     # comment
+//     cut first_jet_pt > 450 GeV       # <column> <op> <value> [GeV|MeV]
+//     cut |first_jet_eta| < 2.0        # |column| cuts on the absolute value
+//     ntrk_max 30                      # jets with ntrk < 30 pass "ntrk"
+//     jet_tag W_full Wmass+WD2+ntrk
+//     event_tag WZ_full Zmass+ZD2+ntrk Wmass+WD2+ntrk
+//     variation JES_up scale first_jet_pt 1.02 scale second_jet_pt 1.02
+//     variation no_pileup_weight set pileup_weight 1
+//
+// Cut columns are any of VVJJ_EVENT_COLUMNS, with ops >, >=, < and <=. Tag
+// components are ntrk, Wmass, WD2, Zmass and ZD2, joined with '+'; event
+// tags list the components of the leading jet, then the subleading jet.
+// Tags are filled in the order they are listed. Variations scale or set any
+// number of VVJJ_EVENT_COLUMNS; derived columns (e.g. the dijet mass) are
+// not recomputed, so list them too if they should follow.
+//
+// DEFAULT_SELECTION_CONFIG reproduces the selection and tags the selector
+// has always used.
+class SelectionConfig {
+    private:
+        std::vector<Cut> cuts;
+        CutProgram program;
+        Double_t ntrk_max;
+        TagRegistry tags;
+        std::vector<Variation> variations;
+
+        bool parse_line(const std::string& line, const std::string& where);
+
+    public:
+        SelectionConfig(void);
+
+        static const char* const DEFAULT_SELECTION_CONFIG;
+
+        // the config parsed from DEFAULT_SELECTION_CONFIG
+        static const SelectionConfig& defaults(void);
+
+        // Replace this config with the one in text (or in the file at path).
+        // source names it in error messages. Returns false on any error.
+        bool parse(const std::string& text, const std::string& source);
+        bool load(const std::string& path);
+
+        // the config in canonical form, which parses back to itself
+        std::string to_string(void) const;
+
+        // a cut as written in the config, e.g. "first_jet_pt > 450 GeV"
+        static std::string format_cut(const Cut& cut);
+
+        // Identifies the baseline selection (but not the tags) along with
+        // the list of EventBlock columns, e.g. to key cached results of the
+        // selection.
+        ULong64_t selection_hash(void) const;
+
+        // Identifies the whole config, i.e. everything that decides what
+        // the selector accumulates, e.g. to key partial results.
+        ULong64_t config_hash(void) const;
+
+        const std::vector<Cut>& get_cuts(void) const { return cuts; }
+        const CutProgram& get_program(void) const { return program; }
+        Double_t get_ntrk_max(void) const { return ntrk_max; }
+        const TagRegistry& get_tags(void) const { return tags; }
+        const std::vector<Variation>& get_variations(void) const { return variations; }
+};
+
+#endif // #ifdef SelectionConfig_h
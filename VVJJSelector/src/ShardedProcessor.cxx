@@ -0,0 +1,235 @@
+#define ShardedProcessor_cxx
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+
+#include "ShardedProcessor.h"
+
+bool
+partition_shards(const std::vector<std::string>& paths, unsigned num_shards, std::vector<Shard>& shards)
+{
+    std::vector<Long64_t> sizes, entries;
+    Long64_t total_size = 0, total_entries = 0;
+
+    // only the headers are read, the baskets are left to the workers
+    for (auto const& path : paths) {
+        std::unique_ptr<TFile> ntuple_file(TFile::Open(path.c_str(), "READ"));
+        TTree* tree = nullptr;
+        if (ntuple_file && !ntuple_file->IsZombie())
+            tree = dynamic_cast<TTree*>(ntuple_file->Get("Nominal"));
+
+        if (tree == nullptr) {
+            std::cout << "ERROR: failed to read Nominal tree from input file: " << path << std::endl;
+            return false;
+        }
+
+        sizes.push_back(ntuple_file->GetSize());
+        entries.push_back(tree->GetEntries());
+
+        total_size += sizes.back();
+        total_entries += entries.back();
+    }
+
+    std::vector<Double_t> costs(paths.size(), 0.);
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (total_size > 0) costs[i] += static_cast<Double_t>(sizes[i]) / total_size;
+        if (total_entries > 0) costs[i] += static_cast<Double_t>(entries[i]) / total_entries;
+    }
+
+    // longest processing time first: the costliest remaining file goes to
+    // the cheapest shard so far
+    std::vector<size_t> order(paths.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&costs] (size_t a, size_t b) { return costs[a] > costs[b]; });
+
+    shards.assign(std::max<size_t>(1, std::min<size_t>(num_shards, paths.size())), Shard {{}, 0.});
+
+    for (size_t i : order) {
+        auto cheapest = std::min_element(shards.begin(), shards.end(),
+                [] (const Shard& a, const Shard& b) { return a.cost < b.cost; });
+        cheapest->paths.push_back(paths[i]);
+        cheapest->cost += costs[i];
+    }
+
+    return true;
+}
+
+ShardedProcessor::ShardedProcessor(std::string program_, std::vector<std::string> worker_options_,
+        unsigned num_processes_) :
+    program(program_),
+    worker_options(worker_options_),
+    num_processes(num_processes_ > 0 ? num_processes_ : 1)
+{ }
+
+pid_t
+ShardedProcessor::spawn_worker(const std::string& shard_prefix) const
+{
+    // the worker writes its state in place of the output, and its checkpoints
+    // (if any) next to shard_prefix, so that a retried shard resumes
+    std::vector<std::string> args = {
+        program, shard_prefix + ".list", shard_prefix, "--worker-state", shard_prefix + ".state"
+    };
+    args.insert(args.end(), worker_options.begin(), worker_options.end());
+
+    std::vector<char*> argv;
+    for (auto& arg : args) {
+        argv.push_back(&arg[0]);
+    }
+    argv.push_back(nullptr);
+
+    const std::string log_path = shard_prefix + ".log";
+
+    // the state of an earlier attempt must not pass for this one's
+    std::remove((shard_prefix + ".state").c_str());
+
+    std::cout.flush();
+    const pid_t pid = fork();
+    if (pid != 0)
+        return pid;
+
+    // in the worker: only async-signal-safe calls until exec
+    const int log_fd = ::open(log_path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (log_fd >= 0) {
+        ::dup2(log_fd, STDOUT_FILENO);
+        ::dup2(log_fd, STDERR_FILENO);
+        ::close(log_fd);
+    }
+
+    ::execvp(argv[0], argv.data());
+    _exit(127);
+}
+
+bool
+ShardedProcessor::process(const std::string& gen, const std::vector<std::string>& paths,
+        VVJJFlavorSelector* selector)
+{
+    std::vector<Shard> shards;
+    if (!partition_shards(paths, num_processes, shards))
+        return false;
+
+    std::vector<std::string> shard_prefixes;
+    for (size_t i = 0; i < shards.size(); i++) {
+        shard_prefixes.push_back(selector->output_path + "." + gen + ".shard" + std::to_string(i));
+
+        const std::string list_path = shard_prefixes.back() + ".list";
+        std::ofstream list_file(list_path.c_str(), std::ios::trunc);
+        for (auto const& path : shards[i].paths) {
+            list_file << path << " " << gen << std::endl;
+        }
+
+        list_file.close();
+        if (!list_file) {
+            std::cout << "ERROR: failed to write shard input file list: " << list_path << std::endl;
+            return false;
+        }
+
+        std::cout << "\tshard " << i << ": " << shards[i].paths.size() << " files" << std::endl;
+    }
+
+    std::deque<size_t> queued;
+    for (size_t i = 0; i < shards.size(); i++) {
+        queued.push_back(i);
+    }
+
+    std::vector<unsigned> num_attempts(shards.size(), 0);
+    std::map<pid_t, size_t> running;
+    bool failed = false;
+
+    while (!running.empty() || (!queued.empty() && !failed)) {
+        while (!queued.empty() && !failed && running.size() < num_processes) {
+            const size_t i = queued.front();
+            queued.pop_front();
+
+            const pid_t pid = spawn_worker(shard_prefixes[i]);
+            if (pid < 0) {
+                std::cout << "ERROR: failed to start worker process: " << std::strerror(errno) << std::endl;
+                failed = true;
+                break;
+            }
+
+            num_attempts[i]++;
+            running[pid] = i;
+        }
+
+        if (running.empty())
+            break;
+
+        int status;
+        const pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            std::cout << "ERROR: failed to wait for worker processes: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        auto it = running.find(pid);
+        if (it == running.end()) continue;
+
+        const size_t i = it->second;
+        running.erase(it);
+
+        struct stat info;
+        const bool exited = WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+        if (exited && stat((shard_prefixes[i] + ".state").c_str(), &info) == 0) {
+            std::cout << "\tshard " << i << " done" << std::endl;
+            continue;
+        }
+
+        std::string reason;
+        if (WIFSIGNALED(status))
+            reason = "killed by signal " + std::to_string(WTERMSIG(status));
+        else if (!exited)
+            reason = "exit status " + std::to_string(WEXITSTATUS(status));
+        else
+            reason = "no state written";
+
+        if (num_attempts[i] < MAX_SHARD_ATTEMPTS && !failed) {
+            std::cout << "WARNING: shard " << i << " failed (" << reason << "), retrying, see "
+                << shard_prefixes[i] << ".log" << std::endl;
+            queued.push_back(i);
+        } else {
+            std::cout << "ERROR: shard " << i << " failed " << num_attempts[i] << " times (" << reason
+                << "), see " << shard_prefixes[i] << ".log" << std::endl;
+            failed = true;
+        }
+    }
+
+    if (failed)
+        return false;
+
+    std::cout << std::endl << "### Merging " << shards.size() << " shards: " << gen << " ###" << std::endl;
+
+    selector->Begin(nullptr);
+
+    for (auto const& shard_prefix : shard_prefixes) {
+        if (!selector->add_state(shard_prefix + ".state"))
+            return false;
+    }
+
+    selector->Terminate();
+
+    for (auto const& shard_prefix : shard_prefixes) {
+        std::remove((shard_prefix + ".list").c_str());
+        std::remove((shard_prefix + ".state").c_str());
+        std::remove((shard_prefix + ".log").c_str());
+    }
+
+    return true;
+}
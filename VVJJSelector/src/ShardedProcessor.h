@@ -0,0 +1,57 @@
+#ifndef ShardedProcessor_h
+#define ShardedProcessor_h
+
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <Rtypes.h>
+
+#include "VVJJFlavorSelector.h"
+
+// A share of the input files of a generator, processed by one worker process.
+struct Shard {
+    std::vector<std::string> paths;
+    Double_t cost;
+};
+
+// Split paths into (at most) num_shards shards of similar cost, where the
+// cost of a file is its share of the total size plus its share of the total
+// number of entries of the Nominal trees. Returns false (after printing an
+// error) if a file can't be opened.
+bool partition_shards(const std::vector<std::string>& paths, unsigned num_shards, std::vector<Shard>& shards);
+
+// Runs a VVJJFlavorSelector over the input files of a generator in a pool of
+// worker processes.
+//
+// The files are partitioned into balanced shards, and each shard is run by
+// a copy of this program (program, with worker_options) that gets the shard
+// as its input file list and saves the state of its selector (see
+// VVJJFlavorSelector::write_state()) instead of writing the output. A worker
+// that crashes, exits with an error or leaves no state is run again, up to
+// MAX_SHARD_ATTEMPTS times, so e.g. a crash in the ROOT I/O of one file
+// neither takes down the other shards nor the driver. Once every shard is
+// done their states are added to the caller's selector, which then writes
+// the output in Terminate() as usual.
+//
+// The list, state and log file of each shard are kept next to the output, as
+// <output_path>.<gen>.shard<N>.{list,state,log}, and removed after the merge.
+class ShardedProcessor {
+    private:
+        const std::string program;
+        const std::vector<std::string> worker_options;
+        const unsigned num_processes;
+
+        pid_t spawn_worker(const std::string& shard_prefix) const;
+
+    public:
+        static const unsigned MAX_SHARD_ATTEMPTS = 3;
+
+        ShardedProcessor(std::string program_, std::vector<std::string> worker_options_, unsigned num_processes_);
+
+        // returns false (after printing an error) if a shard keeps failing
+        bool process(const std::string& gen, const std::vector<std::string>& paths, VVJJFlavorSelector* selector);
+};
+
+#endif // #ifdef ShardedProcessor_h
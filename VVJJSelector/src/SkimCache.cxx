@@ -0,0 +1,168 @@
+#define SkimCache_cxx
+
+#include <TDirectory.h>
+#include <TParameter.h>
+#include <TSystem.h>
+
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "SkimCache.h"
+
+SkimCache::SkimCache(std::string cache_dir_, ULong64_t selection_hash_) :
+    cache_dir(cache_dir_),
+    selection_hash(selection_hash_),
+    output_tree(nullptr),
+    num_entries_expected(0),
+    num_entries_seen(0),
+    sum_weights_rejected(0)
+{
+    gSystem->mkdir(cache_dir.c_str(), kTRUE);
+}
+
+SkimCache::~SkimCache()
+{
+    end_file();
+}
+
+std::string
+SkimCache::cache_path(const std::string& input_path) const
+{
+    std::unique_ptr<TFile> input_file(TFile::Open(input_path.c_str(), "READ"));
+
+    if (!input_file || input_file->IsZombie())
+        return "";
+
+    std::stringstream ss;
+    ss << cache_dir << "/" << input_file->GetUUID().AsString()
+        << "-" << input_file->GetSize()
+        << "-" << std::hex << std::setw(16) << std::setfill('0') << selection_hash
+        << ".root";
+
+    return ss.str();
+}
+
+bool
+SkimCache::lookup(const std::string& input_path, std::string& cached_path,
+        Double_t& sum_weights_rejected_, bool schedule_write)
+{
+    const std::string path = cache_path(input_path);
+
+    if (path.empty())
+        return false;
+
+    // the file is only renamed to path once complete, so existing is enough
+    std::unique_ptr<TFile> cache_file;
+    if (!gSystem->AccessPathName(path.c_str()))
+        cache_file.reset(TFile::Open(path.c_str(), "READ"));
+
+    TParameter<Double_t>* rejected = nullptr;
+    if (cache_file && !cache_file->IsZombie())
+        rejected = dynamic_cast<TParameter<Double_t>*>(cache_file->Get("sum_weights_rejected"));
+
+    if (rejected == nullptr) {
+        if (schedule_write)
+            pending_paths.insert(input_path);
+        return false;
+    }
+
+    cached_path = path;
+    sum_weights_rejected_ = rejected->GetVal();
+    delete rejected;
+
+    return true;
+}
+
+void
+SkimCache::begin_file(const std::string& input_path, Long64_t num_entries,
+        Double_t* const column_addresses[NUM_EVENT_COLUMNS])
+{
+    end_file();
+
+    if (pending_paths.erase(input_path) == 0)
+        return;
+
+    output_path = cache_path(input_path);
+    if (output_path.empty())
+        return;
+
+    // keep the chain's current directory untouched
+    TDirectory::TContext context;
+
+    const std::string tmp_path = output_path + ".tmp";
+    output_file.reset(new TFile(tmp_path.c_str(), "RECREATE", "",
+                ROOT::CompressionSettings(ROOT::kLZ4, 4)));
+
+    if (output_file->IsZombie()) {
+        std::cout << "WARNING: failed to create skim cache file: " << tmp_path << std::endl;
+        output_file.reset();
+        return;
+    }
+
+    output_tree = new TTree("Nominal", "VVJJ skim cache");
+
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        const std::string leaf_list = std::string(EVENT_COLUMN_NAMES[col]) + "/D";
+        output_tree->Branch(EVENT_COLUMN_NAMES[col], column_addresses[col], leaf_list.c_str());
+    }
+
+    num_entries_expected = num_entries;
+    num_entries_seen = 0;
+    sum_weights_rejected = 0;
+}
+
+void
+SkimCache::reject(Double_t full_weight)
+{
+    if (!output_file) return;
+
+    sum_weights_rejected += full_weight;
+    num_entries_seen++;
+}
+
+void
+SkimCache::fill(void)
+{
+    if (!output_file) return;
+
+    output_tree->Fill();
+    num_entries_seen++;
+}
+
+void
+SkimCache::commit(void)
+{
+    TDirectory::TContext context(output_file.get());
+
+    TParameter<Double_t> rejected("sum_weights_rejected", sum_weights_rejected);
+    TParameter<Long64_t> num_entries("num_entries_source", num_entries_seen);
+
+    output_tree->Write();
+    rejected.Write();
+    num_entries.Write();
+}
+
+void
+SkimCache::end_file(void)
+{
+    if (!output_file) return;
+
+    const std::string tmp_path = output_path + ".tmp";
+    const bool complete = num_entries_seen == num_entries_expected;
+
+    if (complete)
+        commit();
+
+    // also deletes output_tree
+    output_file->Close();
+    output_file.reset();
+    output_tree = nullptr;
+
+    if (complete && std::rename(tmp_path.c_str(), output_path.c_str()) == 0) {
+        std::cout << "\tskim cache written: " << output_path << std::endl;
+    } else {
+        std::remove(tmp_path.c_str());
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef SkimCache_h
+#define SkimCache_h
+
+#include <memory>
+#include <set>
+#include <string>
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include "EventBlock.h"
+
+// A local cache of the VVJJ_EVENT_COLUMNS of the events passing the baseline
+// selection, one cache file per input ntuple.
+//
+// Cache files are keyed by the UUID and size of the input file (a cheap
+// stand-in for a checksum of its contents) and by the selection_hash() of the
+// SelectionConfig, so that changing either the input or the baseline cuts
+// invalidates them. Each holds a "Nominal" TTree with only the cached
+// columns, along with the total weight of the events that failed the
+// selection, which is needed to reproduce sum_weights_total without them.
+//
+// Cache files are written while the input is processed sequentially (see
+// VVJJFlavorSelector::Notify), to a temporary name that is only renamed into
+// place once every entry of the input tree has been seen.
+class SkimCache {
+    private:
+        const std::string cache_dir;
+        const ULong64_t selection_hash;
+
+        // inputs without a valid cache file, to be written on this pass
+        std::set<std::string> pending_paths;
+
+        // the cache file currently being written
+        std::unique_ptr<TFile> output_file;
+        TTree* output_tree;
+        std::string output_path;
+        Long64_t num_entries_expected;
+        Long64_t num_entries_seen;
+        Double_t sum_weights_rejected;
+
+        void commit(void);
+
+    public:
+        SkimCache(std::string cache_dir_, ULong64_t selection_hash_);
+        ~SkimCache();
+
+        // path of the cache file for an input file, empty if it can't be opened
+        std::string cache_path(const std::string& input_path) const;
+
+        // If a complete cache file exists for input_path, set cached_path to
+        // it and sum_weights_rejected to the weight of the events it left out
+        // and return true. Otherwise return false and (if schedule_write is
+        // true) remember to write one the next time input_path is processed.
+        bool lookup(const std::string& input_path, std::string& cached_path,
+                Double_t& sum_weights_rejected, bool schedule_write);
+
+        // start writing the cache file of input_path (if it was scheduled),
+        // reading each column from the given address on every fill()
+        void begin_file(const std::string& input_path, Long64_t num_entries,
+                Double_t* const column_addresses[NUM_EVENT_COLUMNS]);
+
+        // record an event of the current file failing/passing the selection
+        void reject(Double_t full_weight);
+        void fill(void);
+
+        // finish the current cache file, keeping it only if it is complete
+        void end_file(void);
+};
+
+#endif // #ifdef SkimCache_h
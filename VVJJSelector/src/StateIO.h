@@ -0,0 +1,74 @@
+#ifndef StateIO_h
+#define StateIO_h
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include <Rtypes.h>
+
+// Native-endian binary I/O of the accumulated state of a selector, see
+// VVJJFlavorSelector::write_state(). State files are only ever read back
+// on the machine (or at least the architecture) that wrote them.
+
+template <class T>
+inline void
+write_state_value(std::ostream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T>
+inline bool
+read_state_value(std::istream& in, T& value)
+{
+    return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+inline void
+write_state_values(std::ostream& out, const Double_t* values, size_t n)
+{
+    out.write(reinterpret_cast<const char*>(values), n * sizeof(Double_t));
+}
+
+// add n values read from in to values
+inline bool
+add_state_values(std::istream& in, Double_t* values, size_t n)
+{
+    Double_t chunk[512];
+
+    while (n > 0) {
+        const size_t count = n < 512 ? n : 512;
+        if (!in.read(reinterpret_cast<char*>(chunk), count * sizeof(Double_t)))
+            return false;
+
+        for (size_t i = 0; i < count; i++)
+            values[i] += chunk[i];
+
+        values += count;
+        n -= count;
+    }
+
+    return true;
+}
+
+inline void
+write_state_string(std::ostream& out, const std::string& str)
+{
+    write_state_value<UInt_t>(out, str.size());
+    out.write(str.data(), str.size());
+}
+
+inline bool
+read_state_string(std::istream& in, std::string& str)
+{
+    UInt_t size;
+    if (!read_state_value(in, size))
+        return false;
+
+    str.resize(size);
+    return size == 0 || bool(in.read(&str[0], size));
+}
+
+#endif // #ifdef StateIO_h
@@ -1,261 +1,258 @@
 #define TH1Topo_cxx
 
 #include <TH1F.h>
+#include <TGraphAsymmErrors.h>
 
+#include <algorithm>
 #include <cassert>
-#include <unordered_map>
 
 #include "TH1Topo.h"
 
-TH1Topo::TH1Topo(std::string var_name_, float x_min_, float x_max_, float bin_spacing_) :
-    h_inclusive(nullptr),
-    h_q(nullptr),
-    h_g(nullptr),
-    h_qq(nullptr),
-    h_qg(nullptr),
-    h_gg(nullptr),
+TH1Topo::TH1Topo(TH1TopoStore* store_, const TagRegistry* tags_, std::string var_name_,
+        float x_min_, float x_max_, float bin_spacing_, bool tagged_) :
+    store(store_),
+    tags(tags_),
+    store_offset(0),
+    slot_size(0),
     var_name(var_name_),
     x_min(x_min_),
     x_max(x_max_),
     bin_spacing(bin_spacing_),
-    num_bins( (x_max - x_min) / bin_spacing )
-{ }
-
-TH1Topo::~TH1Topo(void)
+    num_bins( (x_max - x_min) / bin_spacing ),
+    tagged(tagged_)
 {
-    if (h_inclusive != nullptr)
-        delete h_inclusive;
-    if (h_q != nullptr)
-        delete h_q;
-    if (h_g != nullptr)
-        delete h_g;
-    if (h_qq != nullptr)
-        delete h_qq;
-    if (h_qg != nullptr)
-        delete h_qg;
-    if (h_gg != nullptr)
-        delete h_gg;
-
-    for (auto const& h : this->hs_inclusive_tagged)
-        delete h.second;
-    for (auto const& h : this->hs_q_tagged)
-        delete h.second;
-    for (auto const& h : this->hs_g_tagged)
-        delete h.second;
-    for (auto const& h : this->hs_qq_tagged)
-        delete h.second;
-    for (auto const& h : this->hs_qg_tagged)
-        delete h.second;
-    for (auto const& h : this->hs_gg_tagged)
-        delete h.second;
+    const UInt_t num_event_tags = tagged ? tags->num_event_tags() : 0;
+    const UInt_t num_jet_tags = tagged ? tags->num_jet_tags() : 0;
+
+    topology_num_tags[TopoInclusive]  = num_event_tags;
+    topology_num_tags[TopoQuark]      = num_jet_tags;
+    topology_num_tags[TopoGluon]      = num_jet_tags;
+    topology_num_tags[TopoQuarkQuark] = num_event_tags;
+    topology_num_tags[TopoQuarkGluon] = num_event_tags;
+    topology_num_tags[TopoGluonGluon] = num_event_tags;
+
+    // statistics + (sumw, sumw2) for every bin, including underflow/overflow
+    slot_size = SLOT_HEADER_SIZE + 2 * (num_bins + 2);
+
+    size_t total_size = 0;
+    for (int topo = 0; topo < NUM_TOPOLOGIES; topo++) {
+        topology_offsets[topo] = total_size;
+        total_size += (1 + topology_num_tags[topo]) * slot_size;
+    }
+
+    store_offset = store->allocate(total_size);
 }
 
-void
-TH1Topo::fill_inclusive(float val, float weight)
+TH1Topo::~TH1Topo(void)
+{ }
+
+int
+TH1Topo::find_bin(double x) const
 {
-    if (h_inclusive == nullptr) {
-        h_inclusive = new TH1F(var_name.c_str(), var_name.c_str(), num_bins, x_min, x_max);
-        h_inclusive->Sumw2();
+    // identical to TAxis::FindBin for a fixed-bin axis, so that the binning
+    // matches what TH1F::Fill would have produced
+    if (x < x_min) {
+        return 0;
+    } else if (!(x < x_max)) {
+        return num_bins + 1;
+    } else {
+        return 1 + int(num_bins * (x - (double) x_min) / ((double) x_max - (double) x_min));
     }
-
-    h_inclusive->Fill(val, weight);
 }
 
 void
-TH1Topo::fill_inclusive_tagged(std::string tag_name, bool tag_condition,
-        float val, float weight)
+TH1Topo::fill_slot(Double_t* slot, int bin, double x, double w)
 {
-    if (!tag_condition) return;
+    Double_t* bin_sums = slot + SLOT_HEADER_SIZE + 2 * bin;
+    bin_sums[0] += w;
+    bin_sums[1] += w * w;
 
-    bool tagged_histogram_exists = hs_inclusive_tagged.find(tag_name) != hs_inclusive_tagged.end();
+    slot[STAT_ENTRIES] += 1;
 
-    if (!tagged_histogram_exists) {
-        std::string name = var_name + "_" + tag_name;
-        hs_inclusive_tagged.emplace(tag_name,
-                new TH1F(name.c_str(), name.c_str(), num_bins, x_min, x_max));
-        hs_inclusive_tagged.at(tag_name)->Sumw2();
-    }
+    // like TH1::Fill, under/overflow does not contribute to the statistics
+    if (bin == 0 || bin > num_bins) return;
 
-    hs_inclusive_tagged.at(tag_name)->Fill(val, weight);
+    slot[STAT_TSUMW]   += w;
+    slot[STAT_TSUMW2]  += w * w;
+    slot[STAT_TSUMWX]  += w * x;
+    slot[STAT_TSUMWX2] += w * x * x;
 }
 
 void
-TH1Topo::fill_event_topo(EventFlavorTopo event_topo, float val, float weight)
+TH1Topo::fill_tagged(Topology topo, TagMask tags, float val, float weight)
 {
-    if (event_topo == EventFlavorTopo::QuarkQuark) {
-
-        if (h_qq == nullptr) {
-            std::string name = var_name + "_qq";
-            h_qq = new TH1F(name.c_str(), name.c_str(), num_bins, x_min, x_max);
-            h_qq->Sumw2();
-        }
-
-        h_qq->Fill(val, weight);
-
-    } else if (event_topo == EventFlavorTopo::QuarkGluon) {
-
-        if (h_qg == nullptr) {
-            std::string name = var_name + "_qg";
-            h_qg = new TH1F(name.c_str(), name.c_str(), num_bins, x_min, x_max);
-            h_qg->Sumw2();
-        }
-
-        h_qg->Fill(val, weight);
+    assert(tagged);
 
-    } else {
+    const int bin = find_bin(val);
 
-        assert(event_topo == EventFlavorTopo::GluonGluon);
-
-        if (h_gg == nullptr) {
-            std::string name = var_name + "_gg";
-            h_gg = new TH1F(name.c_str(), name.c_str(), num_bins, x_min, x_max);
-            h_gg->Sumw2();
-        }
+    // visit the set bits of the tag mask, lowest tag id first
+    while (tags != 0) {
+        const UInt_t id = __builtin_ctz(tags);
+        tags &= tags - 1;
 
-        h_gg->Fill(val, weight);
+        fill_slot(slot(topo, 1 + id), bin, val, weight);
     }
 }
 
 void
-TH1Topo::fill_event_topo_tagged(EventFlavorTopo event_topo, std::string tag_name,
-        bool tag_condition, float val, float weight)
+TH1Topo::fill_inclusive(float val, float weight)
 {
-    if (!tag_condition) return;
-
-    if (event_topo == EventFlavorTopo::QuarkQuark) {
+    fill_slot(slot(TopoInclusive, 0), find_bin(val), val, weight);
+}
 
-        bool tagged_qq_histogram_exists =
-            hs_qq_tagged.find(tag_name) != hs_qq_tagged.end();
+void
+TH1Topo::fill_inclusive_tagged(TagMask event_tags, float val, float weight)
+{
+    fill_tagged(TopoInclusive, event_tags, val, weight);
+}
 
-        if (!tagged_qq_histogram_exists) {
-            std::string name = var_name + "_" + tag_name + "_qq";
-            hs_qq_tagged.emplace(tag_name,
-                    new TH1F(name.c_str(), name.c_str(), num_bins, x_min, x_max));
-            hs_qq_tagged.at(tag_name)->Sumw2();
-        }
+void
+TH1Topo::fill_event_topo(EventFlavorTopo event_topo, float val, float weight)
+{
+    const Topology topo = static_cast<Topology>(TopoQuarkQuark + static_cast<int>(event_topo));
+    fill_slot(slot(topo, 0), find_bin(val), val, weight);
+}
 
-        hs_qq_tagged.at(tag_name)->Fill(val, weight);
+void
+TH1Topo::fill_event_topo_tagged(EventFlavorTopo event_topo, TagMask event_tags,
+        float val, float weight)
+{
+    const Topology topo = static_cast<Topology>(TopoQuarkQuark + static_cast<int>(event_topo));
+    fill_tagged(topo, event_tags, val, weight);
+}
 
-    } else if (event_topo == EventFlavorTopo::QuarkGluon) {
+void
+TH1Topo::fill_jet_topo(JetTopo jet_topo, float val, float weight)
+{
+    const Topology topo = static_cast<Topology>(TopoQuark + static_cast<int>(jet_topo));
+    fill_slot(slot(topo, 0), find_bin(val), val, weight);
+}
 
-        bool tagged_qg_histogram_exists =
-            hs_qg_tagged.find(tag_name) != hs_qg_tagged.end();
+void
+TH1Topo::fill_jet_topo_tagged(JetTopo jet_topo, TagMask jet_tags,
+        float val, float weight)
+{
+    const Topology topo = static_cast<Topology>(TopoQuark + static_cast<int>(jet_topo));
+    fill_tagged(topo, jet_tags, val, weight);
+}
 
-        if (!tagged_qg_histogram_exists) {
-            std::string name = var_name + "_" + tag_name + "_qg";
-            hs_qg_tagged.emplace(tag_name,
-                    new TH1F(name.c_str(), name.c_str(), num_bins, x_min, x_max));
-            hs_qg_tagged.at(tag_name)->Sumw2();
-        }
+void
+TH1Topo::write_slot(const Double_t* slot, const std::string& name) const
+{
+    // skip histograms that were never filled, like the old lazily-booked TH1F
+    if (slot[STAT_ENTRIES] == 0) return;
 
-        hs_qg_tagged.at(tag_name)->Fill(val, weight);
+    TH1F h(name.c_str(), name.c_str(), num_bins, x_min, x_max);
+    h.SetDirectory(nullptr);
+    h.Sumw2();
 
-    } else {
-        assert(event_topo == EventFlavorTopo::GluonGluon);
+    Double_t* sumw2 = h.GetSumw2()->GetArray();
+    const Double_t* bin_sums = slot + SLOT_HEADER_SIZE;
 
-        bool tagged_gg_histogram_exists =
-            hs_gg_tagged.find(tag_name) != hs_gg_tagged.end();
+    for (int bin = 0; bin < num_bins + 2; bin++) {
+        h.fArray[bin] = bin_sums[2 * bin];
+        sumw2[bin] = bin_sums[2 * bin + 1];
+    }
 
-        if (!tagged_gg_histogram_exists) {
-            std::string name = var_name + "_" + tag_name + "_gg";
-            hs_gg_tagged.emplace(tag_name,
-                    new TH1F(name.c_str(), name.c_str(), num_bins, x_min, x_max));
-            hs_gg_tagged.at(tag_name)->Sumw2();
-        }
+    Double_t stats[4] = {
+        slot[STAT_TSUMW], slot[STAT_TSUMW2], slot[STAT_TSUMWX], slot[STAT_TSUMWX2]
+    };
+    h.PutStats(stats);
+    h.SetEntries(slot[STAT_ENTRIES]);
 
-        hs_gg_tagged.at(tag_name)->Fill(val, weight);
-    }
+    h.Write();
 }
 
 void
-TH1Topo::fill_jet_topo(JetTopo jet_topo, float val, float weight)
+TH1Topo::write_all_histograms(void) const
 {
-    if (jet_topo == JetTopo::Quark) {
-
-        if (h_q == nullptr) {
-            std::string name = var_name + "_q";
-            h_q = new TH1F(name.c_str(), name.c_str(), num_bins, x_min, x_max);
-            h_q->Sumw2();
-        }
-
-        h_q->Fill(val, weight);
+    static const char* const topology_suffixes[NUM_TOPOLOGIES] = {
+        "", "_q", "_g", "_qq", "_qg", "_gg"
+    };
 
-    } else {
+    for (int topo = 0; topo < NUM_TOPOLOGIES; topo++) {
+        write_slot(slot(static_cast<Topology>(topo), 0), var_name + topology_suffixes[topo]);
+    }
 
-        assert(jet_topo == JetTopo::Gluon);
+    for (int topo = 0; topo < NUM_TOPOLOGIES; topo++) {
+        const bool jet_topo = topo == TopoQuark || topo == TopoGluon;
 
-        if (h_g == nullptr) {
-            std::string name = var_name + "_g";
-            h_g = new TH1F(name.c_str(), name.c_str(), num_bins, x_min, x_max);
-            h_g->Sumw2();
+        for (UInt_t id = 0; id < topology_num_tags[topo]; id++) {
+            const char* tag_name = jet_topo ? tags->jet_tag_name(id) : tags->event_tag_name(id);
+            write_slot(slot(static_cast<Topology>(topo), 1 + id),
+                    var_name + "_" + tag_name + topology_suffixes[topo]);
         }
-
-        h_g->Fill(val, weight);
     }
 }
 
 void
-TH1Topo::fill_jet_topo_tagged(JetTopo jet_topo, std::string tag_name, bool tag_condition,
-        float val, float weight)
+TH1Topo::write_efficiency(const Double_t* passed_slot, const Double_t* total_slot,
+        const std::string& name, EfficiencyInterval interval) const
 {
-    if (!tag_condition) return;
+    // written even for a tag never passed (zero efficiency where the
+    // total was filled), as the plotting scripts expect every graph
+    TGraphAsymmErrors graph;
+    graph.SetName(name.c_str());
+    graph.SetTitle(name.c_str());
+
+    const Double_t* passed_sums = passed_slot + SLOT_HEADER_SIZE;
+    const Double_t* total_sums = total_slot + SLOT_HEADER_SIZE;
+
+    for (int bin = 1; bin <= num_bins; bin++) {
+        Efficiency eff;
+        if (!compute_efficiency(passed_sums[2 * bin], total_sums[2 * bin], total_sums[2 * bin + 1],
+                    interval, eff))
+            continue;
+
+        const Double_t x = x_min + (bin - 0.5) * ((double) x_max - (double) x_min) / num_bins;
+        const Double_t half_width = 0.5 * ((double) x_max - (double) x_min) / num_bins;
+
+        const Int_t point = graph.GetN();
+        graph.SetPoint(point, x, eff.value);
+        graph.SetPointError(point, half_width, half_width,
+                std::max(eff.value - eff.low, 0.), std::max(eff.high - eff.value, 0.));
+    }
 
-    if (jet_topo == JetTopo::Quark) {
-        bool tagged_q_histogram_exists =
-            hs_q_tagged.find(tag_name) != hs_q_tagged.end();
+    graph.Write();
+}
 
-        if (!tagged_q_histogram_exists) {
-            std::string name = var_name + "_" + tag_name + "_q";
-            hs_q_tagged.emplace(tag_name,
-                    new TH1F(name.c_str(), name.c_str(), num_bins, x_min, x_max));
-            hs_q_tagged.at(tag_name)->Sumw2();
+void
+TH1Topo::write_efficiencies(EfficiencyInterval interval) const
+{
+    static const char* const topology_suffixes[NUM_TOPOLOGIES] = {
+        "", "_q", "_g", "_qq", "_qg", "_gg"
+    };
+
+    // the selector never fills the tagged inclusive slots (see
+    // fill_inclusive_tagged()), their graphs would be all zero
+    for (int topo = TopoQuark; topo < NUM_TOPOLOGIES; topo++) {
+        const bool jet_topo = topo == TopoQuark || topo == TopoGluon;
+        const Double_t* total_slot = slot(static_cast<Topology>(topo), 0);
+
+        for (UInt_t id = 0; id < topology_num_tags[topo]; id++) {
+            const char* tag_name = jet_topo ? tags->jet_tag_name(id) : tags->event_tag_name(id);
+            write_efficiency(slot(static_cast<Topology>(topo), 1 + id), total_slot,
+                    var_name + "_" + tag_name + topology_suffixes[topo] + "_eff", interval);
         }
+    }
+}
 
-        hs_q_tagged.at(tag_name)->Fill(val, weight);
-
-    } else {
-        assert(jet_topo == JetTopo::Gluon);
-
-        bool tagged_g_histogram_exists =
-            hs_g_tagged.find(tag_name) != hs_g_tagged.end();
+bool
+TH1Topo::jet_tag_efficiency(JetTopo jet_topo, UInt_t id, EfficiencyInterval interval,
+        Efficiency& efficiency) const
+{
+    assert(tagged);
 
-        if (!tagged_g_histogram_exists) {
-            std::string name = var_name + "_" + tag_name + "_g";
-            hs_g_tagged.emplace(tag_name,
-                    new TH1F(name.c_str(), name.c_str(), num_bins, x_min, x_max));
-            hs_g_tagged.at(tag_name)->Sumw2();
-        }
+    const Topology topo = static_cast<Topology>(TopoQuark + static_cast<int>(jet_topo));
+    const Double_t* passed_sums = slot(topo, 1 + id) + SLOT_HEADER_SIZE;
+    const Double_t* total_sums = slot(topo, 0) + SLOT_HEADER_SIZE;
 
-        hs_g_tagged.at(tag_name)->Fill(val, weight);
+    Double_t passed_sumw = 0, total_sumw = 0, total_sumw2 = 0;
+    for (int bin = 0; bin < num_bins + 2; bin++) {
+        passed_sumw += passed_sums[2 * bin];
+        total_sumw  += total_sums[2 * bin];
+        total_sumw2 += total_sums[2 * bin + 1];
     }
-}
 
-void
-TH1Topo::write_all_histograms(void) const
-{
-    if (h_inclusive != nullptr)
-        h_inclusive->Write();
-    if (h_q != nullptr)
-        h_q->Write();
-    if (h_g != nullptr)
-        h_g->Write();
-    if (h_qq != nullptr)
-        h_qq->Write();
-    if (h_qg != nullptr)
-        h_qg->Write();
-    if (h_gg != nullptr)
-        h_gg->Write();
-
-    for (auto const& h : this->hs_inclusive_tagged)
-        h.second->Write();
-    for (auto const& h : this->hs_q_tagged)
-        h.second->Write();
-    for (auto const& h : this->hs_g_tagged)
-        h.second->Write();
-    for (auto const& h : this->hs_qq_tagged)
-        h.second->Write();
-    for (auto const& h : this->hs_qg_tagged)
-        h.second->Write();
-    for (auto const& h : this->hs_gg_tagged)
-        h.second->Write();
+    return compute_efficiency(passed_sumw, total_sumw, total_sumw2, interval, efficiency);
 }
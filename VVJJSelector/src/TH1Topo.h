@@ -1,10 +1,15 @@
 #ifndef TH1Topo_h
 #define TH1Topo_h
 
-#include <unordered_map>
+#include <array>
+#include <string>
 
 #include <TH1F.h>
 
+#include "Efficiency.h"
+#include "TagRegistry.h"
+#include "TH1TopoStore.h"
+
 enum class EventFlavorTopo {
     QuarkQuark,
     QuarkGluon,
@@ -16,24 +21,65 @@ enum class JetTopo {
     Gluon
 };
 
+// A family of fixed-bin 1D histograms of one variable, split by jet/event
+// flavor topology and by jet/event tag.
+//
+// The bin contents live in a dense region of a TH1TopoStore, laid out as
+// [topology][tag][bin] with the untagged histogram in tag slot 0. Each slot
+// holds the TH1 statistics followed by (sumw, sumw2) pairs for every bin,
+// including underflow and overflow. Real TH1F objects are only created in
+// write_all_histograms(), and only for slots that were ever filled.
 class TH1Topo {
     private:
-        TH1F* h_inclusive;
-        TH1F* h_q;
-        TH1F* h_g;
-        TH1F* h_qq;
-        TH1F* h_qg;
-        TH1F* h_gg;
-
-        std::unordered_map<std::string, TH1F*> hs_inclusive_tagged;
-        std::unordered_map<std::string, TH1F*> hs_q_tagged;
-        std::unordered_map<std::string, TH1F*> hs_g_tagged;
-        std::unordered_map<std::string, TH1F*> hs_qq_tagged;
-        std::unordered_map<std::string, TH1F*> hs_qg_tagged;
-        std::unordered_map<std::string, TH1F*> hs_gg_tagged;
+        enum Topology {
+            TopoInclusive,
+            TopoQuark,
+            TopoGluon,
+            TopoQuarkQuark,
+            TopoQuarkGluon,
+            TopoGluonGluon,
+            NUM_TOPOLOGIES
+        };
+
+        enum SlotHeader {
+            STAT_ENTRIES,
+            STAT_TSUMW,
+            STAT_TSUMW2,
+            STAT_TSUMWX,
+            STAT_TSUMWX2,
+            SLOT_HEADER_SIZE = 6
+        };
+
+        TH1TopoStore* store;      //!
+        const TagRegistry* tags;  //!
+        size_t store_offset;      //!
+        size_t slot_size;     //!
+
+        // offset of the first slot of each topology, relative to store_offset
+        std::array<size_t, NUM_TOPOLOGIES> topology_offsets;  //!
+        std::array<UInt_t, NUM_TOPOLOGIES> topology_num_tags; //!
+
+        int find_bin(double x) const;
+        void fill_slot(Double_t* slot, int bin, double x, double w);
+        void fill_tagged(Topology topo, TagMask tags, float val, float weight);
+
+        Double_t* slot(Topology topo, UInt_t tag_slot) {
+            return store->data(store_offset + topology_offsets[topo] + tag_slot * slot_size);
+        }
+        const Double_t* slot(Topology topo, UInt_t tag_slot) const {
+            return store->data(store_offset + topology_offsets[topo] + tag_slot * slot_size);
+        }
+
+        void write_slot(const Double_t* slot, const std::string& name) const;
+        void write_efficiency(const Double_t* passed_slot, const Double_t* total_slot,
+                const std::string& name, EfficiencyInterval interval) const;
 
     public:
-        TH1Topo(std::string var_name_, float x_min_, float x_max_, float bin_spacing_);
+        // Untagged TH1Topo (tagged_ = false) only reserve space for the
+        // untagged histogram of each topology. Tagged ones are filled for
+        // every tag of tags_, which must outlive the TH1Topo.
+        TH1Topo(TH1TopoStore* store_, const TagRegistry* tags_, std::string var_name_,
+                float x_min_, float x_max_, float bin_spacing_, bool tagged_ = true);
         virtual ~TH1Topo(void);
 
         const std::string var_name;
@@ -41,21 +87,31 @@ class TH1Topo {
         const float x_max;
         const float bin_spacing;
         const int num_bins;
+        const bool tagged;
 
         void fill_inclusive(float val, float weight);
-        void fill_inclusive_tagged(std::string tag_name, bool tag_condition,
-                float val, float weight);
+        void fill_inclusive_tagged(TagMask event_tags, float val, float weight);
 
         void fill_event_topo(EventFlavorTopo event_topo, float val, float weight);
-        void fill_event_topo_tagged(EventFlavorTopo event_topo, std::string tag_name,
-                bool tag_condition, float val, float weight);
+        void fill_event_topo_tagged(EventFlavorTopo event_topo, TagMask event_tags,
+                float val, float weight);
 
         void fill_jet_topo(JetTopo jet_topo, float val, float weight);
-        void fill_jet_topo_tagged(JetTopo jet_topo, std::string tag_name, bool tag_condition,
+        void fill_jet_topo_tagged(JetTopo jet_topo, TagMask jet_tags,
                 float val, float weight);
 
         void write_all_histograms(void) const;
 
+        // Write the efficiency of every tag (even one never passed) of the
+        // jet and event topologies, i.e. its histogram over the untagged one
+        // of the same topology, as a TGraphAsymmErrors named after the tagged
+        // histogram with an "_eff" suffix.
+        void write_efficiencies(EfficiencyInterval interval) const;
+
+        // the efficiency of a jet tag over all bins, including under/overflow
+        bool jet_tag_efficiency(JetTopo jet_topo, UInt_t id, EfficiencyInterval interval,
+                Efficiency& efficiency) const;
+
         ClassDef(TH1Topo, 0);
 };
 
@@ -0,0 +1,97 @@
+#define TH1TopoStore_cxx
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "StateIO.h"
+#include "TH1TopoStore.h"
+
+// allocations are rounded up to whole cache lines
+static const size_t CACHE_LINE_DOUBLES = 64 / sizeof(Double_t);
+
+static Double_t*
+aligned_zeroed_alloc(size_t num_values)
+{
+    void* ptr = nullptr;
+
+    if (posix_memalign(&ptr, 64, num_values * sizeof(Double_t)) != 0)
+        throw std::bad_alloc();
+
+    std::memset(ptr, 0, num_values * sizeof(Double_t));
+    return static_cast<Double_t*>(ptr);
+}
+
+TH1TopoStore::TH1TopoStore(void) :
+    buffer(nullptr),
+    size(0),
+    capacity(0)
+{ }
+
+TH1TopoStore::~TH1TopoStore(void)
+{
+    std::free(buffer);
+}
+
+size_t
+TH1TopoStore::allocate(size_t num_values)
+{
+    const size_t offset = size;
+    const size_t padded = (num_values + CACHE_LINE_DOUBLES - 1) / CACHE_LINE_DOUBLES * CACHE_LINE_DOUBLES;
+
+    if (size + padded > capacity) {
+        size_t new_capacity = capacity > 0 ? capacity : 4096;
+        while (new_capacity < size + padded)
+            new_capacity *= 2;
+
+        Double_t* new_buffer = aligned_zeroed_alloc(new_capacity);
+        if (buffer != nullptr) {
+            std::memcpy(new_buffer, buffer, size * sizeof(Double_t));
+            std::free(buffer);
+        }
+
+        buffer = new_buffer;
+        capacity = new_capacity;
+    }
+
+    size += padded;
+    return offset;
+}
+
+void
+TH1TopoStore::add(const TH1TopoStore& other)
+{
+    // both stores must have been booked with the same sequence of TH1Topo
+    assert(size == other.size);
+
+    Double_t* __restrict__ dst = buffer;
+    const Double_t* __restrict__ src = other.buffer;
+
+    for (size_t i = 0; i < size; i++)
+        dst[i] += src[i];
+}
+
+void
+TH1TopoStore::reset(void)
+{
+    if (buffer != nullptr)
+        std::memset(buffer, 0, size * sizeof(Double_t));
+}
+
+void
+TH1TopoStore::write_state(std::ostream& out) const
+{
+    write_state_value<ULong64_t>(out, size);
+    write_state_values(out, buffer, size);
+}
+
+bool
+TH1TopoStore::add_state(std::istream& in)
+{
+    ULong64_t state_size;
+    if (!read_state_value(in, state_size) || state_size != size)
+        return false;
+
+    return add_state_values(in, buffer, size);
+}
@@ -0,0 +1,46 @@
+#ifndef TH1TopoStore_h
+#define TH1TopoStore_h
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+
+#include <Rtypes.h>
+
+// One contiguous, cache-line aligned block of doubles that backs the bins of
+// every TH1Topo booked by a selector. Each TH1Topo reserves its own region
+// (laid out [topology][tag][bin]) when it is constructed, and keeps only the
+// offset of that region, so growing the store never invalidates a TH1Topo.
+//
+// Keeping all the histogram contents in one array also makes merging two
+// selectors (e.g. per-thread workers) a single element-wise sum.
+class TH1TopoStore {
+    private:
+        Double_t* buffer;
+        size_t size;
+        size_t capacity;
+
+    public:
+        TH1TopoStore(void);
+        ~TH1TopoStore(void);
+
+        TH1TopoStore(const TH1TopoStore&) = delete;
+        TH1TopoStore& operator=(const TH1TopoStore&) = delete;
+
+        // reserve a zero-initialized region of num_values doubles, returns its offset
+        size_t allocate(size_t num_values);
+
+        Double_t* data(size_t offset) { return buffer + offset; }
+        const Double_t* data(size_t offset) const { return buffer + offset; }
+        size_t get_size(void) const { return size; }
+
+        void add(const TH1TopoStore& other);
+        void reset(void);
+
+        // write the contents, or add contents written by a store with the
+        // same layout (returns false if the layout doesn't match)
+        void write_state(std::ostream& out) const;
+        bool add_state(std::istream& in);
+};
+
+#endif // #ifdef TH1TopoStore_h
@@ -0,0 +1,234 @@
+#define THnTopo_cxx
+
+#include <TH2F.h>
+#include <THnSparse.h>
+
+#include <cassert>
+
+#include "THnTopo.h"
+
+THnTopo::THnTopo(THnTopoStore* store_, const TagRegistry* tags_, std::string name_,
+        const std::vector<THnAxis>& axes_, bool tagged_) :
+    store(store_),
+    tags(tags_),
+    store_offset(0),
+    slot_size(0),
+    name(name_),
+    axes(axes_),
+    tagged(tagged_)
+{
+    assert(!axes.empty() && axes.size() <= MAX_DIMENSIONS);
+
+    // every bin, including underflow/overflow, then the entries
+    ULong64_t num_slot_bins = 1;
+    for (auto const& axis : axes) {
+        num_bins.push_back( (axis.x_max - axis.x_min) / axis.bin_spacing );
+        strides.push_back(num_slot_bins);
+        num_slot_bins *= num_bins.back() + 2;
+    }
+    slot_size = num_slot_bins + 1;
+
+    const UInt_t num_event_tags = tagged ? tags->num_event_tags() : 0;
+    const UInt_t num_jet_tags = tagged ? tags->num_jet_tags() : 0;
+
+    topology_num_tags[TopoInclusive]  = num_event_tags;
+    topology_num_tags[TopoQuark]      = num_jet_tags;
+    topology_num_tags[TopoGluon]      = num_jet_tags;
+    topology_num_tags[TopoQuarkQuark] = num_event_tags;
+    topology_num_tags[TopoQuarkGluon] = num_event_tags;
+    topology_num_tags[TopoGluonGluon] = num_event_tags;
+
+    ULong64_t num_slots = 0;
+    for (int topo = 0; topo < NUM_TOPOLOGIES; topo++) {
+        topology_offsets[topo] = num_slots;
+        num_slots += 1 + topology_num_tags[topo];
+    }
+
+    store_offset = store->allocate(num_slots * slot_size);
+}
+
+ULong64_t
+THnTopo::find_bin(const Double_t* vals) const
+{
+    ULong64_t bin = 0;
+
+    for (size_t axis = 0; axis < axes.size(); axis++) {
+        // per axis, identical to TH1Topo::find_bin
+        const THnAxis& a = axes[axis];
+        const double x = vals[axis];
+
+        int axis_bin;
+        if (x < a.x_min) {
+            axis_bin = 0;
+        } else if (!(x < a.x_max)) {
+            axis_bin = num_bins[axis] + 1;
+        } else {
+            axis_bin = 1 + int(num_bins[axis] * (x - (double) a.x_min) / ((double) a.x_max - (double) a.x_min));
+        }
+
+        bin += axis_bin * strides[axis];
+    }
+
+    return bin;
+}
+
+void
+THnTopo::fill_tagged(Topology topo, TagMask tags, const Double_t* vals, float weight)
+{
+    assert(tagged);
+
+    const ULong64_t bin = find_bin(vals);
+
+    // visit the set bits of the tag mask, lowest tag id first
+    while (tags != 0) {
+        const UInt_t id = __builtin_ctz(tags);
+        tags &= tags - 1;
+
+        fill_slot(slot_key(topo, 1 + id), bin, weight);
+    }
+}
+
+void
+THnTopo::fill_inclusive(const Double_t* vals, float weight)
+{
+    fill_slot(slot_key(TopoInclusive, 0), find_bin(vals), weight);
+}
+
+void
+THnTopo::fill_inclusive_tagged(TagMask event_tags, const Double_t* vals, float weight)
+{
+    fill_tagged(TopoInclusive, event_tags, vals, weight);
+}
+
+void
+THnTopo::fill_event_topo(EventFlavorTopo event_topo, const Double_t* vals, float weight)
+{
+    const Topology topo = static_cast<Topology>(TopoQuarkQuark + static_cast<int>(event_topo));
+    fill_slot(slot_key(topo, 0), find_bin(vals), weight);
+}
+
+void
+THnTopo::fill_event_topo_tagged(EventFlavorTopo event_topo, TagMask event_tags,
+        const Double_t* vals, float weight)
+{
+    const Topology topo = static_cast<Topology>(TopoQuarkQuark + static_cast<int>(event_topo));
+    fill_tagged(topo, event_tags, vals, weight);
+}
+
+void
+THnTopo::fill_jet_topo(JetTopo jet_topo, const Double_t* vals, float weight)
+{
+    const Topology topo = static_cast<Topology>(TopoQuark + static_cast<int>(jet_topo));
+    fill_slot(slot_key(topo, 0), find_bin(vals), weight);
+}
+
+void
+THnTopo::fill_jet_topo_tagged(JetTopo jet_topo, TagMask jet_tags,
+        const Double_t* vals, float weight)
+{
+    const Topology topo = static_cast<Topology>(TopoQuark + static_cast<int>(jet_topo));
+    fill_tagged(topo, jet_tags, vals, weight);
+}
+
+void
+THnTopo::write_slot(const std::vector<THnTopoStore::Bin>& bins, Double_t entries,
+        const std::string& hist_name) const
+{
+    // the keys of bins are relative to the slot
+    if (axes.size() == 2) {
+        TH2F h(hist_name.c_str(), hist_name.c_str(),
+                num_bins[0], axes[0].x_min, axes[0].x_max,
+                num_bins[1], axes[1].x_min, axes[1].x_max);
+        h.SetDirectory(nullptr);
+        h.Sumw2();
+        h.GetXaxis()->SetTitle(axes[0].var_name.c_str());
+        h.GetYaxis()->SetTitle(axes[1].var_name.c_str());
+
+        // the slot bins are numbered like the global bins of a TH2F
+        Double_t* sumw2 = h.GetSumw2()->GetArray();
+        for (auto const& b : bins) {
+            h.fArray[b.key] = b.sumw;
+            sumw2[b.key] = b.sumw2;
+        }
+
+        h.ResetStats();
+        h.SetEntries(entries);
+        h.Write();
+        return;
+    }
+
+    std::vector<Int_t> nbins(axes.size());
+    std::vector<Double_t> xmin(axes.size()), xmax(axes.size());
+    for (size_t axis = 0; axis < axes.size(); axis++) {
+        nbins[axis] = num_bins[axis];
+        xmin[axis] = axes[axis].x_min;
+        xmax[axis] = axes[axis].x_max;
+    }
+
+    THnSparseD h(hist_name.c_str(), hist_name.c_str(), axes.size(), nbins.data(), xmin.data(), xmax.data());
+    h.Sumw2();
+    for (size_t axis = 0; axis < axes.size(); axis++) {
+        h.GetAxis(axis)->SetTitle(axes[axis].var_name.c_str());
+    }
+
+    std::vector<Int_t> coords(axes.size());
+    for (auto const& b : bins) {
+        for (size_t axis = 0; axis < axes.size(); axis++) {
+            coords[axis] = (b.key / strides[axis]) % (num_bins[axis] + 2);
+        }
+
+        const Long64_t sparse_bin = h.GetBin(coords.data());
+        h.SetBinContent(sparse_bin, b.sumw);
+        h.SetBinError2(sparse_bin, b.sumw2);
+    }
+
+    h.SetEntries(entries);
+    h.Write();
+}
+
+void
+THnTopo::write_all_histograms(void) const
+{
+    static const char* const topology_suffixes[NUM_TOPOLOGIES] = {
+        "", "_q", "_g", "_qq", "_qg", "_gg"
+    };
+
+    // sort the filled bins of the whole region by slot in one pass
+    const ULong64_t num_slots = topology_offsets[NUM_TOPOLOGIES - 1]
+        + 1 + topology_num_tags[NUM_TOPOLOGIES - 1];
+
+    std::vector< std::vector<THnTopoStore::Bin> > slot_bins(num_slots);
+    std::vector<Double_t> slot_entries(num_slots, 0.);
+
+    store->for_each_bin(store_offset, store_offset + num_slots * slot_size,
+            [&] (const THnTopoStore::Bin& b) {
+        const ULong64_t slot = (b.key - store_offset) / slot_size;
+        const ULong64_t bin = (b.key - store_offset) % slot_size;
+
+        if (bin == slot_size - 1) {
+            slot_entries[slot] = b.sumw;
+        } else {
+            slot_bins[slot].push_back(THnTopoStore::Bin {bin, b.sumw, b.sumw2});
+        }
+    });
+
+    // untagged first, then tagged, like TH1Topo
+    for (int topo = 0; topo < NUM_TOPOLOGIES; topo++) {
+        const ULong64_t slot = topology_offsets[topo];
+        if (slot_entries[slot] == 0) continue;
+
+        write_slot(slot_bins[slot], slot_entries[slot], name + topology_suffixes[topo]);
+    }
+
+    for (int topo = 0; topo < NUM_TOPOLOGIES; topo++) {
+        const bool jet_topo = topo == TopoQuark || topo == TopoGluon;
+
+        for (UInt_t id = 0; id < topology_num_tags[topo]; id++) {
+            const ULong64_t slot = topology_offsets[topo] + 1 + id;
+            if (slot_entries[slot] == 0) continue;
+
+            const char* tag_name = jet_topo ? tags->jet_tag_name(id) : tags->event_tag_name(id);
+            write_slot(slot_bins[slot], slot_entries[slot], name + "_" + tag_name + topology_suffixes[topo]);
+        }
+    }
+}
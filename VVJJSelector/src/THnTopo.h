@@ -0,0 +1,110 @@
+#ifndef THnTopo_h
+#define THnTopo_h
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include <Rtypes.h>
+
+#include "TagRegistry.h"
+#include "TH1Topo.h"
+#include "THnTopoStore.h"
+
+// One fixed-bin axis of a THnTopo.
+struct THnAxis {
+    std::string var_name;
+    float x_min;
+    float x_max;
+    float bin_spacing;
+};
+
+// The N-dimensional counterpart of TH1Topo: a family of fixed-bin histograms
+// of several variables, split by jet/event flavor topology and by jet/event
+// tag in the same way.
+//
+// The bins live in a THnTopoStore, keyed [topology][tag][bin] with the
+// untagged histogram in tag slot 0, so only the bins that are filled take
+// any memory however many tags are booked. Each slot holds (sumw, sumw2)
+// for every bin, including underflow and overflow, and its number of
+// entries. Histograms are only created in write_all_histograms(), and only
+// for slots that were ever filled: a TH2F for two axes, a THnSparseD
+// otherwise.
+class THnTopo {
+    public:
+        static const UInt_t MAX_DIMENSIONS = 8;
+
+    private:
+        enum Topology {
+            TopoInclusive,
+            TopoQuark,
+            TopoGluon,
+            TopoQuarkQuark,
+            TopoQuarkGluon,
+            TopoGluonGluon,
+            NUM_TOPOLOGIES
+        };
+
+        THnTopoStore* store;      //!
+        const TagRegistry* tags;  //!
+        ULong64_t store_offset;   //!
+
+        // the bins of a slot, followed by its entries key
+        ULong64_t slot_size;  //!
+
+        // first slot of each topology
+        std::array<ULong64_t, NUM_TOPOLOGIES> topology_offsets;  //!
+        std::array<UInt_t, NUM_TOPOLOGIES> topology_num_tags;   //!
+
+        // number of bins and key stride of each axis, with the first axis
+        // varying fastest (as in the global bin number of a TH2F)
+        std::vector<int> num_bins;
+        std::vector<ULong64_t> strides;
+
+        ULong64_t find_bin(const Double_t* vals) const;
+
+        ULong64_t slot_key(Topology topo, UInt_t tag_slot) const {
+            return store_offset + (topology_offsets[topo] + tag_slot) * slot_size;
+        }
+
+        void fill_slot(ULong64_t slot, ULong64_t bin, double w) {
+            THnTopoStore::Bin& b = store->bin(slot + bin);
+            b.sumw  += w;
+            b.sumw2 += w * w;
+
+            store->bin(slot + slot_size - 1).sumw += 1;
+        }
+
+        void fill_tagged(Topology topo, TagMask tags, const Double_t* vals, float weight);
+
+        void write_slot(const std::vector<THnTopoStore::Bin>& bins, Double_t entries,
+                const std::string& hist_name) const;
+
+    public:
+        // Untagged THnTopo (tagged_ = false) only fill the untagged histogram
+        // of each topology. Tagged ones are filled for every tag of tags_,
+        // which must outlive the THnTopo.
+        THnTopo(THnTopoStore* store_, const TagRegistry* tags_, std::string name_,
+                const std::vector<THnAxis>& axes_, bool tagged_ = true);
+
+        const std::string name;
+        const std::vector<THnAxis> axes;
+        const bool tagged;
+
+        // vals holds one value per axis
+        void fill_inclusive(const Double_t* vals, float weight);
+        void fill_inclusive_tagged(TagMask event_tags, const Double_t* vals, float weight);
+
+        void fill_event_topo(EventFlavorTopo event_topo, const Double_t* vals, float weight);
+        void fill_event_topo_tagged(EventFlavorTopo event_topo, TagMask event_tags,
+                const Double_t* vals, float weight);
+
+        void fill_jet_topo(JetTopo jet_topo, const Double_t* vals, float weight);
+        void fill_jet_topo_tagged(JetTopo jet_topo, TagMask jet_tags,
+                const Double_t* vals, float weight);
+
+        // named like the histograms of TH1Topo::write_all_histograms()
+        void write_all_histograms(void) const;
+};
+
+#endif // #ifdef THnTopo_h
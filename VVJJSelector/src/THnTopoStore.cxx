@@ -0,0 +1,103 @@
+#define THnTopoStore_cxx
+
+#include <cassert>
+
+#include "StateIO.h"
+#include "THnTopoStore.h"
+
+// the table starts at 2^INITIAL_BITS entries and doubles when half full
+static const int INITIAL_BITS = 12;
+
+THnTopoStore::THnTopoStore(void) :
+    table(1u << INITIAL_BITS, Bin {EMPTY_KEY, 0., 0.}),
+    size(0),
+    shift(64 - INITIAL_BITS),
+    num_keys(0)
+{ }
+
+ULong64_t
+THnTopoStore::allocate(ULong64_t num_bin_keys)
+{
+    const ULong64_t first = num_keys;
+    num_keys += num_bin_keys;
+
+    // EMPTY_KEY must never be a valid key
+    assert(num_keys < EMPTY_KEY);
+
+    return first;
+}
+
+void
+THnTopoStore::grow(void)
+{
+    std::vector<Bin> old_table(2 * table.size(), Bin {EMPTY_KEY, 0., 0.});
+    old_table.swap(table);
+    shift--;
+
+    for (auto const& b : old_table) {
+        if (b.key != EMPTY_KEY)
+            table[find_index(b.key)] = b;
+    }
+}
+
+void
+THnTopoStore::add(const THnTopoStore& other)
+{
+    // both stores must have been booked with the same sequence of THnTopo
+    assert(num_keys == other.num_keys);
+
+    for (auto const& b : other.table) {
+        if (b.key == EMPTY_KEY) continue;
+
+        Bin& dst = bin(b.key);
+        dst.sumw += b.sumw;
+        dst.sumw2 += b.sumw2;
+    }
+}
+
+void
+THnTopoStore::reset(void)
+{
+    for (auto& b : table) {
+        b = Bin {EMPTY_KEY, 0., 0.};
+    }
+
+    size = 0;
+}
+
+void
+THnTopoStore::write_state(std::ostream& out) const
+{
+    write_state_value(out, num_keys);
+    write_state_value<ULong64_t>(out, size);
+
+    for (auto const& b : table) {
+        if (b.key == EMPTY_KEY) continue;
+
+        write_state_value(out, b.key);
+        write_state_value(out, b.sumw);
+        write_state_value(out, b.sumw2);
+    }
+}
+
+bool
+THnTopoStore::add_state(std::istream& in)
+{
+    ULong64_t state_num_keys, state_size;
+    if (!read_state_value(in, state_num_keys) || state_num_keys != num_keys
+            || !read_state_value(in, state_size))
+        return false;
+
+    for (ULong64_t i = 0; i < state_size; i++) {
+        Bin b;
+        if (!read_state_value(in, b.key) || !read_state_value(in, b.sumw)
+                || !read_state_value(in, b.sumw2) || b.key >= num_keys)
+            return false;
+
+        Bin& dst = bin(b.key);
+        dst.sumw += b.sumw;
+        dst.sumw2 += b.sumw2;
+    }
+
+    return true;
+}
@@ -0,0 +1,92 @@
+#ifndef THnTopoStore_h
+#define THnTopoStore_h
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include <Rtypes.h>
+
+// The sparse counterpart of TH1TopoStore, backing the bins of every THnTopo
+// booked by a selector. Each THnTopo reserves a range of bin keys when it is
+// constructed, but only the bins that are actually filled take any memory:
+// they live in one open-addressing hash table of (key, sumw, sumw2) entries.
+//
+// Merging two selectors adds the filled bins of one store into the other.
+class THnTopoStore {
+    public:
+        struct Bin {
+            ULong64_t key;
+            Double_t sumw;
+            Double_t sumw2;
+        };
+
+    private:
+        static const ULong64_t EMPTY_KEY = ~0ULL;
+
+        std::vector<Bin> table;
+        size_t size;
+        int shift;
+
+        ULong64_t num_keys;
+
+        size_t find_index(ULong64_t key) const {
+            // Fibonacci hashing, then linear probing
+            size_t index = (key * 11400714819323198485ULL) >> shift;
+            while (table[index].key != key && table[index].key != EMPTY_KEY)
+                index = (index + 1) & (table.size() - 1);
+
+            return index;
+        }
+
+        void grow(void);
+
+    public:
+        THnTopoStore(void);
+
+        THnTopoStore(const THnTopoStore&) = delete;
+        THnTopoStore& operator=(const THnTopoStore&) = delete;
+
+        // reserve a range of num_bin_keys keys, returns the first one
+        ULong64_t allocate(ULong64_t num_bin_keys);
+
+        // the bin of key, inserted empty if it was never filled
+        Bin& bin(ULong64_t key) {
+            size_t index = find_index(key);
+            if (table[index].key == key) return table[index];
+
+            // keep the table at most half full
+            if (2 * (size + 1) > table.size()) {
+                grow();
+                index = find_index(key);
+            }
+
+            table[index].key = key;
+            size++;
+            return table[index];
+        }
+
+        // the number of bins filled
+        size_t get_size(void) const { return size; }
+
+        // call f(const Bin&) for every filled bin with first <= key < last,
+        // in no particular order
+        template <class F>
+        void for_each_bin(ULong64_t first, ULong64_t last, F f) const {
+            for (auto const& b : table) {
+                if (b.key != EMPTY_KEY && b.key >= first && b.key < last)
+                    f(b);
+            }
+        }
+
+        void add(const THnTopoStore& other);
+        void reset(void);
+
+        // write the filled bins, or add bins written by a store with the
+        // same layout (returns false if the layout doesn't match)
+        void write_state(std::ostream& out) const;
+        bool add_state(std::istream& in);
+};
+
+#endif // #ifdef THnTopoStore_h
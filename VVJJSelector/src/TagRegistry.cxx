@@ -0,0 +1,41 @@
+#define TagRegistry_cxx
+
+#include "TagRegistry.h"
+
+bool
+TagRegistry::add_jet_tag(const std::string& name, UInt_t required_components)
+{
+    if (jet_tags.size() >= MAX_TAGS)
+        return false;
+
+    for (auto const& tag : jet_tags) {
+        if (tag.name == name) return false;
+    }
+
+    JetTagDef tag;
+    tag.name = name;
+    tag.required_components = required_components;
+    jet_tags.push_back(tag);
+
+    return true;
+}
+
+bool
+TagRegistry::add_event_tag(const std::string& name, UInt_t first_jet_required_components,
+        UInt_t second_jet_required_components)
+{
+    if (event_tags.size() >= MAX_TAGS)
+        return false;
+
+    for (auto const& tag : event_tags) {
+        if (tag.name == name) return false;
+    }
+
+    EventTagDef tag;
+    tag.name = name;
+    tag.first_jet_required_components = first_jet_required_components;
+    tag.second_jet_required_components = second_jet_required_components;
+    event_tags.push_back(tag);
+
+    return true;
+}
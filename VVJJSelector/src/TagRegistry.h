@@ -0,0 +1,101 @@
+#ifndef TagRegistry_h
+#define TagRegistry_h
+
+#include <string>
+#include <vector>
+
+#include <Rtypes.h>
+
+// A set of tags, one bit per tag id. Jet and event tag ids are the indices
+// of the tags in their TagRegistry.
+typedef UInt_t TagMask;
+
+// The individual W/Z boson-tagging requirements a large-R jet can pass.
+enum JetTagComponent : UInt_t {
+    PassNtrk   = 1u << 0,
+    PassWMass  = 1u << 1,
+    PassWD2    = 1u << 2,
+    PassZMass  = 1u << 3,
+    PassZD2    = 1u << 4
+};
+
+inline UInt_t
+jet_tag_components(bool passed_ntrk, bool passed_W_mass, bool passed_W_D2,
+        bool passed_Z_mass, bool passed_Z_D2)
+{
+    return (passed_ntrk   ? PassNtrk  : 0u)
+         | (passed_W_mass ? PassWMass : 0u)
+         | (passed_W_D2   ? PassWD2   : 0u)
+         | (passed_Z_mass ? PassZMass : 0u)
+         | (passed_Z_D2   ? PassZD2   : 0u);
+}
+
+// The jet and event tags histograms are filled for, as loaded from a
+// SelectionConfig.
+//
+// A jet tag is passed when the jet passes all of its required components.
+// An event tag is passed when the leading (first) and subleading (second)
+// jets each pass their required components.
+class TagRegistry {
+    public:
+        static const UInt_t MAX_TAGS = 8 * sizeof(TagMask);
+
+        struct JetTagDef {
+            std::string name;
+            UInt_t required_components;
+        };
+
+        struct EventTagDef {
+            std::string name;
+            UInt_t first_jet_required_components;
+            UInt_t second_jet_required_components;
+        };
+
+    private:
+        std::vector<JetTagDef> jet_tags;
+        std::vector<EventTagDef> event_tags;
+
+    public:
+        // both return false if there are already MAX_TAGS tags or a tag of
+        // the same name
+        bool add_jet_tag(const std::string& name, UInt_t required_components);
+        bool add_event_tag(const std::string& name, UInt_t first_jet_required_components,
+                UInt_t second_jet_required_components);
+
+        UInt_t num_jet_tags(void) const { return jet_tags.size(); }
+        UInt_t num_event_tags(void) const { return event_tags.size(); }
+
+        const JetTagDef& jet_tag(UInt_t id) const { return jet_tags[id]; }
+        const EventTagDef& event_tag(UInt_t id) const { return event_tags[id]; }
+
+        const char* jet_tag_name(UInt_t id) const { return jet_tags[id].name.c_str(); }
+        const char* event_tag_name(UInt_t id) const { return event_tags[id].name.c_str(); }
+
+        TagMask compute_jet_tags(UInt_t components) const {
+            TagMask tags = 0;
+
+            for (UInt_t id = 0; id < jet_tags.size(); id++) {
+                const UInt_t required = jet_tags[id].required_components;
+                if ((components & required) == required)
+                    tags |= 1u << id;
+            }
+
+            return tags;
+        }
+
+        TagMask compute_event_tags(UInt_t first_jet_components, UInt_t second_jet_components) const {
+            TagMask tags = 0;
+
+            for (UInt_t id = 0; id < event_tags.size(); id++) {
+                const UInt_t first_required = event_tags[id].first_jet_required_components;
+                const UInt_t second_required = event_tags[id].second_jet_required_components;
+                if ((first_jet_components & first_required) == first_required
+                        && (second_jet_components & second_required) == second_required)
+                    tags |= 1u << id;
+            }
+
+            return tags;
+        }
+};
+
+#endif // #ifdef TagRegistry_h
@@ -1,28 +1,42 @@
 #define VVJJFlavorSelector_cxx
 
 #include "VVJJFlavorSelector.h"
+#include "BlockReader.h"
+#include "StateIO.h"
 
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <sstream>
 
+#include <Compression.h>
 #include <TH1F.h>
+#include <TMemFile.h>
 #include <TStyle.h>
 #include <TSelector.h>
 
-VVJJFlavorSelector::VVJJFlavorSelector(std::string output_path_) :
+VVJJFlavorSelector::VVJJFlavorSelector(std::string output_path_, const SelectionConfig* config_) :
     fChain(0),
     output_path(output_path_),
+    output_writer(nullptr),
+    config(config_),
+    print_progress(kTRUE),
     num_entries_processed(0),
-    next_print_percent(0.0),
-    sum_weights_total(0),
-    sum_weights_baseline_selection(0),
-    sum_weights_qq(0),
-    sum_weights_qg(0),
-    sum_weights_gg(0),
-    sum_weights_qg_firstjet_quark(0),
-    sum_weights_qg_firstjet_gluon(0),
-    sum_weights_non_quark_gluon_rejections(0)
-{ }
+    num_entries_total(0),
+    num_entries_resumed(0),
+    input_skimmed(kFALSE),
+    sum_weights_skimmed(0),
+    skim_cache(nullptr),
+    checkpointer(nullptr),
+    prune_unused_branches(kTRUE),
+    lazy_branches(kFALSE),
+    efficiency_interval(EfficiencyInterval::ClopperPearson)
+{
+#define VVJJ_COLUMN_VALUE(name) column_values[COL_##name] = &name; column_branches[COL_##name] = &b_##name;
+    VVJJ_EVENT_COLUMNS(VVJJ_COLUMN_VALUE)
+#undef VVJJ_COLUMN_VALUE
+}
 
 void VVJJFlavorSelector::Begin(TTree * /*tree*/)
 {
@@ -30,25 +44,32 @@ void VVJJFlavorSelector::Begin(TTree * /*tree*/)
     // When running with PROOF Begin() is only called on the client.
     // The tree argument is deprecated (on PROOF 0 is passed).
 
-    h_first_jet_pt  = make_unique<TH1Topo>("first_jet_pt"  , 0. , 4000. , 100);
-    h_second_jet_pt = make_unique<TH1Topo>("second_jet_pt" , 0. , 4000. , 100);
-
-    h_first_jet_eta  = make_unique<TH1Topo>("first_jet_eta"  , -2.5 , 2.5 , 0.2);
-    h_second_jet_eta = make_unique<TH1Topo>("second_jet_eta" , -2.5 , 2.5 , 0.2);
+    run_stats.start();
 
-    h_first_jet_phi  = make_unique<TH1Topo>("first_jet_phi"  , -3.2 , 3.2 , 0.2);
-    h_second_jet_phi = make_unique<TH1Topo>("second_jet_phi" , -3.2 , 3.2 , 0.2);
+    hist_store = make_unique<TH1TopoStore>();
+    sparse_hist_store = make_unique<THnTopoStore>();
+    const TagRegistry* tags = &config->get_tags();
 
-    h_first_jet_m  = make_unique<TH1Topo>("first_jet_m"  , 0. , 400. , 10.0);
-    h_second_jet_m = make_unique<TH1Topo>("second_jet_m" , 0. , 400. , 10.0);
+    hist_sets.clear();
+    const std::vector<Cut>& cuts = config->get_cuts();
 
-    h_first_jet_D2  = make_unique<TH1Topo>("first_jet_D2"  , 0. , 5. , 0.2);
-    h_second_jet_D2 = make_unique<TH1Topo>("second_jet_D2" , 0. , 5. , 0.2);
+    hist_sets.push_back(make_unique<HistogramSet>("nominal", hist_store.get(), sparse_hist_store.get(),
+            tags, cuts));
 
-    h_first_jet_ungNtrk  = make_unique<TH1Topo>("first_jet_ntrk"  , 0. , 100. , 2.0);
-    h_second_jet_ungNtrk = make_unique<TH1Topo>("second_jet_ntrk" , 0. , 100. , 2.0);
+    for (auto const& variation : config->get_variations()) {
+        hist_sets.push_back(make_unique<HistogramSet>(variation.name, hist_store.get(),
+                    sparse_hist_store.get(), tags, cuts));
+    }
 
-    h_dijet_mass = make_unique<TH1Topo>("dijet_mass" , 0. , 8000. , 100);
+    // a checkpoint already includes the weight left out of the skim cache
+    if (checkpointer && checkpointer->resuming()) {
+        if (!checkpointer->restore(*this))
+            Abort("failed to restore the checkpoint");
+        num_entries_resumed = num_entries_processed;
+    } else if (input_skimmed) {
+        hist_sets[0]->sum_weights_total = sum_weights_skimmed;
+        hist_sets[0]->cut_flow->fill_unevaluated(sum_weights_skimmed);
+    }
 
     TString option = GetOption();
 }
@@ -83,16 +104,40 @@ Bool_t VVJJFlavorSelector::Process(Long64_t entry)
     //
     // The return value is currently not used.
 
+    // every entry before this one has been fully processed
+    if (checkpointer && num_entries_processed % 4096 == 0 && checkpointer->due())
+        checkpointer->snapshot(*this, num_entries_processed);
+
     num_entries_processed++;
 
-    double percent_done = 100 * (float) num_entries_processed / (float) this->fChain->GetEntries();
-    if (percent_done >= next_print_percent) {
-        std::cout << next_print_percent << "%..." << std::flush;
-        if (percent_done == 100.0) {
-            std::cout << "DONE." << std::endl;
-        } else {
-            next_print_percent += 10.0;
+    if (progress && num_entries_processed % 4096 == 0)
+        progress->update(num_entries_processed);
+
+    const RunClock::time_point read_start = RunStats::now();
+
+    if (lazy_reader) {
+        // a rejected event costs only the columns of the cuts up to the one it failed
+        const Int_t failed_cut = lazy_reader->read_selection(entry, column_values);
+        if (failed_cut < 0)
+            lazy_reader->read_rest(entry);
+
+        run_stats.lap(PhaseIO, read_start);
+
+        if (prune_unused_branches && num_entries_processed - num_entries_resumed == BRANCH_WARMUP_ENTRIES)
+            activate_used_branches();
+
+        if (failed_cut >= 0) {
+            HistogramSet& hists = *hist_sets[0];
+            const float full_weight = weight * pileup_weight;
+
+            hists.sum_weights_total += full_weight;
+            hists.cut_flow->fill_unevaluated(full_weight);
+            if (skim_cache) skim_cache->reject(full_weight);
+
+            return kFALSE;
         }
+
+        return process_event();
     }
 
     b_weight->GetEntry(entry);
@@ -132,25 +177,182 @@ Bool_t VVJJFlavorSelector::Process(Long64_t entry)
     b_jet1_ungrtrk500->GetEntry(entry);
     b_jet2_ungrtrk500->GetEntry(entry);
 
+    run_stats.lap(PhaseIO, read_start);
+
+    if (prune_unused_branches && num_entries_processed - num_entries_resumed == BRANCH_WARMUP_ENTRIES)
+        activate_used_branches();
+
+    return process_event();
+}
+
+void VVJJFlavorSelector::ProcessBatch(const EventBlock& block)
+{
+    // Process a block of consecutive events that were already read into
+    // structure-of-arrays columns (see BlockReader). The baseline selection
+    // is evaluated for the whole block at once, first on the nominal columns
+    // and then on those of each variation, then each surviving event goes
+    // through exactly the same code as in Process().
+
+    if (block_survivors.size() < block.size) {
+        block_survivors.resize(block.size);
+        block_first_jet_flavors.resize(block.size);
+        block_second_jet_flavors.resize(block.size);
+        block_failed_cuts.resize(block.size);
+    }
+
+    for (size_t set = 0; set < hist_sets.size(); set++) {
+        HistogramSet& hists = *hist_sets[set];
+
+        const RunClock::time_point select_start = RunStats::now();
+
+        EventBlock varied;
+        const EventBlock& b = set == 0 ? block : vary_block(config->get_variations()[set - 1], block, varied);
+
+        const size_t num_survivors = select_baseline(config->get_program(), b, block_survivors.data(),
+                block_first_jet_flavors.data(), block_second_jet_flavors.data(), block_failed_cuts.data());
+
+        const Double_t* columns[NUM_EVENT_COLUMNS];
+        for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+            columns[col] = b.column(static_cast<EventColumn>(col));
+        }
+
+        for (size_t i = 0; i < b.size; i++) {
+            const float full_weight = b.weight[i] * b.pileup_weight[i];
+            hists.sum_weights_total += full_weight;
+            hists.cut_flow->fill(block_failed_cuts[i], full_weight, columns, i);
+        }
+
+        run_stats.lap(PhaseSelection, select_start);
+
+        for (size_t k = 0; k < num_survivors; k++) {
+            const size_t i = block_survivors[k];
+
+#define VVJJ_LOAD_COLUMN(name) name = b.name[i];
+            VVJJ_EVENT_COLUMNS(VVJJ_LOAD_COLUMN)
+#undef VVJJ_LOAD_COLUMN
+
+            const float full_weight = weight * pileup_weight;
+            process_baseline_event(hists, full_weight, block_first_jet_flavors[k], block_second_jet_flavors[k]);
+        }
+    }
+
+    num_entries_processed += block.size;
+}
+
+const EventBlock& VVJJFlavorSelector::vary_block(const Variation& variation, const EventBlock& block,
+        EventBlock& varied)
+{
+    // Make varied a view of block with the variation applied. Only the
+    // columns the variation changes are copied (to block_varied_columns),
+    // the others are shared with block. The view is valid until the next
+    // call.
+
+    varied = block;
+
+    if (block_varied_columns.size() < variation.ops.size() * block.size)
+        block_varied_columns.resize(variation.ops.size() * block.size);
+
+    Double_t* copies[NUM_EVENT_COLUMNS] = { };
+    size_t num_copies = 0;
+
+    for (auto const& op : variation.ops) {
+        Double_t*& values = copies[op.column];
+        const Double_t* original = values != nullptr ? values : block.column(op.column);
+
+        if (values == nullptr) {
+            values = block_varied_columns.data() + num_copies++ * block.size;
+            varied.set_column(op.column, values);
+        }
+
+        if (op.scale) {
+            for (size_t i = 0; i < block.size; i++)
+                values[i] = original[i] * op.value;
+        } else {
+            for (size_t i = 0; i < block.size; i++)
+                values[i] = op.value;
+        }
+    }
+
+    return varied;
+}
+
+Bool_t VVJJFlavorSelector::process_event(void)
+{
+    // Apply the event selection and fill the histograms, using the leaf
+    // values currently loaded into the member variables.
+
+    for (size_t set = 1; set < hist_sets.size(); set++) {
+        process_varied_event(config->get_variations()[set - 1], *hist_sets[set]);
+    }
+
+    HistogramSet& hists = *hist_sets[0];
     const float full_weight = weight * pileup_weight;
 
     /****************************/
     /* BASELINE EVENT SELECTION */
     /****************************/
 
-    sum_weights_total += full_weight;
+    hists.sum_weights_total += full_weight;
+
+    const RunClock::time_point select_start = RunStats::now();
+    const CutMask failed = config->get_program().failed_cuts(column_values);
+    hists.cut_flow->fill(failed, full_weight, column_values, 0);
+    run_stats.lap(PhaseSelection, select_start);
+
+    if (failed != 0) {
+        if (skim_cache) skim_cache->reject(full_weight);
+        return kFALSE;
+    }
+
+    if (skim_cache) skim_cache->fill();
+
+    return process_baseline_event(hists, full_weight,
+            classify_jet_flavor(first_jet_pdgid), classify_jet_flavor(second_jet_pdgid));
+}
+
+Bool_t VVJJFlavorSelector::process_varied_event(const Variation& variation, HistogramSet& hists)
+{
+    // Same as process_event() for the histograms of a variation: the
+    // variation is applied to the member variables, which are restored
+    // once the event has been filled.
+
+    Double_t nominal_values[NUM_EVENT_COLUMNS];
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        nominal_values[col] = *column_values[col];
+    }
+
+    for (auto const& op : variation.ops) {
+        Double_t& value = *column_values[op.column];
+        value = op.scale ? value * op.value : op.value;
+    }
+
+    const float full_weight = weight * pileup_weight;
+    hists.sum_weights_total += full_weight;
+
+    const RunClock::time_point select_start = RunStats::now();
+    const CutMask failed = config->get_program().failed_cuts(column_values);
+    hists.cut_flow->fill(failed, full_weight, column_values, 0);
+    run_stats.lap(PhaseSelection, select_start);
+
+    const Bool_t filled = failed == 0 && process_baseline_event(hists, full_weight,
+            classify_jet_flavor(first_jet_pdgid), classify_jet_flavor(second_jet_pdgid));
+
+    for (int col = 0; col < NUM_EVENT_COLUMNS; col++) {
+        *column_values[col] = nominal_values[col];
+    }
+
+    return filled;
+}
 
-    if (first_jet_pt / 1000. <= 450
-            || first_jet_m / 1000. <= 50
-            || second_jet_m / 1000. <= 50
-            || std::abs(first_jet_eta) >= 2.0
-            || std::abs(second_jet_eta) >= 2.0
-            || dijet_mass_massordered / 1000 <= 1000
-            || std::abs(dyjj) >= 1.2
-            || std::abs(ptasym) >= 0.15
-            ) return kFALSE;
+Bool_t VVJJFlavorSelector::process_baseline_event(HistogramSet& hists, float full_weight,
+        JetFlavor first_jet_flavor, JetFlavor second_jet_flavor)
+{
+    // Classify and fill the histograms for an event that passed the baseline
+    // selection, using the leaf values currently loaded into the members.
+
+    const RunClock::time_point tag_start = RunStats::now();
 
-    sum_weights_baseline_selection += full_weight;
+    hists.sum_weights_baseline_selection += full_weight;
 
     /***************************/
     /* COMPUTE EXTRA VARIABLES */
@@ -166,8 +368,8 @@ Bool_t VVJJFlavorSelector::Process(Long64_t entry)
         second_jet_ungNtrk = jet1_ungrtrk500;
     }
 
-    const bool first_jet_passedNtrk = first_jet_ungNtrk < 30;
-    const bool second_jet_passedNtrk = second_jet_ungNtrk < 30;
+    const bool first_jet_passedNtrk = first_jet_ungNtrk < config->get_ntrk_max();
+    const bool second_jet_passedNtrk = second_jet_ungNtrk < config->get_ntrk_max();
 
     /***************************************/
     /* DETERMINE EVENT/JET TOPOLOGIES/TAGS */
@@ -177,179 +379,181 @@ Bool_t VVJJFlavorSelector::Process(Long64_t entry)
     JetTopo second_jet_topo;
     EventFlavorTopo event_topo;
 
-    if (first_jet_pdgid >= 1 && first_jet_pdgid <= 6) {
+    if (first_jet_flavor == FlavorQuark) {
         first_jet_topo = JetTopo::Quark;
-    } else if (first_jet_pdgid == 21) {
+    } else if (first_jet_flavor == FlavorGluon) {
         first_jet_topo = JetTopo::Gluon;
     } else {
-        sum_weights_non_quark_gluon_rejections += full_weight;
+        hists.sum_weights_non_quark_gluon_rejections += full_weight;
         return kFALSE;
     }
 
-    if (second_jet_pdgid >= 1 && second_jet_pdgid <= 6) {
+    if (second_jet_flavor == FlavorQuark) {
         second_jet_topo = JetTopo::Quark;
-    } else if (second_jet_pdgid == 21) {
+    } else if (second_jet_flavor == FlavorGluon) {
         second_jet_topo = JetTopo::Gluon;
     } else {
-        sum_weights_non_quark_gluon_rejections += full_weight;
+        hists.sum_weights_non_quark_gluon_rejections += full_weight;
         return kFALSE;
     }
 
     if (first_jet_topo == JetTopo::Quark && second_jet_topo == JetTopo::Quark) {
         event_topo = EventFlavorTopo::QuarkQuark;
-        sum_weights_qq += full_weight;
+        hists.sum_weights_qq += full_weight;
     } else if (first_jet_topo == JetTopo::Quark && second_jet_topo == JetTopo::Gluon) {
         event_topo = EventFlavorTopo::QuarkGluon;
-        sum_weights_qg += full_weight;
+        hists.sum_weights_qg += full_weight;
     } else if (first_jet_topo == JetTopo::Gluon && second_jet_topo == JetTopo::Quark) {
         event_topo = EventFlavorTopo::QuarkGluon;
-        sum_weights_qg += full_weight;
+        hists.sum_weights_qg += full_weight;
     } else {
         assert(first_jet_topo == JetTopo::Gluon && second_jet_topo == JetTopo::Gluon);
         event_topo = EventFlavorTopo::GluonGluon;
-        sum_weights_gg += full_weight;
+        hists.sum_weights_gg += full_weight;
     }
 
     if (event_topo == EventFlavorTopo::QuarkGluon) {
         if (first_jet_topo == JetTopo::Quark) {
-            sum_weights_qg_firstjet_quark += full_weight;
+            hists.sum_weights_qg_firstjet_quark += full_weight;
         } else {
             assert(first_jet_topo == JetTopo::Gluon);
-            sum_weights_qg_firstjet_gluon += full_weight;
+            hists.sum_weights_qg_firstjet_gluon += full_weight;
         }
     }
 
-    first_jet_tag_map["partial_ntrk"]       = first_jet_passedNtrk;
-
-    first_jet_tag_map["W_partial_mass"]     = first_jet_passedWMassCut;
-    first_jet_tag_map["W_partial_D2"]       = first_jet_passedWSubstructure;
-    first_jet_tag_map["W_partial_massD2"]   = first_jet_passedWSubstructure  && first_jet_passedWMassCut;
-    first_jet_tag_map["W_partial_massNtrk"] = first_jet_passedWMassCut       && first_jet_passedNtrk;
-    first_jet_tag_map["W_partial_ntrkD2"]   = first_jet_passedWSubstructure  && first_jet_passedNtrk;
-    first_jet_tag_map["W_full"]             = first_jet_passedWSubstructure  && first_jet_passedWMassCut  && first_jet_passedNtrk;
-
-    first_jet_tag_map["Z_partial_mass"]     = first_jet_passedZMassCut;
-    first_jet_tag_map["Z_partial_D2"]       = first_jet_passedZSubstructure;
-    first_jet_tag_map["Z_partial_massD2"]   = first_jet_passedZSubstructure  && first_jet_passedZMassCut;
-    first_jet_tag_map["Z_partial_massNtrk"] = first_jet_passedZMassCut       && first_jet_passedNtrk;
-    first_jet_tag_map["Z_partial_ntrkD2"]   = first_jet_passedZSubstructure  && first_jet_passedNtrk;
-    first_jet_tag_map["Z_full"]             = first_jet_passedZSubstructure  && first_jet_passedZMassCut  && first_jet_passedNtrk;
-
-    second_jet_tag_map["partial_ntrk"]       = second_jet_passedNtrk;
-
-    second_jet_tag_map["W_partial_mass"]     = second_jet_passedWMassCut;
-    second_jet_tag_map["W_partial_D2"]       = second_jet_passedWSubstructure;
-    second_jet_tag_map["W_partial_massD2"]   = second_jet_passedWSubstructure  && second_jet_passedWMassCut;
-    second_jet_tag_map["W_partial_massNtrk"] = second_jet_passedWMassCut       && second_jet_passedNtrk;
-    second_jet_tag_map["W_partial_ntrkD2"]   = second_jet_passedWSubstructure  && second_jet_passedNtrk;
-    second_jet_tag_map["W_full"]             = second_jet_passedWSubstructure  && second_jet_passedWMassCut  && second_jet_passedNtrk;
-
-    second_jet_tag_map["Z_partial_mass"]     = second_jet_passedZMassCut;
-    second_jet_tag_map["Z_partial_D2"]       = second_jet_passedZSubstructure;
-    second_jet_tag_map["Z_partial_massD2"]   = second_jet_passedZSubstructure  && second_jet_passedZMassCut;
-    second_jet_tag_map["Z_partial_massNtrk"] = second_jet_passedZMassCut       && second_jet_passedNtrk;
-    second_jet_tag_map["Z_partial_ntrkD2"]   = second_jet_passedZSubstructure  && second_jet_passedNtrk;
-    second_jet_tag_map["Z_full"]             = second_jet_passedZSubstructure  && second_jet_passedZMassCut  && second_jet_passedNtrk;
-
-    event_tag_map["partial_ntrk"] = first_jet_passedNtrk && second_jet_passedNtrk;
-
-    event_tag_map["WW_partial_mass"]     = first_jet_tag_map["W_partial_mass"]     && second_jet_tag_map["W_partial_mass"];
-    event_tag_map["WW_partial_D2"]       = first_jet_tag_map["W_partial_D2"]       && second_jet_tag_map["W_partial_D2"];
-    event_tag_map["WW_partial_massD2"]   = first_jet_tag_map["W_partial_massD2"]   && second_jet_tag_map["W_partial_massD2"];
-    event_tag_map["WW_partial_massNtrk"] = first_jet_tag_map["W_partial_massNtrk"] && second_jet_tag_map["W_partial_massNtrk"];
-    event_tag_map["WW_partial_ntrkD2"]   = first_jet_tag_map["W_partial_ntrkD2"]   && second_jet_tag_map["W_partial_ntrkD2"];
-    event_tag_map["WW_full"]             = first_jet_tag_map["W_full"]             && second_jet_tag_map["W_full"];
-
-    event_tag_map["WZ_partial_mass"]     = first_jet_tag_map["Z_partial_mass"]     && second_jet_tag_map["W_partial_mass"];
-    event_tag_map["WZ_partial_D2"]       = first_jet_tag_map["Z_partial_D2"]       && second_jet_tag_map["W_partial_D2"];
-    event_tag_map["WZ_partial_massD2"]   = first_jet_tag_map["Z_partial_massD2"]   && second_jet_tag_map["W_partial_massD2"];
-    event_tag_map["WZ_partial_massNtrk"] = first_jet_tag_map["Z_partial_massNtrk"] && second_jet_tag_map["W_partial_massNtrk"];
-    event_tag_map["WZ_partial_ntrkD2"]   = first_jet_tag_map["Z_partial_ntrkD2"]   && second_jet_tag_map["W_partial_ntrkD2"];
-    event_tag_map["WZ_full"]             = first_jet_tag_map["Z_full"]             && second_jet_tag_map["W_full"];
-
-    event_tag_map["ZZ_partial_mass"]     = first_jet_tag_map["Z_partial_mass"]     && second_jet_tag_map["Z_partial_mass"];
-    event_tag_map["ZZ_partial_D2"]       = first_jet_tag_map["Z_partial_D2"]       && second_jet_tag_map["Z_partial_D2"];
-    event_tag_map["ZZ_partial_massD2"]   = first_jet_tag_map["Z_partial_massD2"]   && second_jet_tag_map["Z_partial_massD2"];
-    event_tag_map["ZZ_partial_massNtrk"] = first_jet_tag_map["Z_partial_massNtrk"] && second_jet_tag_map["Z_partial_massNtrk"];
-    event_tag_map["ZZ_partial_ntrkD2"]   = first_jet_tag_map["Z_partial_ntrkD2"]   && second_jet_tag_map["Z_partial_ntrkD2"];
-    event_tag_map["ZZ_full"]             = first_jet_tag_map["Z_full"]             && second_jet_tag_map["Z_full"];
+    const UInt_t first_jet_components = jet_tag_components(first_jet_passedNtrk,
+            first_jet_passedWMassCut, first_jet_passedWSubstructure,
+            first_jet_passedZMassCut, first_jet_passedZSubstructure);
+
+    const UInt_t second_jet_components = jet_tag_components(second_jet_passedNtrk,
+            second_jet_passedWMassCut, second_jet_passedWSubstructure,
+            second_jet_passedZMassCut, second_jet_passedZSubstructure);
+
+    const TagRegistry& tags = config->get_tags();
+    const TagMask first_jet_tags = tags.compute_jet_tags(first_jet_components);
+    const TagMask second_jet_tags = tags.compute_jet_tags(second_jet_components);
+    const TagMask event_tags = tags.compute_event_tags(first_jet_components, second_jet_components);
+
+    const RunClock::time_point fill_start = run_stats.lap(PhaseTagging, tag_start);
 
     /****************************/
     /* FILL UNTAGGED HISTOGRAMS */
     /****************************/
 
-    h_dijet_mass->fill_inclusive(dijet_mass_massordered / 1000. , full_weight);
-    h_dijet_mass->fill_event_topo(event_topo, dijet_mass_massordered / 1000. , full_weight);
+    hists.h_dijet_mass->fill_inclusive(dijet_mass_massordered / 1000. , full_weight);
+    hists.h_dijet_mass->fill_event_topo(event_topo, dijet_mass_massordered / 1000. , full_weight);
 
-    h_first_jet_pt->fill_inclusive(first_jet_pt / 1000. , full_weight);
-    h_first_jet_pt->fill_event_topo(event_topo, first_jet_pt / 1000. , full_weight);
-    h_first_jet_pt->fill_jet_topo(first_jet_topo, first_jet_pt / 1000. , full_weight);
+    hists.h_first_jet_pt->fill_inclusive(first_jet_pt / 1000. , full_weight);
+    hists.h_first_jet_pt->fill_event_topo(event_topo, first_jet_pt / 1000. , full_weight);
+    hists.h_first_jet_pt->fill_jet_topo(first_jet_topo, first_jet_pt / 1000. , full_weight);
 
-    h_first_jet_eta->fill_inclusive(first_jet_eta, full_weight);
-    h_first_jet_eta->fill_event_topo(event_topo, first_jet_eta, full_weight);
-    h_first_jet_eta->fill_jet_topo(first_jet_topo, first_jet_eta, full_weight);
+    hists.h_first_jet_eta->fill_inclusive(first_jet_eta, full_weight);
+    hists.h_first_jet_eta->fill_event_topo(event_topo, first_jet_eta, full_weight);
+    hists.h_first_jet_eta->fill_jet_topo(first_jet_topo, first_jet_eta, full_weight);
 
-    h_first_jet_phi->fill_inclusive(first_jet_phi, full_weight);
-    h_first_jet_phi->fill_event_topo(event_topo, first_jet_phi, full_weight);
-    h_first_jet_phi->fill_jet_topo(first_jet_topo, first_jet_phi, full_weight);
+    hists.h_first_jet_phi->fill_inclusive(first_jet_phi, full_weight);
+    hists.h_first_jet_phi->fill_event_topo(event_topo, first_jet_phi, full_weight);
+    hists.h_first_jet_phi->fill_jet_topo(first_jet_topo, first_jet_phi, full_weight);
 
-    h_first_jet_m->fill_inclusive(first_jet_m / 1000., full_weight);
-    h_first_jet_m->fill_event_topo(event_topo, first_jet_m / 1000., full_weight);
-    h_first_jet_m->fill_jet_topo(first_jet_topo, first_jet_m / 1000., full_weight);
+    hists.h_first_jet_m->fill_inclusive(first_jet_m / 1000., full_weight);
+    hists.h_first_jet_m->fill_event_topo(event_topo, first_jet_m / 1000., full_weight);
+    hists.h_first_jet_m->fill_jet_topo(first_jet_topo, first_jet_m / 1000., full_weight);
 
-    h_first_jet_D2->fill_inclusive(first_jet_D2, full_weight);
-    h_first_jet_D2->fill_event_topo(event_topo, first_jet_D2, full_weight);
-    h_first_jet_D2->fill_jet_topo(first_jet_topo, first_jet_D2, full_weight);
+    hists.h_first_jet_D2->fill_inclusive(first_jet_D2, full_weight);
+    hists.h_first_jet_D2->fill_event_topo(event_topo, first_jet_D2, full_weight);
+    hists.h_first_jet_D2->fill_jet_topo(first_jet_topo, first_jet_D2, full_weight);
 
-    h_first_jet_ungNtrk->fill_inclusive(first_jet_ungNtrk, full_weight);
-    h_first_jet_ungNtrk->fill_event_topo(event_topo, first_jet_ungNtrk, full_weight);
-    h_first_jet_ungNtrk->fill_jet_topo(first_jet_topo, first_jet_ungNtrk, full_weight);
+    hists.h_first_jet_ungNtrk->fill_inclusive(first_jet_ungNtrk, full_weight);
+    hists.h_first_jet_ungNtrk->fill_event_topo(event_topo, first_jet_ungNtrk, full_weight);
+    hists.h_first_jet_ungNtrk->fill_jet_topo(first_jet_topo, first_jet_ungNtrk, full_weight);
 
-    h_second_jet_pt->fill_inclusive(second_jet_pt / 1000. , full_weight);
-    h_second_jet_pt->fill_event_topo(event_topo, second_jet_pt / 1000. , full_weight);
-    h_second_jet_pt->fill_jet_topo(second_jet_topo, second_jet_pt / 1000. , full_weight);
+    hists.h_second_jet_pt->fill_inclusive(second_jet_pt / 1000. , full_weight);
+    hists.h_second_jet_pt->fill_event_topo(event_topo, second_jet_pt / 1000. , full_weight);
+    hists.h_second_jet_pt->fill_jet_topo(second_jet_topo, second_jet_pt / 1000. , full_weight);
 
-    h_second_jet_eta->fill_inclusive(second_jet_eta, full_weight);
-    h_second_jet_eta->fill_event_topo(event_topo, second_jet_eta, full_weight);
-    h_second_jet_eta->fill_jet_topo(second_jet_topo, second_jet_eta, full_weight);
+    hists.h_second_jet_eta->fill_inclusive(second_jet_eta, full_weight);
+    hists.h_second_jet_eta->fill_event_topo(event_topo, second_jet_eta, full_weight);
+    hists.h_second_jet_eta->fill_jet_topo(second_jet_topo, second_jet_eta, full_weight);
 
-    h_second_jet_phi->fill_inclusive(second_jet_phi, full_weight);
-    h_second_jet_phi->fill_event_topo(event_topo, second_jet_phi, full_weight);
-    h_second_jet_phi->fill_jet_topo(second_jet_topo, second_jet_phi, full_weight);
+    hists.h_second_jet_phi->fill_inclusive(second_jet_phi, full_weight);
+    hists.h_second_jet_phi->fill_event_topo(event_topo, second_jet_phi, full_weight);
+    hists.h_second_jet_phi->fill_jet_topo(second_jet_topo, second_jet_phi, full_weight);
 
-    h_second_jet_m->fill_inclusive(second_jet_m / 1000., full_weight);
-    h_second_jet_m->fill_event_topo(event_topo, second_jet_m / 1000., full_weight);
-    h_second_jet_m->fill_jet_topo(second_jet_topo, second_jet_m / 1000., full_weight);
+    hists.h_second_jet_m->fill_inclusive(second_jet_m / 1000., full_weight);
+    hists.h_second_jet_m->fill_event_topo(event_topo, second_jet_m / 1000., full_weight);
+    hists.h_second_jet_m->fill_jet_topo(second_jet_topo, second_jet_m / 1000., full_weight);
 
-    h_second_jet_D2->fill_inclusive(second_jet_D2, full_weight);
-    h_second_jet_D2->fill_event_topo(event_topo, second_jet_D2, full_weight);
-    h_second_jet_D2->fill_jet_topo(second_jet_topo, second_jet_D2, full_weight);
+    hists.h_second_jet_D2->fill_inclusive(second_jet_D2, full_weight);
+    hists.h_second_jet_D2->fill_event_topo(event_topo, second_jet_D2, full_weight);
+    hists.h_second_jet_D2->fill_jet_topo(second_jet_topo, second_jet_D2, full_weight);
 
-    h_second_jet_ungNtrk->fill_inclusive(second_jet_ungNtrk, full_weight);
-    h_second_jet_ungNtrk->fill_event_topo(event_topo, second_jet_ungNtrk, full_weight);
-    h_second_jet_ungNtrk->fill_jet_topo(second_jet_topo, second_jet_ungNtrk, full_weight);
+    hists.h_second_jet_ungNtrk->fill_inclusive(second_jet_ungNtrk, full_weight);
+    hists.h_second_jet_ungNtrk->fill_event_topo(event_topo, second_jet_ungNtrk, full_weight);
+    hists.h_second_jet_ungNtrk->fill_jet_topo(second_jet_topo, second_jet_ungNtrk, full_weight);
 
     /**************************/
     /* FILL TAGGED HISTOGRAMS */
     /**************************/
 
-    for (auto const& tag : event_tag_map) {
-        h_dijet_mass->fill_event_topo_tagged(event_topo, tag.first, tag.second, dijet_mass_massordered / 1000., full_weight);
-        h_first_jet_pt->fill_event_topo_tagged(event_topo, tag.first, tag.second, first_jet_pt / 1000., full_weight);
-        h_second_jet_pt->fill_event_topo_tagged(event_topo, tag.first, tag.second, second_jet_pt / 1000., full_weight);
-        h_first_jet_m->fill_event_topo_tagged(event_topo, tag.first, tag.second, first_jet_m / 1000., full_weight);
-        h_second_jet_m->fill_event_topo_tagged(event_topo, tag.first, tag.second, second_jet_m / 1000., full_weight);
-    }
-
-    for (auto const& tag : first_jet_tag_map) {
-        h_first_jet_pt->fill_jet_topo_tagged(first_jet_topo, tag.first, tag.second, first_jet_pt / 1000., full_weight);
-        h_first_jet_m->fill_jet_topo_tagged(first_jet_topo, tag.first, tag.second, first_jet_m / 1000., full_weight);
-    }
-
-    for (auto const& tag : second_jet_tag_map) {
-        h_second_jet_pt->fill_jet_topo_tagged(second_jet_topo, tag.first, tag.second, second_jet_pt / 1000., full_weight);
-        h_second_jet_m->fill_jet_topo_tagged(second_jet_topo, tag.first, tag.second, second_jet_m / 1000., full_weight);
-    }
+    hists.h_dijet_mass->fill_event_topo_tagged(event_topo, event_tags, dijet_mass_massordered / 1000., full_weight);
+    hists.h_first_jet_pt->fill_event_topo_tagged(event_topo, event_tags, first_jet_pt / 1000., full_weight);
+    hists.h_second_jet_pt->fill_event_topo_tagged(event_topo, event_tags, second_jet_pt / 1000., full_weight);
+    hists.h_first_jet_m->fill_event_topo_tagged(event_topo, event_tags, first_jet_m / 1000., full_weight);
+    hists.h_second_jet_m->fill_event_topo_tagged(event_topo, event_tags, second_jet_m / 1000., full_weight);
+
+    hists.h_first_jet_pt->fill_jet_topo_tagged(first_jet_topo, first_jet_tags, first_jet_pt / 1000., full_weight);
+    hists.h_first_jet_m->fill_jet_topo_tagged(first_jet_topo, first_jet_tags, first_jet_m / 1000., full_weight);
+
+    hists.h_second_jet_pt->fill_jet_topo_tagged(second_jet_topo, second_jet_tags, second_jet_pt / 1000., full_weight);
+    hists.h_second_jet_m->fill_jet_topo_tagged(second_jet_topo, second_jet_tags, second_jet_m / 1000., full_weight);
+
+    /*******************************/
+    /* FILL CORRELATION HISTOGRAMS */
+    /*******************************/
+
+    const Double_t first_jet_ntrk_pt[] = { first_jet_pt / 1000., first_jet_ungNtrk };
+    const Double_t second_jet_ntrk_pt[] = { second_jet_pt / 1000., second_jet_ungNtrk };
+    const Double_t first_jet_D2_m[] = { first_jet_m / 1000., first_jet_D2 };
+    const Double_t second_jet_D2_m[] = { second_jet_m / 1000., second_jet_D2 };
+    const Double_t dijet_mass_first_jet_m[] = { first_jet_m / 1000., dijet_mass_massordered / 1000. };
+
+    hists.hn_first_jet_ntrk_pt->fill_inclusive(first_jet_ntrk_pt, full_weight);
+    hists.hn_first_jet_ntrk_pt->fill_event_topo(event_topo, first_jet_ntrk_pt, full_weight);
+    hists.hn_first_jet_ntrk_pt->fill_jet_topo(first_jet_topo, first_jet_ntrk_pt, full_weight);
+    hists.hn_first_jet_ntrk_pt->fill_jet_topo_tagged(first_jet_topo, first_jet_tags, first_jet_ntrk_pt, full_weight);
+
+    hists.hn_second_jet_ntrk_pt->fill_inclusive(second_jet_ntrk_pt, full_weight);
+    hists.hn_second_jet_ntrk_pt->fill_event_topo(event_topo, second_jet_ntrk_pt, full_weight);
+    hists.hn_second_jet_ntrk_pt->fill_jet_topo(second_jet_topo, second_jet_ntrk_pt, full_weight);
+    hists.hn_second_jet_ntrk_pt->fill_jet_topo_tagged(second_jet_topo, second_jet_tags, second_jet_ntrk_pt, full_weight);
+
+    hists.hn_first_jet_D2_m->fill_inclusive(first_jet_D2_m, full_weight);
+    hists.hn_first_jet_D2_m->fill_event_topo(event_topo, first_jet_D2_m, full_weight);
+    hists.hn_first_jet_D2_m->fill_jet_topo(first_jet_topo, first_jet_D2_m, full_weight);
+    hists.hn_first_jet_D2_m->fill_jet_topo_tagged(first_jet_topo, first_jet_tags, first_jet_D2_m, full_weight);
+
+    hists.hn_second_jet_D2_m->fill_inclusive(second_jet_D2_m, full_weight);
+    hists.hn_second_jet_D2_m->fill_event_topo(event_topo, second_jet_D2_m, full_weight);
+    hists.hn_second_jet_D2_m->fill_jet_topo(second_jet_topo, second_jet_D2_m, full_weight);
+    hists.hn_second_jet_D2_m->fill_jet_topo_tagged(second_jet_topo, second_jet_tags, second_jet_D2_m, full_weight);
+
+    hists.hn_dijet_mass_first_jet_m->fill_inclusive(dijet_mass_first_jet_m, full_weight);
+    hists.hn_dijet_mass_first_jet_m->fill_event_topo(event_topo, dijet_mass_first_jet_m, full_weight);
+    hists.hn_dijet_mass_first_jet_m->fill_event_topo_tagged(event_topo, event_tags, dijet_mass_first_jet_m, full_weight);
+
+    /******************/
+    /* FILL NTRK SCAN */
+    /******************/
+
+    // the scans apply their own ntrk_max, so only the other components count
+    hists.ntrk_scan_first_jet_pt->fill_jet_topo(first_jet_topo, first_jet_components,
+            first_jet_ungNtrk, first_jet_pt / 1000., full_weight);
+    hists.ntrk_scan_second_jet_pt->fill_jet_topo(second_jet_topo, second_jet_components,
+            second_jet_ungNtrk, second_jet_pt / 1000., full_weight);
+    hists.ntrk_scan_dijet_mass->fill_event_topo(event_topo, first_jet_components, second_jet_components,
+            first_jet_ungNtrk, second_jet_ungNtrk, dijet_mass_massordered / 1000., full_weight);
+
+    run_stats.lap(PhaseFill, fill_start);
 
     return kTRUE;
 }
@@ -360,69 +564,267 @@ void VVJJFlavorSelector::SlaveTerminate()
     // have been processed. When running with PROOF SlaveTerminate() is called
     // on each slave server.
 
+    if (skim_cache) skim_cache->end_file();
+
+    run_stats.end_file(num_entries_processed);
+
+    if (progress) {
+        progress->finish(num_entries_processed);
+        progress.reset();
+    }
 }
 
-void VVJJFlavorSelector::Terminate()
+void VVJJFlavorSelector::activate_used_branches(void)
 {
-    // The Terminate() function is the last function to be called during
-    // a query. It always runs on the client, it can be used to present
-    // the results graphically or save the results to file.
+    // Disable every branch of the chain that was never read during the
+    // warm-up, so that neither the TChain nor the TTreeCache have to deal with
+    // them, and restrict the read cache to the others. The VVJJ_EVENT_COLUMNS
+    // are always kept, as the block readers need them.
 
-    auto print_percent = [] (Double_t numerator, Double_t denomenator) {
-        Double_t percent = 100.0 * numerator / denomenator;
+    TTree* tree = fChain->GetTree();
+    TObjArray* branches = tree->GetListOfBranches();
 
-        std::stringstream ss;
-        ss.precision(4);
+    std::vector<std::string> unused_branches;
+    used_branches.clear();
 
-        ss << std::fixed << numerator << " (" << percent << "%)";
+    for (Int_t i = 0; i < branches->GetEntriesFast(); i++) {
+        TBranch* branch = static_cast<TBranch*>(branches->UncheckedAt(i));
+        const std::string name = branch->GetName();
 
-        std::cout << ss.str() << std::endl;
-    };
+        if (branch->GetReadEntry() >= 0 || find_event_column(name.c_str()) >= 0) {
+            used_branches.push_back(name);
+        } else {
+            unused_branches.push_back(name);
+        }
+    }
 
-    std::cout << std::endl;
+    // the TChain applies the status to every tree it loads from now on
+    for (auto const& name : unused_branches) {
+        fChain->SetBranchStatus(name.c_str(), kFALSE);
+    }
+
+    cache_used_branches(tree);
+
+    std::cout << std::endl << "BRANCHES READ DURING THE FIRST " << BRANCH_WARMUP_ENTRIES << " ENTRIES: "
+        << used_branches.size() << " OF " << branches->GetEntriesFast() << std::endl;
+
+    if (!unused_branches.empty()) {
+        std::cout << "DISABLED UNUSED BRANCHES:";
+        for (size_t i = 0; i < unused_branches.size(); i++) {
+            std::cout << (i % 6 == 0 ? "\n\t" : " ") << unused_branches[i];
+        }
+        std::cout << std::endl << std::endl;
+    }
+}
+
+void VVJJFlavorSelector::cache_used_branches(TTree* tree)
+{
+    // Only prefetch the used branches of tree, instead of letting the
+    // TTreeCache learn them again for every file of the chain.
+
+    for (auto const& name : used_branches) {
+        tree->AddBranchToCache(name.c_str(), kTRUE);
+    }
+
+    tree->StopCacheLearningPhase();
+}
+
+void VVJJFlavorSelector::begin_tree(TTree* tree)
+{
+    // Record the start of a new input tree in the run statistics, along with
+    // the size of the branches that will be read from it.
+
+    Long64_t compressed_bytes[NUM_EVENT_COLUMNS];
+    Long64_t uncompressed_bytes[NUM_EVENT_COLUMNS];
+
+    BlockReader::column_bytes(tree, compressed_bytes, uncompressed_bytes);
+
+    const std::string path = tree->GetCurrentFile() ? tree->GetCurrentFile()->GetName() : tree->GetName();
+
+    run_stats.begin_file(path, tree->GetEntries(), num_entries_processed,
+            compressed_bytes, uncompressed_bytes);
+}
+
+void VVJJFlavorSelector::merge(const VVJJFlavorSelector& other)
+{
+    // Add the histograms and counters accumulated by another selector (i.e. one
+    // of the per-thread selectors of a ParallelProcessor) to this one.
+
+    num_entries_processed += other.num_entries_processed;
 
-    std::cout << "TOTAL EVENT WEIGHT PROCESSED: " << sum_weights_total << std::endl;
+    for (size_t set = 0; set < hist_sets.size(); set++) {
+        hist_sets[set]->merge_counters(*other.hist_sets[set]);
+    }
 
-    std::cout << "WEIGHT OF EVENTS PASSING BASELINE CUTS: ";
-    print_percent(sum_weights_baseline_selection, sum_weights_total);
+    // every TH1Topo lives in the histogram store, in the same layout for both selectors
+    hist_store->add(*other.hist_store);
+    sparse_hist_store->add(*other.sparse_hist_store);
 
-    std::cout << "WEIGHT OF BASELINE QUARK-QUARK EVENTS: ";
-    print_percent(sum_weights_qq, sum_weights_baseline_selection);
+    run_stats.merge(other.run_stats);
+}
 
-    std::cout << "WEIGHT OF BASELINE QUARK-GLUON EVENTS: ";
-    print_percent(sum_weights_qg, sum_weights_baseline_selection);
+// state files start with STATE_MAGIC and the format version
+static const char STATE_MAGIC[8] = { 'V', 'V', 'J', 'J', 'S', 'T', 'A', 'T' };
+static const UInt_t STATE_FORMAT_VERSION = 2;
 
-    std::cout << "WEIGHT OF BASELINE GLUON-GLUON EVENTS: ";
-    print_percent(sum_weights_gg, sum_weights_baseline_selection);
+void VVJJFlavorSelector::write_state(std::ostream& out) const
+{
+    out.write(STATE_MAGIC, sizeof(STATE_MAGIC));
+    write_state_value(out, STATE_FORMAT_VERSION);
+    write_state_value(out, config->config_hash());
+    write_state_value(out, num_entries_processed);
+
+    write_state_value<UInt_t>(out, hist_sets.size());
+    for (auto const& hists : hist_sets) {
+        hists->write_counters(out);
+    }
 
-    std::cout << "WEIGHT OF NON-QUARK-GLUON REJECTED EVENTS: ";
-    print_percent(sum_weights_non_quark_gluon_rejections, sum_weights_baseline_selection);
+    hist_store->write_state(out);
+    sparse_hist_store->write_state(out);
+}
+
+bool VVJJFlavorSelector::write_state(const std::string& path) const
+{
+    // written to a temporary name first, so path is always a complete state
+    const std::string tmp_path = path + ".tmp";
+
+    std::ofstream out(tmp_path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cout << "ERROR: failed to create state file: " << tmp_path << std::endl;
+        return false;
+    }
+
+    write_state(out);
+    out.close();
+
+    if (!out || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::cout << "ERROR: failed to write state file: " << path << std::endl;
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool VVJJFlavorSelector::add_state(std::istream& in, const std::string& source)
+{
+    char magic[sizeof(STATE_MAGIC)];
+    UInt_t version;
+    ULong64_t state_config_hash;
+
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, STATE_MAGIC, sizeof(magic)) != 0
+            || !read_state_value(in, version) || version != STATE_FORMAT_VERSION) {
+        std::cout << "ERROR: not a state of this version: " << source << std::endl;
+        return false;
+    }
+
+    if (!read_state_value(in, state_config_hash) || state_config_hash != config->config_hash()) {
+        std::cout << "ERROR: state was saved with a different config: " << source << std::endl;
+        return false;
+    }
+
+    UInt_t state_num_entries, num_sets;
+    bool ok = read_state_value(in, state_num_entries)
+        && read_state_value(in, num_sets) && num_sets == hist_sets.size();
+
+    for (size_t set = 0; ok && set < hist_sets.size(); set++) {
+        ok = hist_sets[set]->add_counters(in);
+    }
+
+    ok = ok && hist_store->add_state(in) && sparse_hist_store->add_state(in);
+
+    if (!ok) {
+        std::cout << "ERROR: truncated or corrupt state: " << source << std::endl;
+        return false;
+    }
+
+    num_entries_processed += state_num_entries;
+    return true;
+}
+
+bool VVJJFlavorSelector::add_state(const std::string& path)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in.is_open()) {
+        std::cout << "ERROR: failed to open state file: " << path << std::endl;
+        return false;
+    }
+
+    return add_state(in, path);
+}
+
+void VVJJFlavorSelector::Terminate()
+{
+    // The Terminate() function is the last function to be called during
+    // a query. It always runs on the client, it can be used to present
+    // the results graphically or save the results to file.
+
+    if (!state_path.empty()) {
+        run_stats.stop(num_entries_processed);
+        if (!write_state(state_path))
+            Abort("failed to write the state file");
+        return;
+    }
 
     std::cout << std::endl;
 
-    std::cout << "IN BASELINE QUARK-GLUON EVENTS:" << std::endl;
-    std::cout << "\t" << "WEIGHT OF QUARK-INITIATED LEADING JET EVENTS: ";
-    print_percent(sum_weights_qg_firstjet_quark, sum_weights_qg);
-    std::cout << "\t" << "WEIGHT OF GLUON-INITIATED LEADING JET EVENTS: ";
-    print_percent(sum_weights_qg_firstjet_gluon, sum_weights_qg);
+    const HistogramSet& nominal = *hist_sets[0];
+    nominal.print_summary();
 
-    TFile output_file(output_path.c_str(), "RECREATE");
+    std::cout << std::endl;
+    nominal.cut_flow->print_summary();
 
-    h_first_jet_pt->write_all_histograms();
-    h_first_jet_eta->write_all_histograms();
-    h_first_jet_phi->write_all_histograms();
-    h_first_jet_m->write_all_histograms();
-    h_first_jet_D2->write_all_histograms();
-    h_first_jet_ungNtrk->write_all_histograms();
+    if (lazy_reader) {
+        std::cout << std::endl;
+        lazy_reader->print_summary(config->get_cuts());
+    }
 
-    h_second_jet_pt->write_all_histograms();
-    h_second_jet_eta->write_all_histograms();
-    h_second_jet_phi->write_all_histograms();
-    h_second_jet_m->write_all_histograms();
-    h_second_jet_D2->write_all_histograms();
-    h_second_jet_ungNtrk->write_all_histograms();
+    if (hist_sets.size() > 1) {
+        std::cout << std::endl << "WEIGHT OF EVENTS PASSING BASELINE CUTS PER VARIATION (VS. NOMINAL):" << std::endl;
 
-    h_dijet_mass->write_all_histograms();
+        for (size_t set = 1; set < hist_sets.size(); set++) {
+            const HistogramSet& hists = *hist_sets[set];
+            const Double_t shift = 100.0 * (hists.sum_weights_baseline_selection
+                    / nominal.sum_weights_baseline_selection - 1.);
 
-    output_file.Close();
+            std::stringstream ss;
+            ss.precision(4);
+            ss << std::fixed << hists.sum_weights_baseline_selection << " (" << std::showpos << shift << "%)";
+
+            std::cout << "\t" << hists.name << ": " << ss.str() << std::endl;
+        }
+    }
+
+    const RunClock::time_point write_start = RunStats::now();
+
+    // each histogram set in a directory of its name ("nominal" or the
+    // variation's), staged uncompressed in memory for the OutputWriter
+    std::unique_ptr<TMemFile> contents;
+    {
+        TDirectory::TContext context;
+        contents.reset(new TMemFile((output_path + "." + generator).c_str(), "RECREATE", "", 0));
+
+        for (auto const& hists : hist_sets) {
+            contents->mkdir(hists->name.c_str())->cd();
+            hists->write_all_histograms();
+            hists->write_sum_weights();
+            hists->write_efficiencies(efficiency_interval);
+            hists->write_ntrk_scans(efficiency_interval);
+        }
+    }
+
+    if (output_writer) {
+        output_writer->submit(generator, std::move(contents));
+    } else {
+        OutputWriter writer(output_path, ROOT::CompressionSettings(ROOT::kZLIB, 1));
+        writer.submit(generator, std::move(contents));
+        writer.finish();
+    }
+
+    run_stats.lap(PhaseWrite, write_start);
+    run_stats.stop(num_entries_processed);
+
+    std::cout << std::endl;
+    run_stats.print_summary();
+    run_stats.write_json(output_path + (generator.empty() ? "" : "." + generator) + ".report.json");
 }
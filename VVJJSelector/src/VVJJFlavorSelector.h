@@ -10,49 +10,112 @@
 
 #include <TROOT.h>
 #include <TChain.h>
+#include <TEntryList.h>
 #include <TFile.h>
 #include <TH1F.h>
 #include <TSelector.h>
 
+#include "BaselineSelection.h"
+#include "Checkpointer.h"
+#include "EventBlock.h"
+#include "HistogramSet.h"
+#include "LazyBranchReader.h"
+#include "OutputWriter.h"
+#include "RunStats.h"
+#include "SelectionConfig.h"
+#include "SkimCache.h"
 #include "TH1Topo.h"
 
+// number of entries read before the unused branches are disabled
+const UInt_t BRANCH_WARMUP_ENTRIES = 1000;
+
 class VVJJFlavorSelector : public TSelector {
     public :
         TTree          *fChain;   //!pointer to the analyzed TTree or TChain
 
         const std::string output_path;
 
+        // The generator processed by this selector, the output of which
+        // Terminate() hands to output_writer (or to an OutputWriter of its
+        // own, creating output_path, if there is none).
+        std::string generator;
+        OutputWriter* output_writer; //!
+
+        // the baseline selection and tag definitions, must outlive the selector
+        const SelectionConfig* config; //!
+
+        // address of the member holding each event column, for
+        // config->get_program() and for applying the variations to the event
+        Double_t* column_values[NUM_EVENT_COLUMNS]; //!
+
+        // address of the branch pointer of each event column
+        TBranch** column_branches[NUM_EVENT_COLUMNS]; //!
+
+        // disabled for the per-thread selectors of a ParallelProcessor,
+        // which reports the progress of the whole chain itself
+        Bool_t print_progress;
+
         UInt_t num_entries_processed;
-        Double_t next_print_percent;
-
-        Double_t sum_weights_total;
-        Double_t sum_weights_baseline_selection;
-        Double_t sum_weights_qq;
-        Double_t sum_weights_qg;
-        Double_t sum_weights_gg;
-        Double_t sum_weights_qg_firstjet_quark;
-        Double_t sum_weights_qg_firstjet_gluon;
-        Double_t sum_weights_non_quark_gluon_rejections;
-
-        std::unordered_map<std::string, bool> event_tag_map;
-        std::unordered_map<std::string, bool> first_jet_tag_map;
-        std::unordered_map<std::string, bool> second_jet_tag_map;
-
-        std::unique_ptr<TH1Topo> h_first_jet_pt;
-        std::unique_ptr<TH1Topo> h_first_jet_eta;
-        std::unique_ptr<TH1Topo> h_first_jet_phi;
-        std::unique_ptr<TH1Topo> h_first_jet_m;
-        std::unique_ptr<TH1Topo> h_first_jet_D2;
-        std::unique_ptr<TH1Topo> h_first_jet_ungNtrk;
-
-        std::unique_ptr<TH1Topo> h_second_jet_pt;
-        std::unique_ptr<TH1Topo> h_second_jet_eta;
-        std::unique_ptr<TH1Topo> h_second_jet_phi;
-        std::unique_ptr<TH1Topo> h_second_jet_m;
-        std::unique_ptr<TH1Topo> h_second_jet_D2;
-        std::unique_ptr<TH1Topo> h_second_jet_ungNtrk;
-
-        std::unique_ptr<TH1Topo> h_dijet_mass;
+        Long64_t num_entries_total;
+
+        // entries processed before a checkpoint this run resumed from
+        UInt_t num_entries_resumed;
+
+        RunStats run_stats;                          //!
+        std::unique_ptr<ProgressReporter> progress;  //!
+
+        // whether some input is read from skim cache files, and the weight of
+        // the events left out of them, added to the nominal sum_weights_total
+        // (and to its cut flow, as unevaluated events) in Begin()
+        Bool_t input_skimmed;
+        Double_t sum_weights_skimmed;
+
+        // if set, the baseline-passing events of each input file are written
+        // to this cache as they are processed (see Notify())
+        SkimCache* skim_cache; //!
+
+        // if set, the sequential event loop is checkpointed, and Begin()
+        // restores the checkpoint it was resumed from (if any)
+        Checkpointer* checkpointer; //!
+
+        // If set, the branches not read during the first
+        // BRANCH_WARMUP_ENTRIES entries (and not in VVJJ_EVENT_COLUMNS) are
+        // disabled for the rest of the chain, see activate_used_branches()
+        Bool_t prune_unused_branches;
+
+        // If set, Process() reads the columns of the baseline cuts one at a
+        // time, and the other columns only for events passing every cut (see
+        // LazyBranchReader). Not used with variations, which need every
+        // column of every event.
+        Bool_t lazy_branches;
+        std::unique_ptr<LazyBranchReader> lazy_reader; //!
+
+        // interval of the tag efficiencies written in Terminate()
+        EfficiencyInterval efficiency_interval; //!
+
+        // if set, Terminate() only saves the accumulated state to this path
+        // (see write_state()) instead of writing the output histograms
+        std::string state_path; //!
+        std::vector<std::string> used_branches; //!
+
+        // scratch space for the baseline selection of ProcessBatch()
+        std::vector<UInt_t> block_survivors;              //!
+        std::vector<JetFlavor> block_first_jet_flavors;   //!
+        std::vector<JetFlavor> block_second_jet_flavors;  //!
+        std::vector<CutMask> block_failed_cuts;           //!
+
+        // the varied columns of the block being processed, see vary_block()
+        std::vector<Double_t> block_varied_columns;       //!
+
+        // backing store of every TH1Topo of hist_sets, booked in Begin()
+        std::unique_ptr<TH1TopoStore> hist_store; //!
+
+        // backing store of every THnTopo of hist_sets, booked in Begin()
+        std::unique_ptr<THnTopoStore> sparse_hist_store; //!
+
+        // the nominal histograms, followed by those of each of the
+        // config->get_variations(), booked in Begin()
+        std::vector< std::unique_ptr<HistogramSet> > hist_sets; //!
 
         // Declaration of leaf types
         Double_t        weight;
@@ -296,7 +359,8 @@ class VVJJFlavorSelector : public TSelector {
         TBranch        *b_passHLT_J460_A10R_L1J100;   //!
         TBranch        *b_passHLT_J360_A10R_L1J100;   //!
 
-        VVJJFlavorSelector(std::string output_path_);
+        VVJJFlavorSelector(std::string output_path_,
+                const SelectionConfig* config_ = &SelectionConfig::defaults());
 
         virtual ~VVJJFlavorSelector() { }
         virtual Int_t   Version() const { return 2; }
@@ -305,6 +369,16 @@ class VVJJFlavorSelector : public TSelector {
         virtual void    Init(TTree *tree);
         virtual Bool_t  Notify();
         virtual Bool_t  Process(Long64_t entry);
+        void            ProcessBatch(const EventBlock& block);
+        void            begin_tree(TTree* tree);
+        void            activate_used_branches(void);
+        void            cache_used_branches(TTree* tree);
+        Bool_t          process_event(void);
+        Bool_t          process_varied_event(const Variation& variation, HistogramSet& hists);
+        Bool_t          process_baseline_event(HistogramSet& hists, float full_weight,
+                JetFlavor first_jet_flavor, JetFlavor second_jet_flavor);
+        const EventBlock& vary_block(const Variation& variation, const EventBlock& block,
+                EventBlock& varied);
         virtual Int_t   GetEntry(Long64_t entry, Int_t getall = 0) { return fChain ? fChain->GetTree()->GetEntry(entry, getall) : 0; }
         virtual void    SetOption(const char *option) { fOption = option; }
         virtual void    SetObject(TObject *obj) { fObject = obj; }
@@ -313,6 +387,19 @@ class VVJJFlavorSelector : public TSelector {
         virtual void    SlaveTerminate();
         virtual void    Terminate();
 
+        void merge(const VVJJFlavorSelector& other);
+
+        // Save every histogram and counter accumulated since Begin() to a
+        // state file, or add those of a state file saved by a selector of
+        // the same config. Both return false (after printing an error) on
+        // failure, in which case add_state() may have added part of the file.
+        bool write_state(const std::string& path) const;
+        bool add_state(const std::string& path);
+
+        // the same, on a stream (source names it in error messages)
+        void write_state(std::ostream& out) const;
+        bool add_state(std::istream& in, const std::string& source);
+
         ClassDef(VVJJFlavorSelector,0);
 };
 
@@ -334,125 +421,142 @@ void VVJJFlavorSelector::Init(TTree *tree)
     fChain = tree;
     fChain->SetMakeClass(1);
 
-    fChain->SetBranchAddress("weight", &weight, &b_weight);
-    fChain->SetBranchAddress("pileup_weight", &pileup_weight, &b_pileup_weight);
-    fChain->SetBranchAddress("jet1_pt", &jet1_pt, &b_jet1_pt);
-    fChain->SetBranchAddress("jet1_phi", &jet1_phi, &b_jet1_phi);
-    fChain->SetBranchAddress("jet1_eta", &jet1_eta, &b_jet1_eta);
-    fChain->SetBranchAddress("jet1_m", &jet1_m, &b_jet1_m);
-    fChain->SetBranchAddress("jet1_y", &jet1_y, &b_jet1_y);
-    fChain->SetBranchAddress("jet1_nMuSeg", &jet1_nMuSeg, &b_jet1_nMuSeg);
-    fChain->SetBranchAddress("jet1_nSubJets", &jet1_nSubJets, &b_jet1_nSubJets);
-    fChain->SetBranchAddress("jet1_upt", &jet1_upt, &b_jet1_upt);
-    fChain->SetBranchAddress("jet1_ueta", &jet1_ueta, &b_jet1_ueta);
-    fChain->SetBranchAddress("jet1_uphi", &jet1_uphi, &b_jet1_uphi);
-    fChain->SetBranchAddress("jet1_um", &jet1_um, &b_jet1_um);
-    fChain->SetBranchAddress("jet1_d2", &jet1_d2, &b_jet1_d2);
-    fChain->SetBranchAddress("jet1_ntrk", &jet1_ntrk, &b_jet1_ntrk);
-    fChain->SetBranchAddress("jet1_ungrtrk500", &jet1_ungrtrk500, &b_jet1_ungrtrk500);
-    fChain->SetBranchAddress("jet1_ungrtrkW500", &jet1_ungrtrkW500, &b_jet1_ungrtrkW500);
-    fChain->SetBranchAddress("jet1_nconst", &jet1_nconst, &b_jet1_nconst);
-    fChain->SetBranchAddress("first_jet_pt", &first_jet_pt, &b_first_jet_pt);
-    fChain->SetBranchAddress("first_jet_eta", &first_jet_eta, &b_first_jet_eta);
-    fChain->SetBranchAddress("first_jet_phi", &first_jet_phi, &b_first_jet_phi);
-    fChain->SetBranchAddress("first_jet_m", &first_jet_m, &b_first_jet_m);
-    fChain->SetBranchAddress("first_jet_D2", &first_jet_D2, &b_first_jet_D2);
-    fChain->SetBranchAddress("first_jet_ntrk", &first_jet_ntrk, &b_first_jet_ntrk);
-    fChain->SetBranchAddress("first_jet_passedWSubstructure", &first_jet_passedWSubstructure, &b_first_jet_passedWSubstructure);
-    fChain->SetBranchAddress("first_jet_passedZSubstructure", &first_jet_passedZSubstructure, &b_first_jet_passedZSubstructure);
-    fChain->SetBranchAddress("first_jet_passedWMassCut", &first_jet_passedWMassCut, &b_first_jet_passedWMassCut);
-    fChain->SetBranchAddress("first_jet_passedZMassCut", &first_jet_passedZMassCut, &b_first_jet_passedZMassCut);
-    fChain->SetBranchAddress("first_jet_pdgid", &first_jet_pdgid, &b_first_jet_pdgid);
-    fChain->SetBranchAddress("jet2_pt", &jet2_pt, &b_jet2_pt);
-    fChain->SetBranchAddress("jet2_phi", &jet2_phi, &b_jet2_phi);
-    fChain->SetBranchAddress("jet2_eta", &jet2_eta, &b_jet2_eta);
-    fChain->SetBranchAddress("jet2_m", &jet2_m, &b_jet2_m);
-    fChain->SetBranchAddress("jet2_y", &jet2_y, &b_jet2_y);
-    fChain->SetBranchAddress("jet2_nMuSeg", &jet2_nMuSeg, &b_jet2_nMuSeg);
-    fChain->SetBranchAddress("jet2_nSubJets", &jet2_nSubJets, &b_jet2_nSubJets);
-    fChain->SetBranchAddress("jet2_upt", &jet2_upt, &b_jet2_upt);
-    fChain->SetBranchAddress("jet2_ueta", &jet2_ueta, &b_jet2_ueta);
-    fChain->SetBranchAddress("jet2_uphi", &jet2_uphi, &b_jet2_uphi);
-    fChain->SetBranchAddress("jet2_um", &jet2_um, &b_jet2_um);
-    fChain->SetBranchAddress("jet2_d2", &jet2_d2, &b_jet2_d2);
-    fChain->SetBranchAddress("jet2_ntrk", &jet2_ntrk, &b_jet2_ntrk);
-    fChain->SetBranchAddress("jet2_ungrtrk500", &jet2_ungrtrk500, &b_jet2_ungrtrk500);
-    fChain->SetBranchAddress("jet2_ungrtrkW500", &jet2_ungrtrkW500, &b_jet2_ungrtrkW500);
-    fChain->SetBranchAddress("jet2_nconst", &jet2_nconst, &b_jet2_nconst);
-    fChain->SetBranchAddress("second_jet_pt", &second_jet_pt, &b_second_jet_pt);
-    fChain->SetBranchAddress("second_jet_eta", &second_jet_eta, &b_second_jet_eta);
-    fChain->SetBranchAddress("second_jet_phi", &second_jet_phi, &b_second_jet_phi);
-    fChain->SetBranchAddress("second_jet_m", &second_jet_m, &b_second_jet_m);
-    fChain->SetBranchAddress("second_jet_D2", &second_jet_D2, &b_second_jet_D2);
-    fChain->SetBranchAddress("second_jet_ntrk", &second_jet_ntrk, &b_second_jet_ntrk);
-    fChain->SetBranchAddress("second_jet_passedWSubstructure", &second_jet_passedWSubstructure, &b_second_jet_passedWSubstructure);
-    fChain->SetBranchAddress("second_jet_passedZSubstructure", &second_jet_passedZSubstructure, &b_second_jet_passedZSubstructure);
-    fChain->SetBranchAddress("second_jet_passedWMassCut", &second_jet_passedWMassCut, &b_second_jet_passedWMassCut);
-    fChain->SetBranchAddress("second_jet_passedZMassCut", &second_jet_passedZMassCut, &b_second_jet_passedZMassCut);
-    fChain->SetBranchAddress("second_jet_pdgid", &second_jet_pdgid, &b_second_jet_pdgid);
-    fChain->SetBranchAddress("jet1_cpt", &jet1_cpt, &b_jet1_cpt);
-    fChain->SetBranchAddress("jet1_ceta", &jet1_ceta, &b_jet1_ceta);
-    fChain->SetBranchAddress("jet1_cphi", &jet1_cphi, &b_jet1_cphi);
-    fChain->SetBranchAddress("jet1_cm", &jet1_cm, &b_jet1_cm);
-    fChain->SetBranchAddress("jet1_ctdr", &jet1_ctdr, &b_jet1_ctdr);
-    fChain->SetBranchAddress("jet1_ctpt", &jet1_ctpt, &b_jet1_ctpt);
-    fChain->SetBranchAddress("jet1_cteta", &jet1_cteta, &b_jet1_cteta);
-    fChain->SetBranchAddress("jet1_ctphi", &jet1_ctphi, &b_jet1_ctphi);
-    fChain->SetBranchAddress("jet1_ctm", &jet1_ctm, &b_jet1_ctm);
-    fChain->SetBranchAddress("jet1_tpt", &jet1_tpt, &b_jet1_tpt);
-    fChain->SetBranchAddress("jet1_teta", &jet1_teta, &b_jet1_teta);
-    fChain->SetBranchAddress("jet1_tphi", &jet1_tphi, &b_jet1_tphi);
-    fChain->SetBranchAddress("jet1_tm", &jet1_tm, &b_jet1_tm);
-    fChain->SetBranchAddress("jet1_td2", &jet1_td2, &b_jet1_td2);
-    fChain->SetBranchAddress("jet1_tdr", &jet1_tdr, &b_jet1_tdr);
-    fChain->SetBranchAddress("jet2_tpt", &jet2_tpt, &b_jet2_tpt);
-    fChain->SetBranchAddress("jet2_teta", &jet2_teta, &b_jet2_teta);
-    fChain->SetBranchAddress("jet2_tphi", &jet2_tphi, &b_jet2_tphi);
-    fChain->SetBranchAddress("jet2_tm", &jet2_tm, &b_jet2_tm);
-    fChain->SetBranchAddress("jet2_td2", &jet2_td2, &b_jet2_td2);
-    fChain->SetBranchAddress("jet2_tdr", &jet2_tdr, &b_jet2_tdr);
-    fChain->SetBranchAddress("jet1_cyfilt", &jet1_cyfilt, &b_jet1_cyfilt);
-    fChain->SetBranchAddress("jet1_cntrk", &jet1_cntrk, &b_jet1_cntrk);
-    fChain->SetBranchAddress("jet1_cnconst", &jet1_cnconst, &b_jet1_cnconst);
-    fChain->SetBranchAddress("jet1_cungrtrk500", &jet1_cungrtrk500, &b_jet1_cungrtrk500);
-    fChain->SetBranchAddress("jet1_cungrtrkW500", &jet1_cungrtrkW500, &b_jet1_cungrtrkW500);
-    fChain->SetBranchAddress("jet2_cpt", &jet2_cpt, &b_jet2_cpt);
-    fChain->SetBranchAddress("jet2_ceta", &jet2_ceta, &b_jet2_ceta);
-    fChain->SetBranchAddress("jet2_cphi", &jet2_cphi, &b_jet2_cphi);
-    fChain->SetBranchAddress("jet2_cm", &jet2_cm, &b_jet2_cm);
-    fChain->SetBranchAddress("jet2_ctpt", &jet2_ctpt, &b_jet2_ctpt);
-    fChain->SetBranchAddress("jet2_cteta", &jet2_cteta, &b_jet2_cteta);
-    fChain->SetBranchAddress("jet2_ctphi", &jet2_ctphi, &b_jet2_ctphi);
-    fChain->SetBranchAddress("jet2_ctm", &jet2_ctm, &b_jet2_ctm);
-    fChain->SetBranchAddress("jet2_cyfilt", &jet2_cyfilt, &b_jet2_cyfilt);
-    fChain->SetBranchAddress("jet2_cntrk", &jet2_cntrk, &b_jet2_cntrk);
-    fChain->SetBranchAddress("jet2_cnconst", &jet2_cnconst, &b_jet2_cnconst);
-    fChain->SetBranchAddress("jet2_cungrtrk500", &jet2_cungrtrk500, &b_jet2_cungrtrk500);
-    fChain->SetBranchAddress("jet2_cungrtrkW500", &jet2_cungrtrkW500, &b_jet2_cungrtrkW500);
-    fChain->SetBranchAddress("jet12_m", &jet12_m, &b_jet12_m);
-    fChain->SetBranchAddress("jet12_um", &jet12_um, &b_jet12_um);
-    fChain->SetBranchAddress("jet12_cm", &jet12_cm, &b_jet12_cm);
-    fChain->SetBranchAddress("dijet_mass_massordered", &dijet_mass_massordered, &b_dijet_mass_massordered);
-    fChain->SetBranchAddress("ptasym", &ptasym, &b_ptasym);
-    fChain->SetBranchAddress("dyjj", &dyjj, &b_dyjj);
-    fChain->SetBranchAddress("uptasym", &uptasym, &b_uptasym);
-    fChain->SetBranchAddress("udyjj", &udyjj, &b_udyjj);
-    fChain->SetBranchAddress("cptasym", &cptasym, &b_cptasym);
-    fChain->SetBranchAddress("cdyjj", &cdyjj, &b_cdyjj);
-    fChain->SetBranchAddress("npv0", &npv0, &b_npv0);
-    fChain->SetBranchAddress("avgMu", &avgMu, &b_avgMu);
-    fChain->SetBranchAddress("avgIntPerX", &avgIntPerX, &b_avgIntPerX);
-    fChain->SetBranchAddress("actMu", &actMu, &b_actMu);
-    fChain->SetBranchAddress("run", &run, &b_run);
-    fChain->SetBranchAddress("event", &event, &b_event);
-    fChain->SetBranchAddress("n_muons", &n_muons, &b_n_muons);
-    fChain->SetBranchAddress("n_elecs", &n_elecs, &b_n_elecs);
-    fChain->SetBranchAddress("n_jets", &n_jets, &b_n_jets);
-    fChain->SetBranchAddress("n_sigMu", &n_sigMu, &b_n_sigMu);
-    fChain->SetBranchAddress("n_sigEl", &n_sigEl, &b_n_sigEl);
-    fChain->SetBranchAddress("hasPV", &hasPV, &b_hasPV);
-    fChain->SetBranchAddress("passHLT_J460_A10R_L1J100", &passHLT_J460_A10R_L1J100, &b_passHLT_J460_A10R_L1J100);
-    fChain->SetBranchAddress("passHLT_J360_A10R_L1J100", &passHLT_J360_A10R_L1J100, &b_passHLT_J360_A10R_L1J100);
+    // on a TChain this may have to open every file, so only do it once
+    num_entries_total = fChain->GetEntryList() ? fChain->GetEntryList()->GetN() : fChain->GetEntries();
+    if (print_progress)
+        progress.reset(new ProgressReporter(num_entries_total));
+
+    lazy_reader.reset();
+    if (lazy_branches && config->get_variations().empty())
+        lazy_reader.reset(new LazyBranchReader(config->get_program(), column_branches));
+
+    // skim cache files only contain the branches in VVJJ_EVENT_COLUMNS, so
+    // leave the pointers of the branches a tree doesn't have null
+    auto bind = [this] (const char* name, void* address, TBranch** branch) {
+        *branch = nullptr;
+        if (fChain->GetBranch(name) != nullptr)
+            fChain->SetBranchAddress(name, address, branch);
+    };
+
+    bind("weight", &weight, &b_weight);
+    bind("pileup_weight", &pileup_weight, &b_pileup_weight);
+    bind("jet1_pt", &jet1_pt, &b_jet1_pt);
+    bind("jet1_phi", &jet1_phi, &b_jet1_phi);
+    bind("jet1_eta", &jet1_eta, &b_jet1_eta);
+    bind("jet1_m", &jet1_m, &b_jet1_m);
+    bind("jet1_y", &jet1_y, &b_jet1_y);
+    bind("jet1_nMuSeg", &jet1_nMuSeg, &b_jet1_nMuSeg);
+    bind("jet1_nSubJets", &jet1_nSubJets, &b_jet1_nSubJets);
+    bind("jet1_upt", &jet1_upt, &b_jet1_upt);
+    bind("jet1_ueta", &jet1_ueta, &b_jet1_ueta);
+    bind("jet1_uphi", &jet1_uphi, &b_jet1_uphi);
+    bind("jet1_um", &jet1_um, &b_jet1_um);
+    bind("jet1_d2", &jet1_d2, &b_jet1_d2);
+    bind("jet1_ntrk", &jet1_ntrk, &b_jet1_ntrk);
+    bind("jet1_ungrtrk500", &jet1_ungrtrk500, &b_jet1_ungrtrk500);
+    bind("jet1_ungrtrkW500", &jet1_ungrtrkW500, &b_jet1_ungrtrkW500);
+    bind("jet1_nconst", &jet1_nconst, &b_jet1_nconst);
+    bind("first_jet_pt", &first_jet_pt, &b_first_jet_pt);
+    bind("first_jet_eta", &first_jet_eta, &b_first_jet_eta);
+    bind("first_jet_phi", &first_jet_phi, &b_first_jet_phi);
+    bind("first_jet_m", &first_jet_m, &b_first_jet_m);
+    bind("first_jet_D2", &first_jet_D2, &b_first_jet_D2);
+    bind("first_jet_ntrk", &first_jet_ntrk, &b_first_jet_ntrk);
+    bind("first_jet_passedWSubstructure", &first_jet_passedWSubstructure, &b_first_jet_passedWSubstructure);
+    bind("first_jet_passedZSubstructure", &first_jet_passedZSubstructure, &b_first_jet_passedZSubstructure);
+    bind("first_jet_passedWMassCut", &first_jet_passedWMassCut, &b_first_jet_passedWMassCut);
+    bind("first_jet_passedZMassCut", &first_jet_passedZMassCut, &b_first_jet_passedZMassCut);
+    bind("first_jet_pdgid", &first_jet_pdgid, &b_first_jet_pdgid);
+    bind("jet2_pt", &jet2_pt, &b_jet2_pt);
+    bind("jet2_phi", &jet2_phi, &b_jet2_phi);
+    bind("jet2_eta", &jet2_eta, &b_jet2_eta);
+    bind("jet2_m", &jet2_m, &b_jet2_m);
+    bind("jet2_y", &jet2_y, &b_jet2_y);
+    bind("jet2_nMuSeg", &jet2_nMuSeg, &b_jet2_nMuSeg);
+    bind("jet2_nSubJets", &jet2_nSubJets, &b_jet2_nSubJets);
+    bind("jet2_upt", &jet2_upt, &b_jet2_upt);
+    bind("jet2_ueta", &jet2_ueta, &b_jet2_ueta);
+    bind("jet2_uphi", &jet2_uphi, &b_jet2_uphi);
+    bind("jet2_um", &jet2_um, &b_jet2_um);
+    bind("jet2_d2", &jet2_d2, &b_jet2_d2);
+    bind("jet2_ntrk", &jet2_ntrk, &b_jet2_ntrk);
+    bind("jet2_ungrtrk500", &jet2_ungrtrk500, &b_jet2_ungrtrk500);
+    bind("jet2_ungrtrkW500", &jet2_ungrtrkW500, &b_jet2_ungrtrkW500);
+    bind("jet2_nconst", &jet2_nconst, &b_jet2_nconst);
+    bind("second_jet_pt", &second_jet_pt, &b_second_jet_pt);
+    bind("second_jet_eta", &second_jet_eta, &b_second_jet_eta);
+    bind("second_jet_phi", &second_jet_phi, &b_second_jet_phi);
+    bind("second_jet_m", &second_jet_m, &b_second_jet_m);
+    bind("second_jet_D2", &second_jet_D2, &b_second_jet_D2);
+    bind("second_jet_ntrk", &second_jet_ntrk, &b_second_jet_ntrk);
+    bind("second_jet_passedWSubstructure", &second_jet_passedWSubstructure, &b_second_jet_passedWSubstructure);
+    bind("second_jet_passedZSubstructure", &second_jet_passedZSubstructure, &b_second_jet_passedZSubstructure);
+    bind("second_jet_passedWMassCut", &second_jet_passedWMassCut, &b_second_jet_passedWMassCut);
+    bind("second_jet_passedZMassCut", &second_jet_passedZMassCut, &b_second_jet_passedZMassCut);
+    bind("second_jet_pdgid", &second_jet_pdgid, &b_second_jet_pdgid);
+    bind("jet1_cpt", &jet1_cpt, &b_jet1_cpt);
+    bind("jet1_ceta", &jet1_ceta, &b_jet1_ceta);
+    bind("jet1_cphi", &jet1_cphi, &b_jet1_cphi);
+    bind("jet1_cm", &jet1_cm, &b_jet1_cm);
+    bind("jet1_ctdr", &jet1_ctdr, &b_jet1_ctdr);
+    bind("jet1_ctpt", &jet1_ctpt, &b_jet1_ctpt);
+    bind("jet1_cteta", &jet1_cteta, &b_jet1_cteta);
+    bind("jet1_ctphi", &jet1_ctphi, &b_jet1_ctphi);
+    bind("jet1_ctm", &jet1_ctm, &b_jet1_ctm);
+    bind("jet1_tpt", &jet1_tpt, &b_jet1_tpt);
+    bind("jet1_teta", &jet1_teta, &b_jet1_teta);
+    bind("jet1_tphi", &jet1_tphi, &b_jet1_tphi);
+    bind("jet1_tm", &jet1_tm, &b_jet1_tm);
+    bind("jet1_td2", &jet1_td2, &b_jet1_td2);
+    bind("jet1_tdr", &jet1_tdr, &b_jet1_tdr);
+    bind("jet2_tpt", &jet2_tpt, &b_jet2_tpt);
+    bind("jet2_teta", &jet2_teta, &b_jet2_teta);
+    bind("jet2_tphi", &jet2_tphi, &b_jet2_tphi);
+    bind("jet2_tm", &jet2_tm, &b_jet2_tm);
+    bind("jet2_td2", &jet2_td2, &b_jet2_td2);
+    bind("jet2_tdr", &jet2_tdr, &b_jet2_tdr);
+    bind("jet1_cyfilt", &jet1_cyfilt, &b_jet1_cyfilt);
+    bind("jet1_cntrk", &jet1_cntrk, &b_jet1_cntrk);
+    bind("jet1_cnconst", &jet1_cnconst, &b_jet1_cnconst);
+    bind("jet1_cungrtrk500", &jet1_cungrtrk500, &b_jet1_cungrtrk500);
+    bind("jet1_cungrtrkW500", &jet1_cungrtrkW500, &b_jet1_cungrtrkW500);
+    bind("jet2_cpt", &jet2_cpt, &b_jet2_cpt);
+    bind("jet2_ceta", &jet2_ceta, &b_jet2_ceta);
+    bind("jet2_cphi", &jet2_cphi, &b_jet2_cphi);
+    bind("jet2_cm", &jet2_cm, &b_jet2_cm);
+    bind("jet2_ctpt", &jet2_ctpt, &b_jet2_ctpt);
+    bind("jet2_cteta", &jet2_cteta, &b_jet2_cteta);
+    bind("jet2_ctphi", &jet2_ctphi, &b_jet2_ctphi);
+    bind("jet2_ctm", &jet2_ctm, &b_jet2_ctm);
+    bind("jet2_cyfilt", &jet2_cyfilt, &b_jet2_cyfilt);
+    bind("jet2_cntrk", &jet2_cntrk, &b_jet2_cntrk);
+    bind("jet2_cnconst", &jet2_cnconst, &b_jet2_cnconst);
+    bind("jet2_cungrtrk500", &jet2_cungrtrk500, &b_jet2_cungrtrk500);
+    bind("jet2_cungrtrkW500", &jet2_cungrtrkW500, &b_jet2_cungrtrkW500);
+    bind("jet12_m", &jet12_m, &b_jet12_m);
+    bind("jet12_um", &jet12_um, &b_jet12_um);
+    bind("jet12_cm", &jet12_cm, &b_jet12_cm);
+    bind("dijet_mass_massordered", &dijet_mass_massordered, &b_dijet_mass_massordered);
+    bind("ptasym", &ptasym, &b_ptasym);
+    bind("dyjj", &dyjj, &b_dyjj);
+    bind("uptasym", &uptasym, &b_uptasym);
+    bind("udyjj", &udyjj, &b_udyjj);
+    bind("cptasym", &cptasym, &b_cptasym);
+    bind("cdyjj", &cdyjj, &b_cdyjj);
+    bind("npv0", &npv0, &b_npv0);
+    bind("avgMu", &avgMu, &b_avgMu);
+    bind("avgIntPerX", &avgIntPerX, &b_avgIntPerX);
+    bind("actMu", &actMu, &b_actMu);
+    bind("run", &run, &b_run);
+    bind("event", &event, &b_event);
+    bind("n_muons", &n_muons, &b_n_muons);
+    bind("n_elecs", &n_elecs, &b_n_elecs);
+    bind("n_jets", &n_jets, &b_n_jets);
+    bind("n_sigMu", &n_sigMu, &b_n_sigMu);
+    bind("n_sigEl", &n_sigEl, &b_n_sigEl);
+    bind("hasPV", &hasPV, &b_hasPV);
+    bind("passHLT_J460_A10R_L1J100", &passHLT_J460_A10R_L1J100, &b_passHLT_J460_A10R_L1J100);
+    bind("passHLT_J360_A10R_L1J100", &passHLT_J360_A10R_L1J100, &b_passHLT_J360_A10R_L1J100);
 }
 
 Bool_t VVJJFlavorSelector::Notify()
@@ -463,6 +567,27 @@ Bool_t VVJJFlavorSelector::Notify()
     // to the generated code, but the routine can be extended by the
     // user if needed. The return value is currently not used.
 
+    if (fChain != nullptr && fChain->GetTree() != nullptr) {
+        begin_tree(fChain->GetTree());
+
+        if (!used_branches.empty())
+            cache_used_branches(fChain->GetTree());
+
+        if (lazy_reader)
+            lazy_reader->begin_tree(fChain->GetTree());
+    }
+
+    if (skim_cache != nullptr && fChain != nullptr && fChain->GetCurrentFile() != nullptr) {
+#define VVJJ_COLUMN_ADDRESS(name) &name,
+        Double_t* const column_addresses[NUM_EVENT_COLUMNS] = {
+            VVJJ_EVENT_COLUMNS(VVJJ_COLUMN_ADDRESS)
+        };
+#undef VVJJ_COLUMN_ADDRESS
+
+        skim_cache->begin_file(fChain->GetCurrentFile()->GetName(),
+                fChain->GetTree()->GetEntries(), column_addresses);
+    }
+
     return kTRUE;
 }
 
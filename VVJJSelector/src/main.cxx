@@ -1,18 +1,487 @@
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <memory>
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
 #include <unordered_map>
+#include <thread>
 #include <vector>
 
+#include <Compression.h>
 #include <TChain.h>
+#include <TFile.h>
+#include <TH1.h>
+#include <TSystem.h>
 
+#include "Checkpointer.h"
+#include "ColumnarProcessor.h"
+#include "Efficiency.h"
+#include "EventIndex.h"
+#include "EventSelection.h"
+#include "IncrementalCache.h"
+#include "OutputWriter.h"
+#include "ParallelProcessor.h"
+#include "ReadAheadProcessor.h"
+#include "SelectionConfig.h"
+#include "ShardedProcessor.h"
+#include "SkimCache.h"
 #include "VVJJFlavorSelector.h"
 
+static void
+print_usage(const char* program_name)
+{
+    std::cout << "usage: " << program_name << " <input_file_list> <output_path> [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "options:" << std::endl;
+    std::cout << "\t--config FILE       load the baseline selection, tags and variations from FILE" << std::endl;
+    std::cout << "\t--dump-config       print the selection config in use (the default one, without --config), then exit" << std::endl;
+    std::cout << "\t--threads N         process each generator with N threads" << std::endl;
+    std::cout << "\t--processes N       split the input files of each generator into N balanced shards, processed" << std::endl;
+    std::cout << "\t                    by N worker processes (failed shards are retried), then merged" << std::endl;
+    std::cout << "\t--skim-cache DIR    read (or, single-threaded, write) cached baseline-selected events in DIR" << std::endl;
+    std::cout << "\t--incremental DIR   keep the partial result of each input file in DIR, and only process" << std::endl;
+    std::cout << "\t                    the input files that are new or changed since the last run" << std::endl;
+    std::cout << "\t--read-ahead MB     read and decompress ahead of the (single-threaded) event loop" << std::endl;
+    std::cout << "\t                    in a background thread, within a memory budget of MB megabytes" << std::endl;
+    std::cout << "\t--checkpoint SECONDS" << std::endl;
+    std::cout << "\t                    save the (single-threaded) event loop every SECONDS seconds to" << std::endl;
+    std::cout << "\t                    <output_path>.<gen>.checkpoint, and resume from there when rerun" << std::endl;
+    std::cout << "\t--runs LIST         only process the events of these runs, e.g. 284500,300000-300500" << std::endl;
+    std::cout << "\t--events FILE       only process the events listed in FILE, one \"RUN EVENT\" per line" << std::endl;
+    std::cout << "\t--entries LIST      only process these entries of each generator's chain, e.g. 0-9999" << std::endl;
+    std::cout << "\t--event-index DIR   keep the (run, event) index of each input file in DIR, instead of" << std::endl;
+    std::cout << "\t                    next to it as <input_file>.eventindex (built on first use)" << std::endl;
+    std::cout << "\t--lazy-branches     in the (single-threaded) event loop, only read the columns of the baseline" << std::endl;
+    std::cout << "\t                    cuts an event reaches, most rejecting first (the cut flows and N-1" << std::endl;
+    std::cout << "\t                    histograms are then not written, not used with variations)" << std::endl;
+    std::cout << "\t--all-branches      keep every branch enabled, even those the selector never reads" << std::endl;
+    std::cout << "\t--compression ALG[:LEVEL]" << std::endl;
+    std::cout << "\t                    compression of the output file: zlib, lzma, lz4, zstd (ROOT >= 6.20)" << std::endl;
+    std::cout << "\t                    or none, e.g. lz4:4 (default: zlib:1)" << std::endl;
+    std::cout << "\t--efficiency-interval clopper-pearson|bayesian" << std::endl;
+    std::cout << "\t                    uncertainty interval of the efficiencies written with the histograms" << std::endl;
+    std::cout << "\t--convert-columnar DIR" << std::endl;
+    std::cout << "\t                    convert the input files to columnar datasets in DIR, then exit" << std::endl;
+    std::cout << "\t--lz4               LZ4-compress the columnar datasets (requires building with WITH_LZ4=1)" << std::endl;
+    std::cout << std::endl;
+    std::cout << "columnar dataset directories can be listed in <input_file_list> in place of ntuples" << std::endl;
+    std::cout << "the output of each generator is written to <set>/<gen>/<name>_<gen> of <output_path>," << std::endl;
+    std::cout << "where <set> is nominal or the name of a variation" << std::endl;
+}
+
+// the N of --threads, --processes and --read-ahead, false if malformed or
+// out of range (std::stoi into an unsigned would turn a negative N into some
+// 4 billion)
+static bool
+parse_count(const std::string& arg, unsigned& count)
+{
+    try {
+        size_t end;
+        const long long value = std::stoll(arg, &end);
+        if (end != arg.size() || value < 1 || value > UINT_MAX)
+            return false;
+
+        count = value;
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+// the SECONDS of --checkpoint, false unless a finite number above 0
+static bool
+parse_seconds(const std::string& arg, double& seconds)
+{
+    try {
+        size_t end;
+        const double value = std::stod(arg, &end);
+        if (end != arg.size() || !std::isfinite(value) || value <= 0.)
+            return false;
+
+        seconds = value;
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+// Convert the Nominal tree of every input file into a columnar dataset in
+// output_dir/<gen>/, and write the matching input file list to
+// output_dir/input_list.txt.
+static int
+convert_to_columnar(const std::unordered_map< std::string, std::vector<std::string> >& ntuple_filepath_map,
+        const std::string& output_dir, ColumnEncoding encoding)
+{
+    const std::string list_path = output_dir + "/input_list.txt";
+    gSystem->mkdir(output_dir.c_str(), kTRUE);
+
+    std::ofstream list_file(list_path.c_str());
+    if (!list_file.is_open()) {
+        std::cout << "ERROR: failed to create columnar input file list: " << list_path << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    for (auto const& x : ntuple_filepath_map) {
+        const std::string& gen = x.first;
+
+        for (size_t i = 0; i < x.second.size(); i++) {
+            const std::string& path = x.second[i];
+
+            std::unique_ptr<TFile> ntuple_file(TFile::Open(path.c_str(), "READ"));
+            TTree* tree = nullptr;
+            if (ntuple_file && !ntuple_file->IsZombie())
+                tree = dynamic_cast<TTree*>(ntuple_file->Get("Nominal"));
+
+            if (tree == nullptr) {
+                std::cout << "ERROR: failed to read Nominal tree from input file: " << path << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            // prefix with the file's index, ntuples of a generator often share a base name
+            std::string base_name = path.substr(path.find_last_of('/') + 1);
+            if (base_name.size() > 5 && base_name.compare(base_name.size() - 5, 5, ".root") == 0)
+                base_name.resize(base_name.size() - 5);
+
+            const std::string dataset_dir = output_dir + "/" + gen + "/" + std::to_string(i) + "_" + base_name;
+
+            std::cout << "converting " << path << " -> " << dataset_dir << std::endl;
+            if (!write_columnar_dataset(tree, dataset_dir, encoding))
+                return EXIT_FAILURE;
+
+            list_file << dataset_dir << " " << gen << std::endl;
+        }
+    }
+
+    std::cout << std::endl << "columnar input file list written to: " << list_path << std::endl;
+    return EXIT_SUCCESS;
+}
+
+// Run selector over chain, with the event loop chosen on the command line.
+// With a checkpointer (single-threaded loops only), resume from its
+// checkpoint if there is one.
+static int
+process_chain(TChain* chain, VVJJFlavorSelector* selector, unsigned num_threads, size_t read_ahead_mb,
+        SkimCache* skim_cache, Bool_t prune_unused_branches, Bool_t lazy_branches,
+        Checkpointer* checkpointer = nullptr)
+{
+    Long64_t first_entry = 0;
+
+    if (checkpointer && num_threads <= 1) {
+        first_entry = checkpointer->load(selector->config);
+        if (first_entry < 0)
+            return EXIT_FAILURE;
+
+        if (checkpointer->resuming())
+            std::cout << "resuming from checkpoint at entry " << first_entry << std::endl;
+
+        selector->checkpointer = checkpointer;
+    }
+
+    if (num_threads > 1) {
+        ParallelProcessor processor(chain, num_threads);
+        if (!processor.process(selector))
+            return EXIT_FAILURE;
+    } else if (read_ahead_mb > 0) {
+        ReadAheadProcessor processor(chain, read_ahead_mb * 1024 * 1024, first_entry);
+        if (!processor.process(selector))
+            return EXIT_FAILURE;
+    } else {
+        selector->skim_cache = skim_cache;
+        selector->prune_unused_branches = prune_unused_branches;
+        selector->lazy_branches = lazy_branches;
+        if (chain->Process(selector, "", chain->GetEntries() - first_entry, first_entry) < 0) {
+            std::cout << "ERROR: failed to process the input chain" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // e.g. the checkpoint could not be restored, or the state not written
+    if (selector->GetAbort() != TSelector::kContinue)
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
+
+// Process the input files of one generator with --incremental: each file
+// without an up to date partial result in the cache is processed on its own
+// and its partial result saved, then every partial result is added to
+// selector, which writes the output as usual.
+static int
+process_incremental(const std::vector<std::string>& paths, IncrementalCache& cache,
+        VVJJFlavorSelector* selector, unsigned num_threads, size_t read_ahead_mb,
+        Bool_t prune_unused_branches, Bool_t lazy_branches)
+{
+    std::vector<std::string> state_paths;
+
+    // inputs that can't be cached (e.g. remote files) are processed together
+    TChain uncached_chain("Nominal");
+    const std::string uncached_state_path = selector->output_path + ".uncached.state";
+
+    size_t num_cached = 0;
+
+    for (auto const& path : paths) {
+        std::string state_path;
+
+        if (cache.lookup(path, state_path)) {
+            std::cout << "\t" + path << " CACHED." << std::endl;
+            state_paths.push_back(state_path);
+            num_cached++;
+            continue;
+        }
+
+        if (state_path.empty()) {
+            std::cout << "\t" + path << " NOT CACHEABLE." << std::endl;
+            if (uncached_chain.Add(path.c_str(), 0) != 1) {
+                std::cout << "ERROR: failed to open input file: " << path << std::endl;
+                return EXIT_FAILURE;
+            }
+            continue;
+        }
+
+        std::cout << std::endl << "### Processing new or changed file: " << path << " ###" << std::endl;
+
+        TChain chain("Nominal");
+        if (chain.Add(path.c_str(), 0) != 1) {
+            std::cout << "ERROR: failed to open input file: " << path << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        VVJJFlavorSelector file_selector(selector->output_path, selector->config);
+        file_selector.state_path = state_path;
+        const int status = process_chain(&chain, &file_selector, num_threads, read_ahead_mb, nullptr,
+                prune_unused_branches, lazy_branches);
+
+        // a failed file is left out of the cache, so it is processed again next time
+        if (status != EXIT_SUCCESS)
+            return status;
+
+        if (!cache.commit(path)) {
+            std::cout << "ERROR: failed to save the partial result of: " << path << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        state_paths.push_back(state_path);
+    }
+
+    if (uncached_chain.GetNtrees() > 0) {
+        VVJJFlavorSelector uncached_selector(selector->output_path, selector->config);
+        uncached_selector.state_path = uncached_state_path;
+        const int status = process_chain(&uncached_chain, &uncached_selector, num_threads, read_ahead_mb,
+                nullptr, prune_unused_branches, lazy_branches);
+
+        if (status != EXIT_SUCCESS)
+            return status;
+
+        state_paths.push_back(uncached_state_path);
+    }
+
+    std::cout << std::endl << "### Merging partial results: " << num_cached << " of " << paths.size()
+        << " files cached ###" << std::endl;
+
+    selector->Begin(nullptr);
+
+    for (auto const& state_path : state_paths) {
+        if (!selector->add_state(state_path))
+            return EXIT_FAILURE;
+    }
+
+    if (uncached_chain.GetNtrees() > 0)
+        std::remove(uncached_state_path.c_str());
+
+    selector->Terminate();
+
+    return EXIT_SUCCESS;
+}
+
 int
 main(int argc, char** argv)
 {
-    std::string input_path = argv[1];
-    std::string output_path = argv[2];
+    // --dump-config doesn't need any inputs
+    bool dump_config = false;
+    for (int i = 1; i < argc; i++) {
+        dump_config = dump_config || std::string(argv[i]) == "--dump-config";
+    }
+
+    if (argc < 3 && !dump_config) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::string input_path = argc > 1 ? argv[1] : "";
+    std::string output_path = argc > 2 ? argv[2] : "";
+
+    // parse the optional arguments
+    std::string config_path;
+    unsigned num_threads = 1;
+    unsigned num_processes = 1;
+    std::string worker_state_path;
+    std::string skim_cache_dir;
+    std::string incremental_dir;
+    Bool_t prune_unused_branches = kTRUE;
+    Bool_t lazy_branches = kFALSE;
+    EfficiencyInterval efficiency_interval = EfficiencyInterval::ClopperPearson;
+    size_t read_ahead_mb = 0;
+    double checkpoint_seconds = 0.;
+    Int_t compression_settings = ROOT::CompressionSettings(ROOT::kZLIB, 1);
+    EventSelection event_selection;
+    std::string event_index_dir;
+    std::string columnar_dir;
+    ColumnEncoding columnar_encoding = ColumnEncoding::Raw;
+
+    for (int i = dump_config ? 1 : 3; i < argc; i++) {
+        std::string option = argv[i];
+
+        if (option == "--dump-config") {
+            continue;
+        } else if (option == "--config" && i + 1 < argc) {
+            config_path = argv[++i];
+        } else if (dump_config && option.compare(0, 2, "--") != 0) {
+            // positional arguments
+            continue;
+        } else if (option == "--threads" && i + 1 < argc) {
+            if (!parse_count(argv[++i], num_threads)) {
+                std::cout << "ERROR: malformed number of threads: " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (option == "--processes" && i + 1 < argc) {
+            if (!parse_count(argv[++i], num_processes)) {
+                std::cout << "ERROR: malformed number of processes: " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (option == "--worker-state" && i + 1 < argc) {
+            // set by ShardedProcessor: save the selector state of the (one
+            // generator) input file list instead of writing the output
+            worker_state_path = argv[++i];
+        } else if (option == "--skim-cache" && i + 1 < argc) {
+            skim_cache_dir = argv[++i];
+        } else if (option == "--incremental" && i + 1 < argc) {
+            incremental_dir = argv[++i];
+        } else if (option == "--read-ahead" && i + 1 < argc) {
+            unsigned read_ahead;
+            if (!parse_count(argv[++i], read_ahead)) {
+                std::cout << "ERROR: malformed read-ahead size: " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+            read_ahead_mb = read_ahead;
+        } else if (option == "--checkpoint" && i + 1 < argc) {
+            if (!parse_seconds(argv[++i], checkpoint_seconds)) {
+                std::cout << "ERROR: malformed checkpoint interval: " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (option == "--runs" && i + 1 < argc) {
+            if (!event_selection.add_runs(argv[++i])) {
+                std::cout << "ERROR: malformed run list: " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (option == "--events" && i + 1 < argc) {
+            if (!event_selection.add_events(argv[++i])) {
+                std::cout << "ERROR: failed to read event list: " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (option == "--entries" && i + 1 < argc) {
+            if (!event_selection.add_entries(argv[++i])) {
+                std::cout << "ERROR: malformed entry list: " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (option == "--event-index" && i + 1 < argc) {
+            event_index_dir = argv[++i];
+        } else if (option == "--lazy-branches") {
+            lazy_branches = kTRUE;
+        } else if (option == "--all-branches") {
+            prune_unused_branches = kFALSE;
+        } else if (option == "--compression" && i + 1 < argc) {
+            if (!parse_compression(argv[++i], compression_settings)) {
+                std::cout << "ERROR: unknown or unavailable compression: " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (option == "--efficiency-interval" && i + 1 < argc) {
+            if (!parse_efficiency_interval(argv[++i], efficiency_interval)) {
+                std::cout << "ERROR: unknown efficiency interval: " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (option == "--convert-columnar" && i + 1 < argc) {
+            columnar_dir = argv[++i];
+        } else if (option == "--lz4") {
+            columnar_encoding = ColumnEncoding::LZ4;
+        } else {
+            std::cout << "ERROR: unrecognized option: " << option << std::endl;
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    SelectionConfig config = SelectionConfig::defaults();
+    if (!config_path.empty() && !config.load(config_path))
+        return EXIT_FAILURE;
+
+    if (dump_config) {
+        std::cout << config.to_string();
+        return EXIT_SUCCESS;
+    }
+
+    // the selected events are processed by the sequential event loop
+    if (!event_selection.empty() && (num_threads > 1 || num_processes > 1 || read_ahead_mb > 0
+                || !incremental_dir.empty() || !skim_cache_dir.empty() || checkpoint_seconds > 0.)) {
+        std::cout << "NOTE: --threads, --processes, --read-ahead, --incremental, --skim-cache and --checkpoint"
+            << " are not used with --runs, --events or --entries" << std::endl;
+        num_threads = 1;
+        num_processes = 1;
+        read_ahead_mb = 0;
+        incremental_dir.clear();
+        skim_cache_dir.clear();
+        checkpoint_seconds = 0.;
+    }
+
+    // histograms are owned by TH1Topo, they must not register themselves with
+    // whatever file happens to be gDirectory of the thread that creates them
+    if (num_threads > 1)
+        TH1::AddDirectory(kFALSE);
+
+    std::unique_ptr<IncrementalCache> incremental_cache;
+    if (!incremental_dir.empty()) {
+        incremental_cache.reset(new IncrementalCache(incremental_dir, config.config_hash()));
+        if (!incremental_cache->load())
+            return EXIT_FAILURE;
+    }
+
+    if (num_processes > 1 && incremental_cache) {
+        std::cout << "NOTE: --processes is not used with --incremental" << std::endl;
+        num_processes = 1;
+    }
+
+    if (checkpoint_seconds > 0. && (num_threads > 1 || incremental_cache)) {
+        std::cout << "NOTE: checkpoints are not saved with --threads or --incremental" << std::endl;
+        checkpoint_seconds = 0.;
+    }
+
+    if (lazy_branches && !config.get_variations().empty()) {
+        // a varied event may pass the cuts the nominal one fails
+        std::cout << "NOTE: --lazy-branches is not used with systematic variations" << std::endl;
+        lazy_branches = kFALSE;
+    } else if (lazy_branches && (num_threads > 1 || read_ahead_mb > 0)) {
+        // the block readers read whole columns anyway
+        std::cout << "NOTE: --lazy-branches is not used with --threads or --read-ahead" << std::endl;
+        lazy_branches = kFALSE;
+    }
+
+    // cache files are only written by the sequential event loop
+    std::unique_ptr<SkimCache> skim_cache;
+    if (!skim_cache_dir.empty() && incremental_cache) {
+        // the partial results hold the whole sum_weights_total of each file
+        std::cout << "NOTE: the skim cache is not used with --incremental" << std::endl;
+    } else if (!skim_cache_dir.empty() && !config.get_variations().empty()) {
+        // the nominal skim leaves out events a variation could still select
+        std::cout << "NOTE: the skim cache is not used with systematic variations" << std::endl;
+    } else if (!skim_cache_dir.empty()) {
+        skim_cache.reset(new SkimCache(skim_cache_dir, config.selection_hash()));
+
+        if (num_threads > 1 || read_ahead_mb > 0) {
+            std::cout << "NOTE: skim cache files are only read, not written, when running with --threads or --read-ahead" << std::endl;
+        }
+    }
 
     // load the input file
     std::ifstream input_file(input_path.c_str(), std::ifstream::in);
@@ -42,15 +511,52 @@ main(int argc, char** argv)
         }
     }
 
+    if (!columnar_dir.empty())
+        return convert_to_columnar(ntuple_filepath_map, columnar_dir, columnar_encoding);
+
     // now construct and add files to the TChains
     std::unordered_map<std::string, TChain*> tchains;
     Int_t ret_code;
 
+    // generators whose inputs are columnar datasets are processed without a TChain
+    std::unordered_map< std::string, std::unique_ptr<ColumnarProcessor> > columnar_processors;
+
+    // the weight of the events left out of the skim cache files, per generator
+    std::unordered_map<std::string, Double_t> skimmed_sum_weights;
+
     for (auto const& x : ntuple_filepath_map)
     {
         ntuple_gen = x.first;
         ntuple_paths = x.second;
 
+        if (ColumnarDataset::is_columnar(ntuple_paths.front())) {
+            std::cout << std::endl << "### Loading columnar datasets: " << ntuple_gen << " ###" << std::endl;
+            columnar_processors[ntuple_gen].reset(new ColumnarProcessor(num_threads));
+
+            if (incremental_cache)
+                std::cout << "NOTE: columnar datasets are always processed in full, --incremental only applies to ntuples" << std::endl;
+
+            if (!event_selection.empty())
+                std::cout << "NOTE: columnar datasets are always processed in full, --runs, --events and --entries only apply to ntuples" << std::endl;
+
+            for (auto const& path : ntuple_paths) {
+                if (!columnar_processors[ntuple_gen]->add(path)) {
+                    std::cout << "ERROR: failed to open columnar dataset: " << path << std::endl;
+                    return EXIT_FAILURE;
+                } else {
+                    std::cout << "\t" + path << " FOUND." << std::endl;
+                }
+            }
+            std::cout << std::endl;
+
+            continue;
+        }
+
+        // processed file by file in process_incremental(), or by the
+        // worker processes of a ShardedProcessor
+        if (incremental_cache || num_processes > 1)
+            continue;
+
         bool tchain_exists = tchains.find(ntuple_gen) != tchains.end();
 
         if (!tchain_exists) {
@@ -61,11 +567,23 @@ main(int argc, char** argv)
         // add each ntuple path to the corresponding TChain
         std::cout << std::endl << "### Loading files: " << ntuple_gen << " ###" << std::endl;
         for (auto const& path : ntuple_paths) {
-            ret_code = tchains[ntuple_gen]->Add(path.c_str(), 0);
+            std::string cached_path;
+            Double_t sum_weights_rejected = 0;
+
+            if (skim_cache && skim_cache->lookup(path, cached_path, sum_weights_rejected,
+                        num_threads == 1 && read_ahead_mb == 0)) {
+                ret_code = tchains[ntuple_gen]->Add(cached_path.c_str(), 0);
+                skimmed_sum_weights[ntuple_gen] += sum_weights_rejected;
+            } else {
+                cached_path.clear();
+                ret_code = tchains[ntuple_gen]->Add(path.c_str(), 0);
+            }
 
             if (ret_code != 1) {
                 std::cout << "ERROR: failed to open input file: " << path << std::endl;
                 return EXIT_FAILURE;
+            } else if (!cached_path.empty()) {
+                std::cout << "\t" + path << " FOUND (CACHED)." << std::endl;
             } else {
                 std::cout << "\t" + path << " FOUND." << std::endl;
             }
@@ -73,16 +591,150 @@ main(int argc, char** argv)
         std::cout << std::endl;
     }
 
+    // every generator goes to one output file, written in the background
+    // while the next generator is processed (workers only save their state)
+    std::unique_ptr<OutputWriter> output_writer;
+    if (worker_state_path.empty())
+        output_writer.reset(new OutputWriter(output_path, compression_settings));
+
+    const EventIndex event_index(event_index_dir);
+
+    // kept until the output is written, so that a run failing before then
+    // can still resume
+    std::vector< std::unique_ptr<Checkpointer> > checkpointers;
+
     // now actually process the TChains (i.e. ntuples) with the VVJJFlavorSelector
     TChain* tchain_gen;
-    TSelector* vvjj_selector;
+    VVJJFlavorSelector* vvjj_selector;
 
     for (auto& x : tchains)
     {
-        vvjj_selector = new VVJJFlavorSelector(output_path);
+        vvjj_selector = new VVJJFlavorSelector(output_path, &config);
+        vvjj_selector->efficiency_interval = efficiency_interval;
+        vvjj_selector->generator = x.first;
+        vvjj_selector->output_writer = output_writer.get();
+        vvjj_selector->input_skimmed = skimmed_sum_weights.count(x.first) > 0;
+        vvjj_selector->sum_weights_skimmed = skimmed_sum_weights[x.first];
+        vvjj_selector->state_path = worker_state_path;
 
         tchain_gen = x.second;
-        tchain_gen->Process(vvjj_selector);
+
+        // only the selected entries are read, see EventSelection
+        std::unique_ptr<TEntryList> entry_list;
+        if (!event_selection.empty()) {
+            std::cout << std::endl << "### Selecting events: " << x.first << " ###" << std::endl;
+
+            entry_list = event_selection.make_entry_list(tchain_gen, event_index,
+                    std::thread::hardware_concurrency());
+            if (!entry_list) {
+                delete vvjj_selector;
+                return EXIT_FAILURE;
+            }
+
+            tchain_gen->SetEntryList(entry_list.get());
+        }
+
+        std::unique_ptr<Checkpointer> checkpointer;
+        if (checkpoint_seconds > 0.) {
+            checkpointer.reset(new Checkpointer(output_path + "." + x.first + ".checkpoint",
+                        Checkpointer::hash_chain(tchain_gen), checkpoint_seconds));
+        }
+
+        const int status = process_chain(tchain_gen, vvjj_selector, num_threads, read_ahead_mb,
+                skim_cache.get(), prune_unused_branches, lazy_branches, checkpointer.get());
+
         delete vvjj_selector;
+
+        if (entry_list)
+            tchain_gen->SetEntryList(nullptr);
+
+        if (status != EXIT_SUCCESS)
+            return status;
+
+        if (checkpointer)
+            checkpointers.push_back(std::move(checkpointer));
     }
+
+    if (num_processes > 1) {
+        // the workers get every option but --processes
+        std::vector<std::string> worker_options;
+        for (int i = 3; i < argc; i++) {
+            if (std::string(argv[i]) == "--processes") {
+                i++;
+                continue;
+            }
+            worker_options.push_back(argv[i]);
+        }
+
+        ShardedProcessor sharded_processor(argv[0], worker_options, num_processes);
+
+        for (auto const& x : ntuple_filepath_map)
+        {
+            if (columnar_processors.find(x.first) != columnar_processors.end())
+                continue;
+
+            std::cout << std::endl << "### Processing in " << num_processes << " processes: " << x.first << " ###" << std::endl;
+
+            vvjj_selector = new VVJJFlavorSelector(output_path, &config);
+            vvjj_selector->efficiency_interval = efficiency_interval;
+            vvjj_selector->generator = x.first;
+            vvjj_selector->output_writer = output_writer.get();
+
+            const bool ok = sharded_processor.process(x.first, x.second, vvjj_selector);
+
+            delete vvjj_selector;
+
+            if (!ok)
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (incremental_cache) {
+        for (auto const& x : ntuple_filepath_map)
+        {
+            if (columnar_processors.find(x.first) != columnar_processors.end())
+                continue;
+
+            std::cout << std::endl << "### Incremental processing: " << x.first << " ###" << std::endl;
+
+            vvjj_selector = new VVJJFlavorSelector(output_path, &config);
+            vvjj_selector->efficiency_interval = efficiency_interval;
+            vvjj_selector->generator = x.first;
+            vvjj_selector->output_writer = output_writer.get();
+
+            const int status = process_incremental(x.second, *incremental_cache, vvjj_selector,
+                    num_threads, read_ahead_mb, prune_unused_branches, lazy_branches);
+
+            delete vvjj_selector;
+
+            if (status != EXIT_SUCCESS)
+                return status;
+        }
+    }
+
+    for (auto& x : columnar_processors)
+    {
+        vvjj_selector = new VVJJFlavorSelector(output_path, &config);
+        vvjj_selector->efficiency_interval = efficiency_interval;
+        vvjj_selector->generator = x.first;
+        vvjj_selector->output_writer = output_writer.get();
+
+        const bool ok = x.second->process(vvjj_selector)
+            && vvjj_selector->GetAbort() == TSelector::kContinue;
+
+        delete vvjj_selector;
+
+        if (!ok)
+            return EXIT_FAILURE;
+    }
+
+    if (output_writer && !output_writer->finish())
+        return EXIT_FAILURE;
+
+    // the output is written, the checkpoints are no longer needed
+    for (auto& checkpointer : checkpointers) {
+        checkpointer->finish();
+    }
+
+    return EXIT_SUCCESS;
 }
@@ -0,0 +1,455 @@
+// Merge the output files of several VVJJFlavorSelector jobs (e.g. over
+// shards of the same input file list) into one, like hadd but specialized
+// for the selector outputs:
+//
+//  - the layout is the union of the objects of every input, since
+//    histograms never filled are left out of an output (an object missing
+//    from an input counts as zero);
+//  - the inputs are read in parallel (one TFile per thread) and their bin
+//    contents, sums of squared weights and statistics are summed into
+//    preallocated flat buffers, one per thread, then reduced and written
+//    back once;
+//  - the sum_weights_* TParameter<Double_t> of each histogram set are summed;
+//  - THnSparse histograms are added with THnSparse::Add.
+//
+// The efficiency graphs and ROC points (the "efficiencies" directories),
+// and the efficiency maps and *_eff graphs of the ntrk_max scans (the
+// *_ntrk_scan TH2D and *_ntrk_scan_eff) are derived from the histograms of a
+// whole job and can't be summed, so they are left out of the merged file.
+// Process the shards with --processes to get them for the merged result.
+
+#include <TFile.h>
+#include <TH1.h>
+#include <THnSparse.h>
+#include <TKey.h>
+#include <TParameter.h>
+#include <TROOT.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class MergeKind {
+    Histogram,
+    Sparse,
+    Parameter
+};
+
+// one object of the output, and where its sums are kept in the flat buffers
+struct MergeItem {
+    std::string dir;    // "" at the top level, e.g. "ntrk_scan" or "JET_JER/ntrk_scan"
+    std::string name;
+    MergeKind kind;
+
+    // the object read from the first input holding it, overwritten with the sums
+    std::unique_ptr<TObject> merged;
+
+    size_t offset;
+    Int_t num_cells;    // bins (with under/overflows) of a histogram
+    Bool_t has_sumw2;
+};
+
+// histograms: contents, then sums of squared weights (if any), statistics
+// and number of entries; parameters: their value
+static size_t
+buffer_size(const MergeItem& item)
+{
+    if (item.kind == MergeKind::Parameter) return 1;
+    if (item.kind == MergeKind::Sparse) return 0;
+
+    return item.num_cells * (item.has_sumw2 ? 2 : 1) + TH1::kNstat + 1;
+}
+
+static std::string
+object_path(const MergeItem& item)
+{
+    return item.dir.empty() ? item.name : item.dir + "/" + item.name;
+}
+
+static Bool_t
+ends_with(const std::string& name, const std::string& suffix)
+{
+    return name.size() > suffix.size()
+        && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// the "efficiencies" directories, the *_eff graphs and the *_ntrk_scan
+// efficiency maps
+static Bool_t
+is_derived(const std::string& name)
+{
+    return name == "efficiencies" || ends_with(name, "_eff") || ends_with(name, "_ntrk_scan");
+}
+
+// Collect the mergeable objects of dir (recursively) not in seen yet (the
+// paths of the objects collected or left out from earlier inputs), in the
+// order of the keys so the merged file has the same layout. Returns the
+// number of objects left out.
+static size_t
+collect_items(TDirectory* dir, const std::string& dir_path, std::vector<MergeItem>& items,
+        std::set<std::string>& seen, size_t& total_size)
+{
+    size_t num_skipped = 0;
+    std::set<std::string> names;
+
+    TIter next(dir->GetListOfKeys());
+    TKey* key;
+
+    while ((key = static_cast<TKey*>(next()))) {
+        const std::string name = key->GetName();
+        const std::string path = dir_path.empty() ? name : dir_path + "/" + name;
+
+        // the keys of older cycles follow the latest one
+        if (!names.insert(name).second)
+            continue;
+
+        if (std::string(key->GetClassName()) == "TDirectoryFile" && !is_derived(name)) {
+            num_skipped += collect_items(dir->GetDirectory(name.c_str()), path, items, seen, total_size);
+            continue;
+        }
+
+        if (!seen.insert(path).second)
+            continue;
+
+        if (is_derived(name)) {
+            num_skipped++;
+            continue;
+        }
+
+        std::unique_ptr<TObject> object(key->ReadObj());
+
+        MergeItem item;
+        item.dir = dir_path;
+        item.name = name;
+        item.num_cells = 0;
+        item.has_sumw2 = kFALSE;
+
+        if (TH1* hist = dynamic_cast<TH1*>(object.get())) {
+            item.kind = MergeKind::Histogram;
+            item.num_cells = hist->GetSize();
+            item.has_sumw2 = hist->GetSumw2N() > 0;
+        } else if (dynamic_cast<THnSparse*>(object.get())) {
+            item.kind = MergeKind::Sparse;
+        } else if (dynamic_cast<TParameter<Double_t>*>(object.get())) {
+            item.kind = MergeKind::Parameter;
+        } else {
+            num_skipped++;
+            continue;
+        }
+
+        item.merged = std::move(object);
+        item.offset = total_size;
+        total_size += buffer_size(item);
+
+        items.push_back(std::move(item));
+    }
+
+    return num_skipped;
+}
+
+// the sums of one thread over the inputs it read
+struct ThreadSums {
+    std::vector<Double_t> buffer;
+    std::vector< std::unique_ptr<THnSparse> > sparse;
+    std::string error;
+};
+
+template <typename T>
+static void
+add_cells(Double_t* __restrict__ dst, const T* __restrict__ src, Int_t num_cells)
+{
+    for (Int_t i = 0; i < num_cells; i++) {
+        dst[i] += src[i];
+    }
+}
+
+// add the objects of the input file at path to sums
+static Bool_t
+add_file(const std::string& path, const std::vector<MergeItem>& items, ThreadSums& sums)
+{
+    std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "READ"));
+    if (!file || file->IsZombie()) {
+        sums.error = "failed to open: " + path;
+        return kFALSE;
+    }
+
+    Double_t stats[TH1::kNstat];
+
+    for (size_t i = 0; i < items.size(); i++) {
+        const MergeItem& item = items[i];
+        const std::string item_path = object_path(item);
+
+        // e.g. a histogram never filled in this input
+        std::unique_ptr<TObject> object(file->Get(item_path.c_str()));
+        if (!object)
+            continue;
+
+        Double_t* dst = sums.buffer.data() + item.offset;
+
+        if (item.kind == MergeKind::Parameter) {
+            auto parameter = dynamic_cast<TParameter<Double_t>*>(object.get());
+            if (parameter == nullptr) {
+                sums.error = "mismatched " + item_path + " in: " + path;
+                return kFALSE;
+            }
+
+            dst[0] += parameter->GetVal();
+        } else if (item.kind == MergeKind::Sparse) {
+            auto sparse = dynamic_cast<THnSparse*>(object.get());
+            if (sparse == nullptr) {
+                sums.error = "mismatched " + item_path + " in: " + path;
+                return kFALSE;
+            }
+
+            if (sums.sparse[i]) {
+                sums.sparse[i]->Add(sparse);
+            } else {
+                object.release();
+                sums.sparse[i].reset(sparse);
+            }
+        } else {
+            TH1* hist = dynamic_cast<TH1*>(object.get());
+            if (hist == nullptr || hist->GetSize() != item.num_cells
+                    || (hist->GetSumw2N() > 0) != item.has_sumw2) {
+                sums.error = "mismatched binning of " + item_path + " in: " + path;
+                return kFALSE;
+            }
+
+            // TH1F, TH2F, ... keep their contents in a TArrayF, TH1D, ... in a TArrayD
+            if (TArrayF* contents = dynamic_cast<TArrayF*>(hist)) {
+                add_cells(dst, contents->GetArray(), item.num_cells);
+            } else if (TArrayD* contents = dynamic_cast<TArrayD*>(hist)) {
+                add_cells(dst, contents->GetArray(), item.num_cells);
+            } else {
+                for (Int_t bin = 0; bin < item.num_cells; bin++) {
+                    dst[bin] += hist->GetBinContent(bin);
+                }
+            }
+            dst += item.num_cells;
+
+            if (item.has_sumw2) {
+                add_cells(dst, hist->GetSumw2()->GetArray(), item.num_cells);
+                dst += item.num_cells;
+            }
+
+            hist->GetStats(stats);
+            add_cells(dst, stats, TH1::kNstat);
+            dst[TH1::kNstat] += hist->GetEntries();
+        }
+    }
+
+    return kTRUE;
+}
+
+// write the sums of buffer into the objects of items
+static void
+store_sums(std::vector<MergeItem>& items, std::vector<Double_t>& buffer,
+        std::vector< std::unique_ptr<THnSparse> >& sparse)
+{
+    for (size_t i = 0; i < items.size(); i++) {
+        MergeItem& item = items[i];
+        Double_t* src = buffer.data() + item.offset;
+
+        if (item.kind == MergeKind::Parameter) {
+            static_cast<TParameter<Double_t>*>(item.merged.get())->SetVal(src[0]);
+        } else if (item.kind == MergeKind::Sparse) {
+            item.merged = std::move(sparse[i]);
+        } else {
+            TH1* hist = static_cast<TH1*>(item.merged.get());
+
+            if (TArrayF* contents = dynamic_cast<TArrayF*>(hist)) {
+                std::copy(src, src + item.num_cells, contents->GetArray());
+            } else if (TArrayD* contents = dynamic_cast<TArrayD*>(hist)) {
+                std::copy(src, src + item.num_cells, contents->GetArray());
+            } else {
+                for (Int_t bin = 0; bin < item.num_cells; bin++) {
+                    hist->SetBinContent(bin, src[bin]);
+                }
+            }
+            src += item.num_cells;
+
+            if (item.has_sumw2) {
+                std::copy(src, src + item.num_cells, hist->GetSumw2()->GetArray());
+                src += item.num_cells;
+            }
+
+            hist->PutStats(src);
+            hist->SetEntries(src[TH1::kNstat]);
+        }
+    }
+}
+
+static TDirectory*
+output_directory(TFile& output_file, const std::string& dir_path)
+{
+    TDirectory* dir = &output_file;
+
+    size_t start = 0;
+    while (start < dir_path.size()) {
+        size_t end = dir_path.find('/', start);
+        if (end == std::string::npos) end = dir_path.size();
+
+        const std::string name = dir_path.substr(start, end - start);
+        TDirectory* subdir = dir->GetDirectory(name.c_str());
+        dir = subdir ? subdir : dir->mkdir(name.c_str());
+
+        start = end + 1;
+    }
+
+    return dir;
+}
+
+// the number of --threads, false if malformed or below 1
+static bool
+parse_count(const std::string& arg, unsigned& count)
+{
+    try {
+        size_t end;
+        const long value = std::stol(arg, &end);
+        if (end != arg.size() || value < 1)
+            return false;
+
+        count = value;
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+static void
+print_usage(const char* program_name)
+{
+    std::cout << "usage: " << program_name << " <output_file> <input_file> [<input_file> ...] [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "options:" << std::endl;
+    std::cout << "\t--threads N         read the input files with N threads (default: all cores)" << std::endl;
+}
+
+int
+main(int argc, char** argv)
+{
+    std::string output_path;
+    std::vector<std::string> input_paths;
+    unsigned num_threads = std::thread::hardware_concurrency();
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--threads" && i + 1 < argc) {
+            if (!parse_count(argv[++i], num_threads)) {
+                std::cout << "ERROR: malformed number of threads: " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cout << "ERROR: unrecognized option: " << arg << std::endl;
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        } else if (output_path.empty()) {
+            output_path = arg;
+        } else {
+            input_paths.push_back(arg);
+        }
+    }
+
+    if (input_paths.empty()) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    ROOT::EnableThreadSafety();
+    TH1::AddDirectory(kFALSE);
+
+    // the layout of all the inputs (only the objects not seen in an earlier
+    // input are read)
+    std::vector<MergeItem> items;
+    std::set<std::string> seen;
+    size_t total_size = 0;
+    size_t num_skipped = 0;
+
+    for (auto const& path : input_paths) {
+        std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "READ"));
+        if (!file || file->IsZombie()) {
+            std::cout << "ERROR: failed to open: " << path << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        num_skipped += collect_items(file.get(), "", items, seen, total_size);
+    }
+
+    std::cout << "merging " << items.size() << " objects of " << input_paths.size() << " files" << std::endl;
+    if (num_skipped > 0) {
+        std::cout << "NOTE: " << num_skipped << " efficiency graphs and maps, ROC points and other derived"
+            << " objects are left out" << std::endl;
+    }
+
+    num_threads = std::max(1u, std::min<unsigned>(num_threads, input_paths.size()));
+
+    std::vector<ThreadSums> thread_sums(num_threads);
+    std::atomic<size_t> next_input(0);
+    std::vector<std::thread> threads;
+
+    for (unsigned t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t] {
+            ThreadSums& sums = thread_sums[t];
+            sums.buffer.assign(total_size, 0.);
+            sums.sparse.resize(items.size());
+
+            size_t input;
+            while ((input = next_input++) < input_paths.size()) {
+                if (!add_file(input_paths[input], items, sums)) {
+                    next_input = input_paths.size();
+                    return;
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (auto const& sums : thread_sums) {
+        if (!sums.error.empty()) {
+            std::cout << "ERROR: " << sums.error << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // reduce into the sums of the first thread
+    ThreadSums& merged = thread_sums.front();
+    for (size_t t = 1; t < thread_sums.size(); t++) {
+        add_cells(merged.buffer.data(), thread_sums[t].buffer.data(), total_size);
+
+        for (size_t i = 0; i < items.size(); i++) {
+            if (!thread_sums[t].sparse[i]) continue;
+
+            if (merged.sparse[i])
+                merged.sparse[i]->Add(thread_sums[t].sparse[i].get());
+            else
+                merged.sparse[i] = std::move(thread_sums[t].sparse[i]);
+        }
+    }
+
+    store_sums(items, merged.buffer, merged.sparse);
+
+    TFile output_file(output_path.c_str(), "RECREATE");
+    if (output_file.IsZombie()) {
+        std::cout << "ERROR: failed to create: " << output_path << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    for (auto const& item : items) {
+        output_directory(output_file, item.dir)->WriteTObject(item.merged.get(), item.name.c_str());
+    }
+
+    output_file.Close();
+
+    std::cout << "merged output written to: " << output_path << std::endl;
+    return EXIT_SUCCESS;
+}
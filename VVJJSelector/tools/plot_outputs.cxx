@@ -0,0 +1,899 @@
+// Render the control and efficiency plots of a selector output file, the
+// native counterpart of plotting/batch_plot_all.sh:
+//
+//  - qq_qg_gg_events/             batch_plot_qq_qg_gg_events_control_plots.py
+//  - qq_qg_gg_events_efficiency/  batch_plot_qq_qg_gg_events_efficiency_plots.py
+//  - quark_gluon_jets/            batch_plot_quark_gluon_jets_control_plots.py
+//  - quark_gluon_jets_efficiency/ batch_plot_quark_gluon_jets_efficiency_plots.py
+//
+// with the same plots, names and decorations (see plotting/plot_base.py),
+// in the ATLAS style of plotting/AtlasStyle.C. Every histogram and graph the
+// plots need is read from the output file once, then the plots are split
+// among worker processes, which render them from the in-memory copies.
+
+#include <TCanvas.h>
+#include <TFile.h>
+#include <TGaxis.h>
+#include <TGraphAsymmErrors.h>
+#include <TH1.h>
+#include <TLatex.h>
+#include <TLegend.h>
+#include <TROOT.h>
+#include <TStyle.h>
+#include <TSystem.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AtlasStyle.h"
+
+/******************************************************************************/
+/* PLOT DEFINITIONS                                                           */
+/******************************************************************************/
+
+static const Double_t UNSET = std::numeric_limits<Double_t>::quiet_NaN();
+
+enum class PlotFamily {
+    EventControl,       // qq/qg/gg events
+    EventEfficiency,
+    JetControl,         // quark/gluon jets
+    JetEfficiency
+};
+
+enum class WhichJet {
+    First,
+    Second,
+    Both
+};
+
+// the options of plot_base.PlotBase (and of the derived plots) in use
+struct PlotSpec {
+    PlotFamily family;
+    std::string name;
+
+    // the variable, e.g. "dijet_mass_WW_full", or "jet_m" with which_jet
+    std::string var_name;
+    WhichJet which_jet;
+
+    Bool_t normalize;
+    std::string x_units;
+    Double_t x_min;
+    Double_t x_max;
+    Double_t y_min;
+    Double_t y_max;
+    Bool_t log_scale;
+    Double_t empty_scale;
+
+    std::vector<Double_t> legend_loc;
+    std::vector<Double_t> extra_lines_loc;
+    std::vector<std::string> extra_legend_lines;
+};
+
+static PlotSpec
+make_spec(PlotFamily family, const std::string& name, const std::string& var_name)
+{
+    PlotSpec spec;
+    spec.family = family;
+    spec.name = name;
+    spec.var_name = var_name;
+    spec.which_jet = WhichJet::First;
+    spec.normalize = kFALSE;
+    spec.x_units = "GeV";
+    spec.x_min = UNSET;
+    spec.x_max = UNSET;
+    spec.y_min = UNSET;
+    spec.y_max = UNSET;
+    spec.log_scale = kFALSE;
+    spec.empty_scale = 1.0;
+    spec.legend_loc = {0.69, 0.92, 0.92, 0.82};
+    spec.extra_lines_loc = {0.2, 0.80};
+    spec.extra_legend_lines = {"Pythia 8 QCD dijet"};
+    return spec;
+}
+
+// see plot_vvjj.get_vvjj_axis_title, the longest matching prefix wins
+static std::string
+get_axis_title(const std::string& plot_name)
+{
+    static const std::vector< std::pair<std::string, std::string> > axis_titles = {
+        {"both_jet_pt",     "Large-R Jet #it{p}_{T}"},
+        {"first_jet_pt",    "Leading Large-R Jet #it{p}_{T}"},
+        {"second_jet_pt",   "Subleading Large-R Jet #it{p}_{T}"},
+        {"both_jet_eta",    "Large-R Jet #it{#eta}"},
+        {"first_jet_eta",   "Leading Large-R Jet #it{#eta}"},
+        {"second_jet_eta",  "Subleading Large-R Jet #it{#eta}"},
+        {"both_jet_phi",    "Large-R Jet #it{#phi}"},
+        {"first_jet_phi",   "Leading Large-R Jet #it{#phi}"},
+        {"second_jet_phi",  "Subleading Large-R Jet #it{#phi}"},
+        {"both_jet_m",      "Large-R Jet Mass"},
+        {"first_jet_m",     "Leading Large-R Jet Mass"},
+        {"second_jet_m",    "Subleading Large-R Jet Mass"},
+        {"both_jet_ntrk",   "Large-R Jet #it{n}_{trk}"},
+        {"first_jet_ntrk",  "Leading Large-R Jet #it{n}_{trk}"},
+        {"second_jet_ntrk", "Subleading Large-R Jet #it{n}_{trk}"},
+        {"both_jet_D2",     "Large-R Jet #it{D}_{2}^{#beta=1}"},
+        {"first_jet_D2",    "Leading Large-R Jet #it{D}_{2}^{#beta=1}"},
+        {"second_jet_D2",   "Subleading Large-R Jet #it{D}_{2}^{#beta=1}"},
+        {"dijet_mass",      "m_{JJ}"}
+    };
+
+    size_t best_length = 0;
+    std::string title;
+
+    for (auto const& x : axis_titles) {
+        if (plot_name.compare(0, x.first.size(), x.first) == 0 && x.first.size() > best_length) {
+            best_length = x.first.size();
+            title = x.second;
+        }
+    }
+
+    return title;
+}
+
+// see plot_vvjj.get_vvjj_selection_tex, the longest matching tex wins
+static std::string
+get_selection_tex(const std::string& var_name)
+{
+    static const char* const bosons[] = { "WW", "WZ", "ZZ", "Z", "W" };
+    static const std::vector< std::pair<std::string, std::string> > partial_selections = {
+        {"_full",               "Selection"},
+        {"_partial_massD2",     "Partial Selection: mass + #it{D}_{2}"},
+        {"_partial_massNtrk",   "Partial Selection: mass + #it{n}_{trk}"},
+        {"_partial_ntrkD2",     "Partial Selection: #it{D}_{2} + #it{n}_{trk}"},
+        {"_partial_mass",       "Partial Selection: mass"},
+        {"_partial_D2",         "Partial Selection: #it{D}_{2}"}
+    };
+
+    std::vector< std::pair<std::string, std::string> > selection_tex = {
+        {"partial_ntrk", "Partial #it{n}_{trk} Selection"}
+    };
+
+    for (const char* boson : bosons) {
+        for (auto const& x : partial_selections) {
+            selection_tex.push_back(std::make_pair(boson + x.first, std::string(boson) + " " + x.second));
+        }
+    }
+
+    std::string tex;
+    for (auto const& x : selection_tex) {
+        if (var_name.find(x.first) != std::string::npos && x.second.size() > tex.size())
+            tex = x.second;
+    }
+
+    return tex;
+}
+
+// the plots of batch_plot_qq_qg_gg_events_control_plots.py
+static void
+add_event_control_plots(std::vector<PlotSpec>& specs)
+{
+    static const char* const var_names[] = {
+        "dijet_mass",
+        "dijet_mass_WW_full",
+        "dijet_mass_WZ_full",
+        "dijet_mass_ZZ_full",
+        "dijet_mass_partial_ntrk",
+        "dijet_mass_WW_partial_mass",
+        "dijet_mass_WZ_partial_mass",
+        "dijet_mass_ZZ_partial_mass",
+        "dijet_mass_WW_partial_massD2",
+        "dijet_mass_WZ_partial_massD2",
+        "dijet_mass_ZZ_partial_massD2",
+        "dijet_mass_WW_partial_massNtrk",
+        "dijet_mass_WZ_partial_massNtrk",
+        "dijet_mass_ZZ_partial_massNtrk",
+        "dijet_mass_WW_partial_ntrkD2",
+        "dijet_mass_WZ_partial_ntrkD2",
+        "dijet_mass_ZZ_partial_ntrkD2",
+        "dijet_mass_WW_partial_D2",
+        "dijet_mass_WZ_partial_D2",
+        "dijet_mass_ZZ_partial_D2"
+    };
+
+    auto make_dijet_control_plot = [] (const std::string& var_name, Bool_t normalize) {
+        PlotSpec spec = make_spec(PlotFamily::EventControl,
+                var_name + (normalize ? "_area_normalized" : "_lumi_normalized"), var_name);
+        spec.normalize = normalize;
+        spec.extra_lines_loc = {0.2, 0.83};
+        spec.legend_loc = {0.74, 0.92, 0.94, 0.80};
+        spec.empty_scale = 5.0;
+        spec.extra_legend_lines.push_back(get_selection_tex(var_name));
+        spec.log_scale = kTRUE;
+        spec.x_min = 1000;
+        spec.x_max = 3500;
+        return spec;
+    };
+
+    specs.push_back(make_dijet_control_plot("dijet_mass", kFALSE));
+
+    for (const char* var_name : var_names) {
+        specs.push_back(make_dijet_control_plot(var_name, kTRUE));
+    }
+}
+
+// the plots of batch_plot_qq_qg_gg_events_efficiency_plots.py
+static void
+add_event_efficiency_plots(std::vector<PlotSpec>& specs)
+{
+    static const std::vector< std::pair<std::string, Double_t> > plots = {
+        {"dijet_mass_partial_ntrk", 0.45},
+        {"dijet_mass_WW_partial_mass", 0.1},
+        {"dijet_mass_WZ_partial_mass", 0.12},
+        {"dijet_mass_ZZ_partial_mass", 0.1},
+        {"dijet_mass_WW_partial_D2", 0.5},
+        {"dijet_mass_WZ_partial_D2", 0.5},
+        {"dijet_mass_ZZ_partial_D2", 0.5},
+        {"dijet_mass_WW_partial_massD2", 0.005},
+        {"dijet_mass_WZ_partial_massD2", 0.005},
+        {"dijet_mass_ZZ_partial_massD2", 0.005},
+        {"dijet_mass_WW_partial_massNtrk", 0.02},
+        {"dijet_mass_WZ_partial_massNtrk", 0.02},
+        {"dijet_mass_ZZ_partial_massNtrk", 0.02},
+        {"dijet_mass_WW_partial_ntrkD2", 0.05},
+        {"dijet_mass_WZ_partial_ntrkD2", 0.05},
+        {"dijet_mass_ZZ_partial_ntrkD2", 0.05},
+        {"dijet_mass_WW_full", 0.002},
+        {"dijet_mass_WZ_full", 0.002},
+        {"dijet_mass_ZZ_full", 0.002}
+    };
+
+    for (auto const& x : plots) {
+        PlotSpec spec = make_spec(PlotFamily::EventEfficiency, x.first + "_efficiency", x.first);
+        spec.extra_lines_loc = {0.2, 0.83};
+        spec.legend_loc = {0.72, 0.91, 0.94, 0.77};
+        spec.extra_legend_lines.push_back(get_selection_tex(x.first));
+        spec.x_min = 1000;
+        spec.x_max = 2500;
+        spec.y_min = 0.000001;
+        spec.y_max = x.second;
+        specs.push_back(spec);
+    }
+}
+
+// the plots of batch_plot_quark_gluon_jets_control_plots.py
+static void
+add_jet_control_plots(std::vector<PlotSpec>& specs)
+{
+    auto make_all_jet_control_plots = [&specs] (const PlotSpec& options) {
+        static const std::pair<WhichJet, const char*> jets[] = {
+            {WhichJet::First, "first_"}, {WhichJet::Second, "second_"}, {WhichJet::Both, "both_"}
+        };
+
+        for (auto const& jet : jets) {
+            for (Bool_t normalize : {kFALSE, kTRUE}) {
+                PlotSpec spec = options;
+                spec.name = jet.second + options.var_name
+                    + (normalize ? "_area_normalized" : "_lumi_normalized");
+                spec.which_jet = jet.first;
+                spec.normalize = normalize;
+                specs.push_back(spec);
+            }
+        }
+    };
+
+    auto jet_options = [] (const std::string& var_name) {
+        PlotSpec spec = make_spec(PlotFamily::JetControl, "", var_name);
+        spec.extra_lines_loc = {0.2, 0.83};
+        spec.legend_loc = {0.74, 0.92, 0.94, 0.82};
+        return spec;
+    };
+
+    PlotSpec spec = jet_options("jet_m");
+    spec.x_min = 50;
+    spec.x_max = 200;
+    spec.empty_scale = 1.5;
+    make_all_jet_control_plots(spec);
+
+    spec = jet_options("jet_ntrk");
+    spec.x_units = "";
+    spec.empty_scale = 1.6;
+    spec.x_max = 80;
+    make_all_jet_control_plots(spec);
+
+    spec = jet_options("jet_D2");
+    spec.x_units = "";
+    spec.empty_scale = 1.5;
+    make_all_jet_control_plots(spec);
+
+    spec = jet_options("jet_phi");
+    spec.empty_scale = 1.5;
+    spec.x_units = "rad";
+    make_all_jet_control_plots(spec);
+
+    spec = jet_options("jet_eta");
+    spec.empty_scale = 1.5;
+    spec.x_units = "";
+    make_all_jet_control_plots(spec);
+
+    spec = jet_options("jet_pt");
+    spec.empty_scale = 1.5;
+    spec.log_scale = kTRUE;
+    spec.x_min = 500;
+    spec.x_max = 2500;
+    make_all_jet_control_plots(spec);
+}
+
+// the plots of batch_plot_quark_gluon_jets_efficiency_plots.py
+static void
+add_jet_efficiency_plots(std::vector<PlotSpec>& specs)
+{
+    static const std::vector< std::pair<std::string, Double_t> > first_jet_plots = {
+        {"partial_ntrk", 0.7},
+        {"W_partial_mass", 0.2},
+        {"W_partial_D2", 1.5},
+        {"W_partial_massD2", 0.1},
+        {"W_partial_massNtrk", 0.15},
+        {"W_partial_ntrkD2", 0.4},
+        {"W_full", 0.04},
+        {"Z_partial_mass", 0.2},
+        {"Z_partial_D2", 1.5},
+        {"Z_partial_massD2", 0.1},
+        {"Z_partial_massNtrk", 0.15},
+        {"Z_partial_ntrkD2", 0.4},
+        {"Z_full", 0.04}
+    };
+
+    static const std::vector< std::pair<std::string, Double_t> > second_jet_plots = {
+        {"partial_ntrk", 0.8},
+        {"W_partial_mass", 1.5},
+        {"W_partial_D2", 0.4},
+        {"W_partial_massD2", 0.1},
+        {"W_partial_massNtrk", 0.4},
+        {"W_partial_ntrkD2", 0.4},
+        {"W_full", 0.06},
+        {"Z_partial_mass", 0.5},
+        {"Z_partial_D2", 0.4},
+        {"Z_partial_massD2", 0.1},
+        {"Z_partial_massNtrk", 0.3},
+        {"Z_partial_ntrkD2", 0.3},
+        {"Z_full", 0.05}
+    };
+
+    auto add_plots = [&specs] (const std::string& jet_var_name,
+            const std::vector< std::pair<std::string, Double_t> >& plots) {
+        for (auto const& x : plots) {
+            const std::string num_name = jet_var_name + "_" + x.first;
+
+            PlotSpec spec = make_spec(PlotFamily::JetEfficiency, num_name + "_efficiency", num_name);
+            spec.extra_lines_loc = {0.2, 0.83};
+            spec.legend_loc = {0.72, 0.91, 0.94, 0.77};
+            spec.extra_legend_lines.push_back(get_selection_tex(x.first));
+            spec.x_min = 500;
+            spec.x_max = 1500;
+            spec.y_min = 0.000001;
+            spec.y_max = x.second;
+            specs.push_back(spec);
+        }
+    };
+
+    add_plots("first_jet_pt", first_jet_plots);
+    add_plots("second_jet_pt", second_jet_plots);
+}
+
+static const char*
+family_dir(PlotFamily family)
+{
+    switch (family) {
+        case PlotFamily::EventControl:    return "qq_qg_gg_events";
+        case PlotFamily::EventEfficiency: return "qq_qg_gg_events_efficiency";
+        case PlotFamily::JetControl:      return "quark_gluon_jets";
+        case PlotFamily::JetEfficiency:   return "quark_gluon_jets_efficiency";
+    }
+
+    return "";
+}
+
+// The output objects a plot needs, by name without the generator suffix:
+// the histograms, then (for efficiencies) the graphs of the same topologies.
+static std::vector<std::string>
+required_objects(const PlotSpec& spec)
+{
+    std::vector<std::string> names;
+
+    switch (spec.family) {
+        case PlotFamily::EventControl:
+            for (const char* topo : { "_qq", "_qg", "_gg" }) {
+                names.push_back(spec.var_name + topo);
+            }
+            break;
+
+        case PlotFamily::EventEfficiency:
+            for (const char* topo : { "_qq", "_qg", "_gg" }) {
+                names.push_back(spec.var_name + topo);
+            }
+            for (const char* topo : { "_qq", "_qg", "_gg" }) {
+                names.push_back("efficiencies/" + spec.var_name + topo + "_eff");
+            }
+            break;
+
+        case PlotFamily::JetControl:
+            for (const char* topo : { "_q", "_g" }) {
+                names.push_back("first_" + spec.var_name + topo);
+                names.push_back("second_" + spec.var_name + topo);
+            }
+            break;
+
+        case PlotFamily::JetEfficiency:
+            for (const char* topo : { "_q", "_g" }) {
+                names.push_back(spec.var_name + topo);
+            }
+            for (const char* topo : { "_q", "_g" }) {
+                names.push_back("efficiencies/" + spec.var_name + topo + "_eff");
+            }
+            break;
+    }
+
+    return names;
+}
+
+/******************************************************************************/
+/* RENDERING                                                                  */
+/******************************************************************************/
+
+typedef std::map< std::string, std::unique_ptr<TObject> > ObjectMap;
+
+// see plot_util.format_bin_width, printed like Python floats
+static std::string
+format_bin_width(Double_t bin_spacing)
+{
+    auto python_str = [] (Double_t value) {
+        std::ostringstream ss;
+        ss.precision(12);
+        ss << value;
+        std::string s = ss.str();
+        if (s.find_first_of(".e") == std::string::npos) s += ".0";
+        return s;
+    };
+
+    if (bin_spacing < 0.5)
+        return python_str(std::round(bin_spacing * 20) / 20);
+    if (bin_spacing < 1.0)
+        return python_str(std::round(bin_spacing * 10) / 10);
+    if (bin_spacing < 10) {
+        if (static_cast<Int_t>(bin_spacing) == bin_spacing)
+            return std::to_string(static_cast<Int_t>(std::round(bin_spacing * 4) / 4));
+        return python_str(std::round(bin_spacing * 4) / 4);
+    }
+    if (bin_spacing < 100)
+        return python_str(std::round(bin_spacing * 2) / 2);
+
+    return std::to_string(static_cast<Int_t>(std::round(bin_spacing)));
+}
+
+// see plot_util.sane_defaults, with wide_plot
+static void
+set_sane_defaults(void)
+{
+    // 43 -> Helvetica fixed size, not based on pad/canvas/whatever size
+    for (const char* axis : { "X", "Y", "Z" }) {
+        gStyle->SetLabelFont(43, axis);
+        gStyle->SetTitleFont(43, axis);
+        gStyle->SetLabelSize(22, axis);
+        gStyle->SetTitleSize(22, axis);
+    }
+
+    gStyle->SetLegendFont(43);
+    gStyle->SetLegendBorderSize(0);
+    gStyle->SetLegendFillColor(0);
+    gStyle->SetStatFont(43);
+    gROOT->ForceStyle();
+}
+
+// see plot_util.set_mc_style_marker
+template <typename T>
+static void
+set_mc_style_marker(T* object, Int_t color, Int_t shape)
+{
+    object->SetFillStyle(0);
+    object->SetFillColor(0);
+    object->SetLineColor(color);
+    object->SetMarkerColorAlpha(color, 0.8);
+    object->SetMarkerSize(1.1);
+    object->SetMarkerStyle(shape);
+    object->SetLineStyle(1);
+    object->SetLineWidth(2);
+}
+
+template <typename T>
+static void
+set_axis_titles(T* object, const PlotSpec& spec, const std::string& y_title)
+{
+    const std::string x_units_str = spec.x_units.empty() ? "" : "[" + spec.x_units + "]";
+
+    object->GetYaxis()->SetTitle(y_title.c_str());
+    object->GetYaxis()->SetTitleOffset(1.5);
+    object->GetYaxis()->SetLabelOffset(0.01);
+    object->GetXaxis()->SetTitle((get_axis_title(spec.name) + " " + x_units_str).c_str());
+}
+
+// a curve of a plot: its color, marker and legend entry
+struct Curve {
+    const char* topo;
+    Int_t color;
+    Int_t shape;
+    const char* label;
+};
+
+// Draw the histograms of a control plot (in the given order, the first one
+// sets the axes) on the current pad, see PlotEventQuarkGluonControl and
+// PlotQuarkGluonControl.
+static void
+draw_control_plot(const PlotSpec& spec, std::vector<TH1*>& hists, const std::vector<Curve>& curves,
+        const std::vector<size_t>& draw_order, TLegend& legend)
+{
+    const Double_t x_min = std::isnan(spec.x_min) || spec.x_min == 0 ? hists[0]->GetXaxis()->GetXmin() : spec.x_min;
+    const Double_t x_max = std::isnan(spec.x_max) || spec.x_max == 0 ? hists[0]->GetXaxis()->GetXmax() : spec.x_max;
+
+    for (TH1* hist : hists) {
+        hist->GetXaxis()->SetRangeUser(x_min, x_max);
+        hist->SetMinimum(0.01);
+    }
+
+    if (spec.log_scale)
+        gPad->SetLogy();
+
+    // rescale y-axis to add/subtract empty space (for readability)
+    if (spec.empty_scale != 1) {
+        Double_t y_max = 0;
+        for (TH1* hist : hists) {
+            y_max = std::max(y_max, hist->GetMaximum());
+        }
+
+        y_max *= spec.log_scale ? 10 * spec.empty_scale : spec.empty_scale;
+
+        for (TH1* hist : hists) {
+            hist->SetMaximum(y_max);
+        }
+    }
+
+    if (!std::isnan(spec.y_min)) {
+        for (TH1* hist : hists) {
+            hist->SetMinimum(spec.y_min);
+        }
+    }
+
+    const std::string y_title = "Arbitrary Units / " + format_bin_width(hists[0]->GetXaxis()->GetBinWidth(1))
+        + " " + spec.x_units;
+
+    for (size_t i = 0; i < hists.size(); i++) {
+        set_axis_titles(hists[i], spec, y_title);
+        set_mc_style_marker(hists[i], curves[i].color, curves[i].shape);
+    }
+
+    for (size_t i = 0; i < draw_order.size(); i++) {
+        const char* option = spec.normalize ? (i == 0 ? "PE1" : "PE1,same") : (i == 0 ? "hist" : "hist,same");
+        hists[draw_order[i]]->Draw(option);
+    }
+
+    for (size_t i = 0; i < hists.size(); i++) {
+        legend.AddEntry(hists[i], curves[i].label);
+    }
+}
+
+// Draw the efficiency graphs of a plot (in the given order, the first one
+// sets the axes) on the current pad, see PlotEventQuarkGluonEfficiency and
+// PlotQuarkGluonJetEfficiency.
+static void
+draw_efficiency_plot(const PlotSpec& spec, std::vector<TGraph*>& graphs, Double_t bin_width,
+        const std::vector<Curve>& curves, const std::vector<size_t>& draw_order, TLegend& legend)
+{
+    const Double_t x_min = std::isnan(spec.x_min) || spec.x_min == 0 ? graphs[0]->GetXaxis()->GetXmin() : spec.x_min;
+    const Double_t x_max = std::isnan(spec.x_max) || spec.x_max == 0 ? graphs[0]->GetXaxis()->GetXmax() : spec.x_max;
+
+    for (TGraph* graph : graphs) {
+        graph->GetXaxis()->SetRangeUser(x_min, x_max);
+        graph->SetMaximum(spec.y_max);
+        if (!std::isnan(spec.y_min))
+            graph->SetMinimum(spec.y_min);
+    }
+
+    const std::string y_title = "Selection Efficiency / " + format_bin_width(bin_width) + " " + spec.x_units;
+
+    for (size_t i = 0; i < graphs.size(); i++) {
+        set_axis_titles(graphs[i], spec, y_title);
+        set_mc_style_marker(graphs[i], curves[i].color, curves[i].shape);
+    }
+
+    for (size_t i = 0; i < draw_order.size(); i++) {
+        graphs[draw_order[i]]->Draw(i == 0 ? "APE" : "PE,same");
+    }
+
+    for (size_t i = 0; i < graphs.size(); i++) {
+        legend.AddEntry(graphs[i], curves[i].label);
+    }
+}
+
+// a private copy of one of objects, the plots restyle what they draw
+template <typename T>
+static std::unique_ptr<T>
+clone_object(const ObjectMap& objects, const std::string& name)
+{
+    return std::unique_ptr<T>(static_cast<T*>(objects.at(name)->Clone()));
+}
+
+// Render one plot to <plot_dir>/<family>/<name>.<format> for each of formats.
+static void
+render_plot(const PlotSpec& spec, const ObjectMap& objects, const std::string& plot_dir,
+        const std::vector<std::string>& formats)
+{
+    TGaxis::SetMaxDigits(spec.family == PlotFamily::JetControl ? 3 : 4);
+
+    TCanvas canvas(("c_" + spec.name).c_str(), ("c_" + spec.name).c_str(), 800, 600);
+    canvas.cd();
+
+    TLegend legend(spec.legend_loc[0], spec.legend_loc[1], spec.legend_loc[2], spec.legend_loc[3]);
+    legend.SetBorderSize(0);
+
+    std::vector< std::unique_ptr<TObject> > owned;
+
+    switch (spec.family) {
+        case PlotFamily::EventControl:
+        case PlotFamily::JetControl: {
+            const bool events = spec.family == PlotFamily::EventControl;
+
+            const std::vector<Curve> curves = events
+                ? std::vector<Curve> { {"_qg", kBlue, 23, "quark-gluon"}, {"_qq", kGreen, 22, "quark-quark"},
+                    {"_gg", kRed, 21, "gluon-gluon"} }
+                : std::vector<Curve> { {"_q", kBlue, 22, "quark jets"}, {"_g", kRed, 23, "gluon jets"} };
+
+            std::vector<TH1*> hists;
+            for (auto const& curve : curves) {
+                std::unique_ptr<TH1> hist;
+
+                if (events) {
+                    hist = clone_object<TH1>(objects, spec.var_name + curve.topo);
+                } else if (spec.which_jet == WhichJet::Second) {
+                    hist = clone_object<TH1>(objects, "second_" + spec.var_name + curve.topo);
+                } else {
+                    hist = clone_object<TH1>(objects, "first_" + spec.var_name + curve.topo);
+                    if (spec.which_jet == WhichJet::Both)
+                        hist->Add(static_cast<const TH1*>(objects.at("second_" + spec.var_name + curve.topo).get()));
+                }
+
+                hists.push_back(hist.get());
+                owned.push_back(std::move(hist));
+            }
+
+            // scaled to the qg (or quark jet) integral
+            if (spec.normalize) {
+                for (size_t i = 1; i < hists.size(); i++) {
+                    hists[i]->Scale(hists[0]->Integral() / hists[i]->Integral());
+                }
+            }
+
+            const std::vector<size_t> draw_order = events
+                ? (spec.normalize ? std::vector<size_t> {0, 1, 2} : std::vector<size_t> {0, 2, 1})
+                : (spec.normalize ? std::vector<size_t> {0, 1} : std::vector<size_t> {1, 0});
+
+            draw_control_plot(spec, hists, curves, draw_order, legend);
+            break;
+        }
+
+        case PlotFamily::EventEfficiency:
+        case PlotFamily::JetEfficiency: {
+            const bool events = spec.family == PlotFamily::EventEfficiency;
+
+            const std::vector<Curve> curves = events
+                ? std::vector<Curve> { {"_qg", kBlue, 23, "quark-gluon"}, {"_qq", 8, 22, "quark-quark"},
+                    {"_gg", kRed, 21, "gluon-gluon"} }
+                : std::vector<Curve> { {"_q", kBlue, 22, "quark jets"}, {"_g", kRed, 23, "gluon jets"} };
+
+            std::vector<TGraph*> graphs;
+            for (auto const& curve : curves) {
+                std::unique_ptr<TGraph> graph = clone_object<TGraph>(objects,
+                        "efficiencies/" + spec.var_name + curve.topo + "_eff");
+                graphs.push_back(graph.get());
+                owned.push_back(std::move(graph));
+            }
+
+            const TH1* num = static_cast<const TH1*>(objects.at(spec.var_name + curves[0].topo).get());
+
+            const std::vector<size_t> draw_order = events ? std::vector<size_t> {0, 2, 1}
+                : std::vector<size_t> {0, 1};
+
+            draw_efficiency_plot(spec, graphs, num->GetXaxis()->GetBinWidth(1), curves, draw_order, legend);
+            break;
+        }
+    }
+
+    legend.Draw();
+    canvas.RedrawAxis();
+
+    // see PlotBase._make_decorations
+    auto set_default_tex_props = [] (TLatex& tex, Int_t font) {
+        tex.SetNDC();
+        tex.SetLineWidth(2);
+        tex.SetTextSize(0.04);
+        tex.SetTextFont(font);
+    };
+
+    TLatex atlas_tex(0.2, 0.88, "ATLAS");
+    set_default_tex_props(atlas_tex, 72);
+    atlas_tex.Draw();
+
+    TLatex atlas_mod_tex(0.2, 0.88, (std::string(14, ' ') + "Internal").c_str());
+    set_default_tex_props(atlas_mod_tex, 42);
+    atlas_mod_tex.Draw();
+
+    std::vector< std::unique_ptr<TLatex> > extra_latex;
+    Double_t y = spec.extra_lines_loc[1];
+    for (auto const& line : spec.extra_legend_lines) {
+        extra_latex.emplace_back(new TLatex(spec.extra_lines_loc[0], y, line.c_str()));
+        set_default_tex_props(*extra_latex.back(), 42);
+        extra_latex.back()->Draw();
+        y -= 0.05;
+    }
+
+    canvas.Update();
+    canvas.Modified();
+
+    for (auto const& format : formats) {
+        canvas.Print((plot_dir + "/" + family_dir(spec.family) + "/" + spec.name + "." + format).c_str());
+    }
+}
+
+/******************************************************************************/
+/* MAIN                                                                       */
+/******************************************************************************/
+
+// the number of --processes, false if malformed or below 1
+static bool
+parse_count(const std::string& arg, unsigned& count)
+{
+    try {
+        size_t end;
+        const long value = std::stol(arg, &end);
+        if (end != arg.size() || value < 1)
+            return false;
+
+        count = value;
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+static void
+print_usage(const char* program_name)
+{
+    std::cout << "usage: " << program_name << " <output_file> <plot_dir> [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "options:" << std::endl;
+    std::cout << "\t--generator GEN     generator to plot (default: pythia)" << std::endl;
+    std::cout << "\t--set SET           histogram set to plot, nominal or a variation (default: nominal)" << std::endl;
+    std::cout << "\t--processes N       render with N worker processes (default: all cores)" << std::endl;
+    std::cout << "\t--png               also render PNG files, next to the PDF files" << std::endl;
+}
+
+int
+main(int argc, char** argv)
+{
+    if (argc < 3) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const std::string input_path = argv[1];
+    const std::string plot_dir = argv[2];
+
+    std::string generator = "pythia";
+    std::string set_name = "nominal";
+    unsigned num_processes = std::thread::hardware_concurrency();
+    std::vector<std::string> formats = { "pdf" };
+
+    for (int i = 3; i < argc; i++) {
+        std::string option = argv[i];
+
+        if (option == "--generator" && i + 1 < argc) {
+            generator = argv[++i];
+        } else if (option == "--set" && i + 1 < argc) {
+            set_name = argv[++i];
+        } else if (option == "--processes" && i + 1 < argc) {
+            if (!parse_count(argv[++i], num_processes)) {
+                std::cout << "ERROR: malformed number of processes: " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (option == "--png") {
+            formats.push_back("png");
+        } else {
+            std::cout << "ERROR: unrecognized option: " << option << std::endl;
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<PlotSpec> specs;
+    add_event_control_plots(specs);
+    add_event_efficiency_plots(specs);
+    add_jet_control_plots(specs);
+    add_jet_efficiency_plots(specs);
+
+    // read everything the plots need, once
+    ObjectMap objects;
+    {
+        TH1::AddDirectory(kFALSE);
+
+        std::unique_ptr<TFile> input_file(TFile::Open(input_path.c_str(), "READ"));
+        if (!input_file || input_file->IsZombie()) {
+            std::cout << "ERROR: failed to open: " << input_path << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        for (auto const& spec : specs) {
+            for (auto const& name : required_objects(spec)) {
+                if (objects.find(name) != objects.end()) continue;
+
+                // the layout written by OutputWriter
+                const std::string path = set_name + "/" + generator + "/" + name + "_" + generator;
+
+                std::unique_ptr<TObject> object(input_file->Get(path.c_str()));
+                if (!object) {
+                    std::cout << "ERROR: missing " << path << " in: " << input_path << std::endl;
+                    return EXIT_FAILURE;
+                }
+
+                objects[name] = std::move(object);
+            }
+        }
+    }
+
+    for (auto const& spec : specs) {
+        gSystem->mkdir((plot_dir + "/" + family_dir(spec.family)).c_str(), kTRUE);
+    }
+
+    gROOT->SetBatch(kTRUE);
+    SetAtlasStyle();
+    set_sane_defaults();
+
+    num_processes = std::max(1u, std::min<unsigned>(num_processes, specs.size()));
+
+    std::cout << "rendering " << specs.size() << " plots with " << num_processes << " processes to: "
+        << plot_dir << std::endl;
+
+    // worker w renders every num_processes-th plot, from its copy of objects
+    std::cout.flush();
+    std::vector<pid_t> workers;
+    for (unsigned w = 0; w < num_processes; w++) {
+        const pid_t pid = fork();
+        if (pid < 0) {
+            std::cout << "ERROR: failed to start worker process" << std::endl;
+            break;
+        }
+
+        if (pid == 0) {
+            for (size_t i = w; i < specs.size(); i += num_processes) {
+                render_plot(specs[i], objects, plot_dir, formats);
+            }
+
+            std::cout.flush();
+            _exit(EXIT_SUCCESS);
+        }
+
+        workers.push_back(pid);
+    }
+
+    bool ok = workers.size() == num_processes;
+    for (pid_t pid : workers) {
+        int status;
+        ok = waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS && ok;
+    }
+
+    if (!ok) {
+        std::cout << "ERROR: rendering failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,10 +1,18 @@
 #!/bin/bash
 
 RAW_FILEPATH=$1
+GEN_NAME=${2:-pythia}
 BASE_NAME=$(basename $RAW_FILEPATH .root)
 OUTPUT_ROOT_DIR="output/$BASE_NAME"
 
-python batch_plot_qq_qg_gg_events_control_plots.py $RAW_FILEPATH $OUTPUT_ROOT_DIR
-python batch_plot_qq_qg_gg_events_efficiency_plots.py $RAW_FILEPATH $OUTPUT_ROOT_DIR
-python batch_plot_quark_gluon_jets_control_plots.py $RAW_FILEPATH $OUTPUT_ROOT_DIR
-python batch_plot_quark_gluon_jets_efficiency_plots.py $RAW_FILEPATH $OUTPUT_ROOT_DIR
+# the same plots in one pass, if built (make tools in VVJJSelector)
+PLOT_OUTPUTS="$(dirname $0)/../VVJJSelector/vvjj-plot-outputs"
+
+if [ -x "$PLOT_OUTPUTS" ]; then
+    exec "$PLOT_OUTPUTS" $RAW_FILEPATH $OUTPUT_ROOT_DIR --generator $GEN_NAME
+fi
+
+python batch_plot_qq_qg_gg_events_control_plots.py $RAW_FILEPATH $OUTPUT_ROOT_DIR $GEN_NAME
+python batch_plot_qq_qg_gg_events_efficiency_plots.py $RAW_FILEPATH $OUTPUT_ROOT_DIR $GEN_NAME
+python batch_plot_quark_gluon_jets_control_plots.py $RAW_FILEPATH $OUTPUT_ROOT_DIR $GEN_NAME
+python batch_plot_quark_gluon_jets_efficiency_plots.py $RAW_FILEPATH $OUTPUT_ROOT_DIR $GEN_NAME
@@ -11,13 +11,12 @@ from plot_vvjj import *
 
 RAW_INPUT_PATH = argv[1]
 OUTPUT_ROOT_DIR = argv[2]
+GEN_NAME = argv[3] if len(argv) > 3 else "pythia"
 
-RAW_TFILE = TFile(RAW_INPUT_PATH, "READ")
+RAW_LOADER = DMDRawLoader(RAW_INPUT_PATH)
 
-if not RAW_TFILE:
-    print("Failed to open raw control plot file: " + RAW_INPUT_PATH)
-    print "exiting..."
-    exit(1)
+def get_raw(name):
+    return RAW_LOADER.get_hist("nominal", GEN_NAME, name)
 
 gROOT.SetBatch()
 sane_defaults(wide_plot = True)
@@ -150,9 +149,9 @@ class PlotEventQuarkGluonControl(PlotBase):
 
 def make_quark_gluon_event_control_plot(var_name, **kwargs):
     return PlotEventQuarkGluonControl(
-            RAW_TFILE.Get(var_name + "_qq"),
-            RAW_TFILE.Get(var_name + "_qg"),
-            RAW_TFILE.Get(var_name + "_gg"),
+            get_raw(var_name + "_qq"),
+            get_raw(var_name + "_qg"),
+            get_raw(var_name + "_gg"),
             extra_lines_loc = [0.2,0.83],
             legend_loc = [0.74,0.92,0.94,0.80],
             **kwargs)
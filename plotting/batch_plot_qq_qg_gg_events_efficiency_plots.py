@@ -11,13 +11,12 @@ from plot_vvjj import *
 
 RAW_INPUT_PATH = argv[1]
 OUTPUT_ROOT_DIR = argv[2]
+GEN_NAME = argv[3] if len(argv) > 3 else "pythia"
 
-RAW_TFILE = TFile(RAW_INPUT_PATH, "READ")
+RAW_LOADER = DMDRawLoader(RAW_INPUT_PATH)
 
-if not RAW_TFILE:
-    print("Failed to open raw control plot file: " + RAW_INPUT_PATH)
-    print "exiting..."
-    exit(1)
+def get_raw(name):
+    return RAW_LOADER.get_hist("nominal", GEN_NAME, name)
 
 gROOT.SetBatch()
 sane_defaults(wide_plot = True)
@@ -28,9 +27,9 @@ make_dir(OUTPUT_ROOT_DIR)
 make_dir(OUTPUT_DIR)
 
 def make_eff_plot(h_num, h_den):
-    tgraph_eff = TGraphAsymmErrors()
-    tgraph_eff.Divide(h_num, h_den, "n")
-    return tgraph_eff
+    # computed by the selector, see TH1Topo::write_efficiencies()
+    num_name = h_num.GetName()[:-len("_" + GEN_NAME)]
+    return get_raw("efficiencies/" + num_name + "_eff")
 
 class PlotEventQuarkGluonEfficiency(PlotBase):
     def __init__(self,
@@ -101,12 +100,12 @@ DEFAULT_EXTRA_LINES = [ "Pythia 8 QCD dijet" ]
 
 def make_qq_qg_gg_event_efficiency_plot(num_var_name, den_var_name, **kwargs):
     return PlotEventQuarkGluonEfficiency(
-            RAW_TFILE.Get(num_var_name + "_qq"),
-            RAW_TFILE.Get(den_var_name + "_qq"),
-            RAW_TFILE.Get(num_var_name + "_qg"),
-            RAW_TFILE.Get(den_var_name + "_qg"),
-            RAW_TFILE.Get(num_var_name + "_gg"),
-            RAW_TFILE.Get(den_var_name + "_gg"),
+            get_raw(num_var_name + "_qq"),
+            get_raw(den_var_name + "_qq"),
+            get_raw(num_var_name + "_qg"),
+            get_raw(den_var_name + "_qg"),
+            get_raw(num_var_name + "_gg"),
+            get_raw(den_var_name + "_gg"),
             extra_lines_loc = [0.2,0.83],
             legend_loc = [0.72,0.91,0.94,0.77],
             **kwargs)
@@ -11,13 +11,12 @@ from plot_vvjj import *
 
 RAW_INPUT_PATH = argv[1]
 OUTPUT_ROOT_DIR = argv[2]
+GEN_NAME = argv[3] if len(argv) > 3 else "pythia"
 
-RAW_TFILE = TFile(RAW_INPUT_PATH, "READ")
+RAW_LOADER = DMDRawLoader(RAW_INPUT_PATH)
 
-if not RAW_TFILE:
-    print("Failed to open raw control plot file: " + RAW_INPUT_PATH)
-    print "exiting..."
-    exit(1)
+def get_raw(name):
+    return RAW_LOADER.get_hist("nominal", GEN_NAME, name)
 
 gROOT.SetBatch()
 sane_defaults(wide_plot = True)
@@ -125,11 +124,11 @@ class PlotQuarkGluonControl(PlotBase):
 FIRST_JET, SECOND_JET, BOTH_JETS = range(3)
 
 def make_quark_gluon_jet_control_plot(var_name, which_jet, **kwargs):
-    h_q1 = RAW_TFILE.Get("first_" + var_name + "_q")
-    h_q2 = RAW_TFILE.Get("second_" + var_name + "_q")
+    h_q1 = get_raw("first_" + var_name + "_q")
+    h_q2 = get_raw("second_" + var_name + "_q")
 
-    h_g1 = RAW_TFILE.Get("first_" + var_name + "_g")
-    h_g2 = RAW_TFILE.Get("second_" + var_name + "_g")
+    h_g1 = get_raw("first_" + var_name + "_g")
+    h_g2 = get_raw("second_" + var_name + "_g")
 
     h_q = h_q1
     h_g = h_g1
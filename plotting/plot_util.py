@@ -31,7 +31,7 @@ class DMDRawLoader(object):
     ''' A class that holds a TFile, and has convenient methods for
     accessing the histograms it contains. It expects the structure of the
     file to correspond to files produced with dmd-control-plots in the
-    DataMCdijets package
+    DataMCdijets package, or with run-vvjj-flavor-selector
     '''
 
     def __init__(self, filepath):